@@ -8,6 +8,7 @@
 #include <string.h>
 
 #include "octep_cp_lib.h"
+#include "octep_cp_log.h"
 #include "app_config.h"
 
 struct app_cfg cfg;
@@ -16,7 +17,7 @@ struct app_cfg cfg;
  * Object heirarchy
  * *(0 or more), +(1 or more)
  *
- * soc = { pem* };
+ * soc = { impl?, pem* };
  * pem = { idx, pf* };
  * pf = { idx, if, info, vf* };
  * vf = { idx, if, info };
@@ -27,6 +28,7 @@ struct app_cfg cfg;
  */
 
 #define CFG_TOKEN_SOC			"soc"
+#define CFG_TOKEN_SOC_IMPL		"impl"
 #define CFG_TOKEN_PEMS			"pems"
 #define CFG_TOKEN_PFS			"pfs"
 #define CFG_TOKEN_VFS			"vfs"
@@ -42,6 +44,15 @@ struct app_cfg cfg;
 #define CFG_TOKEN_INFO_PKIND		"pkind"
 #define CFG_TOKEN_INFO_HB_INTERVAL	"hb_interval"
 #define CFG_TOKEN_INFO_HB_MISS_COUNT	"hb_miss_count"
+#define CFG_TOKEN_PF_MBOX_SZ		"mbox_sz"
+#define CFG_TOKEN_PF_MBOX_H2FQ_PCT	"mbox_h2fq_pct"
+#define CFG_TOKEN_PF_TX_BACKLOG		"tx_backlog"
+#define CFG_TOKEN_PF_TX_BACKLOG_POLICY	"tx_backlog_policy"
+#define CFG_TOKEN_PF_OEI_COALESCE_MSGS	"oei_coalesce_msgs"
+#define CFG_TOKEN_PF_OEI_COALESCE_USECS	"oei_coalesce_usecs"
+#define CFG_TOKEN_PF_NOTIFY_DEBOUNCE_USECS	"notify_debounce_usecs"
+#define CFG_TX_BACKLOG_DROP_NEW		"drop_new"
+#define CFG_TX_BACKLOG_DROP_OLD		"drop_old"
 
 static inline struct pem_cfg *get_pem(int idx)
 {
@@ -135,6 +146,7 @@ static int parse_fn(config_setting_t *lcfg, struct fn_cfg *fn)
 static int parse_pf(config_setting_t *pf, struct pf_cfg *pfcfg, int pf_idx)
 {
 	config_setting_t *vfs, *vf;
+	const char *policy;
 	int nvfs, i, idx, err;
 	struct vf_cfg *vfcfg;
 
@@ -142,6 +154,64 @@ static int parse_pf(config_setting_t *pf, struct pf_cfg *pfcfg, int pf_idx)
 	if (err)
 		return err;
 
+	if (config_setting_lookup_int(pf, CFG_TOKEN_PF_MBOX_SZ, &idx))
+		pfcfg->mbox_sz = idx;
+	if (config_setting_lookup_int(pf, CFG_TOKEN_PF_MBOX_H2FQ_PCT, &idx)) {
+		if (idx < 0 || idx >= 100) {
+			OCTEP_CP_LOG(ERR, APP, "Invalid pf[%d] %s %d\n",
+				     pf_idx, CFG_TOKEN_PF_MBOX_H2FQ_PCT, idx);
+			return -EINVAL;
+		}
+		pfcfg->mbox_h2fq_pct = idx;
+	}
+	if (config_setting_lookup_int(pf, CFG_TOKEN_PF_TX_BACKLOG, &idx)) {
+		if (idx < 0 || idx > UINT16_MAX) {
+			OCTEP_CP_LOG(ERR, APP, "Invalid pf[%d] %s %d\n",
+				     pf_idx, CFG_TOKEN_PF_TX_BACKLOG, idx);
+			return -EINVAL;
+		}
+		pfcfg->tx_backlog = idx;
+	}
+	if (config_setting_lookup_string(pf, CFG_TOKEN_PF_TX_BACKLOG_POLICY,
+					 &policy)) {
+		if (!strcmp(policy, CFG_TX_BACKLOG_DROP_NEW)) {
+			pfcfg->tx_backlog_policy = OCTEP_CP_TX_BACKLOG_DROP_NEW;
+		} else if (!strcmp(policy, CFG_TX_BACKLOG_DROP_OLD)) {
+			pfcfg->tx_backlog_policy = OCTEP_CP_TX_BACKLOG_DROP_OLD;
+		} else {
+			OCTEP_CP_LOG(ERR, APP, "Invalid pf[%d] %s %s\n",
+				     pf_idx, CFG_TOKEN_PF_TX_BACKLOG_POLICY,
+				     policy);
+			return -EINVAL;
+		}
+	}
+	if (config_setting_lookup_int(pf, CFG_TOKEN_PF_OEI_COALESCE_MSGS, &idx)) {
+		if (idx < 0 || idx > UINT16_MAX) {
+			OCTEP_CP_LOG(ERR, APP, "Invalid pf[%d] %s %d\n",
+				     pf_idx, CFG_TOKEN_PF_OEI_COALESCE_MSGS, idx);
+			return -EINVAL;
+		}
+		pfcfg->oei_coalesce_msgs = idx;
+	}
+	if (config_setting_lookup_int(pf, CFG_TOKEN_PF_OEI_COALESCE_USECS, &idx)) {
+		if (idx < 0) {
+			OCTEP_CP_LOG(ERR, APP, "Invalid pf[%d] %s %d\n",
+				     pf_idx, CFG_TOKEN_PF_OEI_COALESCE_USECS, idx);
+			return -EINVAL;
+		}
+		pfcfg->oei_coalesce_usecs = idx;
+	}
+	if (config_setting_lookup_int(pf, CFG_TOKEN_PF_NOTIFY_DEBOUNCE_USECS,
+				      &idx)) {
+		if (idx < 0) {
+			OCTEP_CP_LOG(ERR, APP, "Invalid pf[%d] %s %d\n",
+				     pf_idx, CFG_TOKEN_PF_NOTIFY_DEBOUNCE_USECS,
+				     idx);
+			return -EINVAL;
+		}
+		pfcfg->notify_debounce_usecs = idx;
+	}
+
 	vfs = config_setting_get_member(pf, CFG_TOKEN_VFS);
 	if (!vfs)
 		return 0;
@@ -156,8 +226,8 @@ static int parse_pf(config_setting_t *pf, struct pf_cfg *pfcfg, int pf_idx)
 			continue;
 		vfcfg = get_vf(pfcfg, idx);
 		if (!vfcfg) {
-			printf("APP: Skipping out of bounds pf[%d]vf[%d]\n",
-			       pf_idx, idx);
+			OCTEP_CP_LOG(WARNING, APP, "Skipping out of bounds pf[%d]vf[%d]\n",
+				     pf_idx, idx);
 			continue;
 		}
 		err = parse_fn(vf, &vfcfg->fn);
@@ -191,8 +261,8 @@ static int parse_pem(config_setting_t *pem, struct pem_cfg *pemcfg, int pem_idx)
 			continue;
 		pfcfg = get_pf(pemcfg, idx);
 		if (!pfcfg) {
-			printf("APP: Skipping out of bounds pem[%d]pf[%d]\n",
-		   		   pem_idx, idx);
+			OCTEP_CP_LOG(WARNING, APP, "Skipping out of bounds pem[%d]pf[%d]\n",
+				     pem_idx, idx);
 			continue;
 		}
 		err = parse_pf(pf, pfcfg, i);
@@ -222,7 +292,7 @@ static int parse_pems(config_setting_t *pems)
 			continue;
 		pemcfg = get_pem(idx);
 		if (!pemcfg) {
-			printf("APP: Skipping out of bounds pem[%d]\n", idx);
+			OCTEP_CP_LOG(WARNING, APP, "Skipping out of bounds pem[%d]\n", idx);
 			continue;
 		}
 		err = parse_pem(pem, pemcfg, idx);
@@ -239,17 +309,18 @@ static int parse_pems(config_setting_t *pems)
 int app_config_init(const char *cfg_file_path)
 {
 	config_setting_t *lcfg, *pems;
+	const char *impl;
 	config_t fcfg;
 	int err;
 
 	memset (&cfg, 0, sizeof(struct app_cfg));
-	printf("APP: config init : %s\n", cfg_file_path);
+	OCTEP_CP_LOG(INFO, APP, "config init : %s\n", cfg_file_path);
 	config_init(&fcfg);
 	if (!config_read_file(&fcfg, cfg_file_path)) {
-		printf("APP: %s:%d - %s\n",
-		       config_error_file(&fcfg),
-		       config_error_line(&fcfg),
-		       config_error_text(&fcfg));
+		OCTEP_CP_LOG(ERR, APP, "%s:%d - %s\n",
+			     config_error_file(&fcfg),
+			     config_error_line(&fcfg),
+			     config_error_text(&fcfg));
 		config_destroy(&fcfg);
 		return -EINVAL;
 	}
@@ -260,6 +331,9 @@ int app_config_init(const char *cfg_file_path)
 		return -EINVAL;
 	}
 
+	if (config_setting_lookup_string(lcfg, CFG_TOKEN_SOC_IMPL, &impl))
+		strncpy(cfg.soc_impl, impl, sizeof(cfg.soc_impl) - 1);
+
 	pems = config_setting_get_member(lcfg, CFG_TOKEN_PEMS);
 	if (pems) {
 		err = parse_pems(pems);
@@ -312,8 +386,8 @@ int app_config_update_pem(int dom_idx)
 	int j, k;
 
 	if (dom_idx >= APP_CFG_PEM_MAX) {
-		printf("APP: Invalid domain index: %d\n",
-		       dom_idx);
+		OCTEP_CP_LOG(ERR, APP, "Invalid domain index: %d\n",
+			     dom_idx);
 		return -EINVAL;
 	}
 
@@ -412,7 +486,7 @@ int app_config_print_pem(int dom_idx)
 
 int app_config_uninit()
 {
-	printf("APP: config uninit\n");
+	OCTEP_CP_LOG(INFO, APP, "config uninit\n");
 	memset (&cfg, 0, sizeof(struct app_cfg));
 
 	return 0;
@@ -76,6 +76,20 @@ struct pf_cfg {
 	bool valid;
 	/* config */
 	struct fn_cfg fn;
+	/* mailbox size in bytes, 0 for default */
+	uint32_t mbox_sz;
+	/* percentage of mailbox queue memory for host to firmware queue */
+	uint8_t mbox_h2fq_pct;
+	/* max responses queued while mailbox is full, 0 for default */
+	uint16_t tx_backlog;
+	/* enum octep_cp_tx_backlog_policy */
+	uint8_t tx_backlog_policy;
+	/* interrupt moderation, max messages per interrupt, 0 for no limit */
+	uint16_t oei_coalesce_msgs;
+	/* interrupt moderation, max interrupt delay, 0 to disable */
+	uint32_t oei_coalesce_usecs;
+	/* max time a fan-out notification is held for debounce, 0 to disable */
+	uint32_t notify_debounce_usecs;
 	/* number of vf's */
 	int nvf;
 	/* configuration for vf's */
@@ -94,6 +108,8 @@ struct pem_cfg {
 
 /* app configuration */
 struct app_cfg {
+	/* soc implementation, empty to detect soc */
+	char soc_impl[OCTEP_CP_SOC_NAME_LEN_MAX];
 	/* number of pem's */
 	int npem;
 	/* configuration for pem's */
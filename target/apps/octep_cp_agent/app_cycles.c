@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+#include "cp_compat.h"
+#include "app_cycles.h"
+
+#define NSEC_PER_SEC		1000000000ULL
+/* time to measure cycle counter against monotonic clock */
+#define HIST_CALIBRATE_NS	20000000ULL
+
+static uint64_t cycles_hz;
+
+static uint64_t get_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+int cycles_init()
+{
+	struct timespec ts = { 0, HIST_CALIBRATE_NS };
+	uint64_t ns, cycles;
+
+	cycles_hz = cp_get_cycles_hz();
+	if (cycles_hz)
+		return 0;
+
+	ns = get_ns();
+	cycles = cp_get_cycles();
+	nanosleep(&ts, NULL);
+	cycles = cp_get_cycles() - cycles;
+	ns = get_ns() - ns;
+	if (!ns || !cycles)
+		return -EINVAL;
+
+	cycles_hz = (cycles * NSEC_PER_SEC) / ns;
+	return 0;
+}
+
+uint64_t cycles_to_ns(uint64_t cycles)
+{
+	if (!cycles_hz)
+		return 0;
+
+	return (uint64_t)(((__uint128_t)cycles * NSEC_PER_SEC) / cycles_hz);
+}
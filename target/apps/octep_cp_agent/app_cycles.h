@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __APP_CYCLES_H__
+#define __APP_CYCLES_H__
+
+/* Calibrate cycle counter.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int cycles_init();
+
+/* Convert cycles to nsecs.
+ */
+uint64_t cycles_to_ns(uint64_t cycles);
+
+#endif /* __APP_CYCLES_H__ */
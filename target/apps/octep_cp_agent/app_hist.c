@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+#include <stdio.h>
+#include <stdint.h>
+
+#include "app_hist.h"
+
+void hist_merge(struct app_hist *dst, const struct app_hist *src)
+{
+	uint64_t count, min, max;
+	int i;
+
+	count = HIST_LOAD(src->count);
+	if (!count)
+		return;
+
+	min = HIST_LOAD(src->min);
+	max = HIST_LOAD(src->max);
+	if (!dst->count || min < dst->min)
+		dst->min = min;
+	if (max > dst->max)
+		dst->max = max;
+	dst->count += count;
+	dst->sum += HIST_LOAD(src->sum);
+	for (i = 0; i < HIST_BUCKETS; i++)
+		dst->buckets[i] += HIST_LOAD(src->buckets[i]);
+}
+
+/* largest value counted in a bucket */
+static uint64_t bucket_max(int idx)
+{
+	int bit;
+
+	if (idx < HIST_SUB)
+		return idx;
+
+	bit = (idx / HIST_SUB) + HIST_SUB_BITS - 1;
+	return (((uint64_t)(HIST_SUB + (idx % HIST_SUB) + 1)) <<
+		(bit - HIST_SUB_BITS)) - 1;
+}
+
+uint64_t hist_percentile(const struct app_hist *hist, double pct)
+{
+	uint64_t total = 0, target, sum = 0;
+	int i;
+
+	/* buckets of a concurrently updated histogram may not add up to
+	 * count, use their sum.
+	 */
+	for (i = 0; i < HIST_BUCKETS; i++)
+		total += hist->buckets[i];
+	if (!total)
+		return 0;
+
+	target = (uint64_t)((total * pct) / 100.0);
+	if (target < 1)
+		target = 1;
+	if (target > total)
+		target = total;
+
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		sum += hist->buckets[i];
+		if (sum >= target)
+			break;
+	}
+	if (i == HIST_BUCKETS - 1 || bucket_max(i) > hist->max)
+		return hist->max;
+
+	return bucket_max(i);
+}
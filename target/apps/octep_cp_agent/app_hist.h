@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __APP_HIST_H__
+#define __APP_HIST_H__
+
+/* Log-linear histogram of values, such as cycle counts or nsecs.
+ *
+ * Values below HIST_SUB are counted exactly, above that every power of two
+ * is split into HIST_SUB buckets, so a bucket is within 1/HIST_SUB of the
+ * values counted in it. Values of 2^HIST_MAX_BITS and above go to the last
+ * bucket.
+ */
+#define HIST_SUB_BITS		3
+#define HIST_SUB		(1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS		48
+#define HIST_BUCKETS		((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB)
+
+/* Histogram with a single writer, readers load it without locks */
+struct app_hist {
+	/* number of values */
+	uint64_t count;
+	/* sum of values */
+	uint64_t sum;
+	/* smallest value, valid if count is not 0 */
+	uint64_t min;
+	/* largest value */
+	uint64_t max;
+	uint64_t buckets[HIST_BUCKETS];
+};
+
+#define HIST_LOAD(v)		__atomic_load_n(&(v), __ATOMIC_RELAXED)
+#define HIST_STORE(v, val)	__atomic_store_n(&(v), (val), __ATOMIC_RELAXED)
+
+static inline int hist_bucket(uint64_t val)
+{
+	int bit;
+
+	if (val < HIST_SUB)
+		return val;
+
+	bit = 63 - __builtin_clzll(val);
+	if (bit >= HIST_MAX_BITS)
+		return HIST_BUCKETS - 1;
+
+	return ((bit - HIST_SUB_BITS + 1) * HIST_SUB) +
+	       ((val >> (bit - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/* Add a value, caller should be the only writer of the histogram */
+static inline void hist_add(struct app_hist *hist, uint64_t val)
+{
+	int idx = hist_bucket(val);
+	uint64_t count = HIST_LOAD(hist->count);
+
+	HIST_STORE(hist->buckets[idx], HIST_LOAD(hist->buckets[idx]) + 1);
+	HIST_STORE(hist->sum, HIST_LOAD(hist->sum) + val);
+	if (!count || val < HIST_LOAD(hist->min))
+		HIST_STORE(hist->min, val);
+	if (val > HIST_LOAD(hist->max))
+		HIST_STORE(hist->max, val);
+	HIST_STORE(hist->count, count + 1);
+}
+
+/* Add histogram to another.
+ *
+ * @param dst: histogram owned by caller.
+ * @param src: histogram which may be updated concurrently.
+ */
+void hist_merge(struct app_hist *dst, const struct app_hist *src);
+
+/* Get value below which a percentage of values fall.
+ *
+ * return value: upper bound of bucket with the percentile, 0 if empty.
+ */
+uint64_t hist_percentile(const struct app_hist *hist, double pct);
+
+#endif /* __APP_HIST_H__ */
@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "app_poll.h"
+
+#define NSEC_PER_USEC		1000ULL
+#define NSEC_PER_SEC		1000000000ULL
+
+/* Max fd events handled per wait */
+#define POLL_EVENTS_MAX		16
+
+static const char *mode_names[POLL_MODE_MAX] = {
+	"busy",
+	"hybrid",
+	"sleep"
+};
+
+/* registered fd */
+struct poll_fd {
+	int fd;
+	poll_fd_cb_t cb;
+	void *arg;
+};
+
+static struct poll_cfg pcfg;
+static struct poll_stats pstats;
+/* end of last poll or sleep */
+static uint64_t last_ns;
+/* last poll which found work */
+static uint64_t active_ns;
+/* next sleep time in hybrid mode */
+static uint32_t sleep_us;
+/* work done by fd callbacks, accounted in next poll */
+static int fd_work;
+static int epoll_fd = -1;
+static int wakeup_fd = -1;
+static struct poll_fd fds[POLL_FDS_MAX];
+
+static inline uint64_t get_time_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+static int wakeup_cb(int fd, void *arg)
+{
+	uint64_t val;
+
+	read(fd, &val, sizeof(val));
+
+	return 0;
+}
+
+/* Wait up to us for registered fds and run their callbacks */
+static void wait_fds(uint32_t us)
+{
+	struct epoll_event events[POLL_EVENTS_MAX];
+	struct pollfd pfd;
+	struct timespec ts;
+	struct poll_fd *pf;
+	int n, i, ret;
+
+	if (us) {
+		/* epoll_wait has msec resolution, wait on epoll fd with
+		 * ppoll for usec timeouts.
+		 */
+		ts.tv_sec = us / 1000000;
+		ts.tv_nsec = (us % 1000000) * NSEC_PER_USEC;
+		pfd.fd = epoll_fd;
+		pfd.events = POLLIN;
+		n = ppoll(&pfd, 1, &ts, NULL);
+		if (n <= 0)
+			return;
+	}
+
+	n = epoll_wait(epoll_fd, events, POLL_EVENTS_MAX, 0);
+	for (i = 0; i < n; i++) {
+		pf = events[i].data.ptr;
+		ret = pf->cb(pf->fd, pf->arg);
+		if (ret > 0)
+			fd_work += ret;
+	}
+}
+
+static void do_sleep(uint32_t us, uint64_t now)
+{
+	wait_fds(us);
+
+	last_ns = get_time_ns();
+	pstats.sleeps++;
+	pstats.sleep_ns += (last_ns - now);
+}
+
+int poll_get_mode(const char *name)
+{
+	int i;
+
+	for (i = 0; i < POLL_MODE_MAX; i++) {
+		if (!strcmp(name, mode_names[i]))
+			return i;
+	}
+
+	return -EINVAL;
+}
+
+const char *poll_get_mode_name(enum poll_mode mode)
+{
+	return (mode < POLL_MODE_MAX) ? mode_names[mode] : "invalid";
+}
+
+int poll_init(struct poll_cfg *cfg)
+{
+	int i, err;
+
+	if (!cfg || cfg->mode >= POLL_MODE_MAX)
+		return -EINVAL;
+
+	if (cfg->mode == POLL_MODE_HYBRID &&
+	    (!cfg->min_sleep_us || cfg->min_sleep_us > cfg->max_sleep_us))
+		return -EINVAL;
+
+	for (i = 0; i < POLL_FDS_MAX; i++)
+		fds[i].fd = -1;
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0)
+		return -errno;
+
+	wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeup_fd < 0) {
+		err = -errno;
+		goto eventfd_fail;
+	}
+
+	err = poll_add_fd(wakeup_fd, wakeup_cb, NULL);
+	if (err)
+		goto add_fd_fail;
+
+	pcfg = *cfg;
+	memset(&pstats, 0, sizeof(pstats));
+	last_ns = get_time_ns();
+	active_ns = last_ns;
+	sleep_us = pcfg.min_sleep_us;
+	fd_work = 0;
+
+	return 0;
+
+add_fd_fail:
+	close(wakeup_fd);
+	wakeup_fd = -1;
+eventfd_fail:
+	close(epoll_fd);
+	epoll_fd = -1;
+
+	return err;
+}
+
+int poll_add_fd(int fd, poll_fd_cb_t cb, void *arg)
+{
+	struct epoll_event event;
+	int i;
+
+	if (fd < 0 || !cb)
+		return -EINVAL;
+
+	for (i = 0; i < POLL_FDS_MAX; i++) {
+		if (fds[i].fd < 0)
+			break;
+	}
+	if (i == POLL_FDS_MAX)
+		return -ENOSPC;
+
+	event.events = EPOLLIN;
+	event.data.ptr = &fds[i];
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event))
+		return -errno;
+
+	fds[i].fd = fd;
+	fds[i].cb = cb;
+	fds[i].arg = arg;
+
+	return 0;
+}
+
+int poll_del_fd(int fd)
+{
+	int i;
+
+	for (i = 0; i < POLL_FDS_MAX; i++) {
+		if (fds[i].fd == fd)
+			break;
+	}
+	if (i == POLL_FDS_MAX)
+		return -ENOENT;
+
+	/* fd is removed from epoll set automatically if it was closed */
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+	fds[i].fd = -1;
+
+	return 0;
+}
+
+int poll_wakeup()
+{
+	uint64_t val = 1;
+
+	if (wakeup_fd < 0)
+		return -EINVAL;
+
+	/* async signal safe */
+	if (write(wakeup_fd, &val, sizeof(val)) < 0)
+		return -errno;
+
+	return 0;
+}
+
+int poll_wait(int work)
+{
+	uint64_t now;
+
+	now = get_time_ns();
+	work += fd_work;
+	fd_work = 0;
+	pstats.polls++;
+	if (work > 0) {
+		pstats.busy_polls++;
+		pstats.busy_ns += (now - last_ns);
+		active_ns = now;
+		sleep_us = pcfg.min_sleep_us;
+	} else {
+		pstats.idle_ns += (now - last_ns);
+	}
+	last_ns = now;
+
+	switch (pcfg.mode) {
+	case POLL_MODE_BUSY:
+		wait_fds(0);
+		break;
+	case POLL_MODE_HYBRID:
+		if ((now - active_ns) < (pcfg.spin_us * NSEC_PER_USEC)) {
+			wait_fds(0);
+			break;
+		}
+
+		do_sleep(sleep_us, now);
+		sleep_us = (sleep_us < (pcfg.max_sleep_us / 2)) ?
+			   (sleep_us * 2) : pcfg.max_sleep_us;
+		break;
+	case POLL_MODE_SLEEP:
+		do_sleep(pcfg.max_sleep_us, now);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int poll_get_stats(struct poll_stats *stats)
+{
+	if (!stats)
+		return -EINVAL;
+
+	*stats = pstats;
+
+	return 0;
+}
+
+int poll_print_stats()
+{
+	double total;
+
+	total = pstats.busy_ns + pstats.idle_ns + pstats.sleep_ns;
+	if (!total)
+		total = 1;
+
+	printf("APP: poll mode %s polls %lu busy %lu sleeps %lu\n",
+	       poll_get_mode_name(pcfg.mode), pstats.polls,
+	       pstats.busy_polls, pstats.sleeps);
+	printf("APP: poll time busy %.2f%% idle %.2f%% sleep %.2f%%\n",
+	       (pstats.busy_ns * 100) / total,
+	       (pstats.idle_ns * 100) / total,
+	       (pstats.sleep_ns * 100) / total);
+
+	return 0;
+}
+
+int poll_uninit()
+{
+	if (wakeup_fd >= 0) {
+		poll_del_fd(wakeup_fd);
+		close(wakeup_fd);
+		wakeup_fd = -1;
+	}
+	if (epoll_fd >= 0) {
+		close(epoll_fd);
+		epoll_fd = -1;
+	}
+
+	return 0;
+}
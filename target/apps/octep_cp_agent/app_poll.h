@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __APP_POLL_H__
+#define __APP_POLL_H__
+
+/* Max fds that can be added to poll engine */
+#define POLL_FDS_MAX		32
+
+/* Callback for readable fd.
+ *
+ * return value: number of messages and events processed, -errno on failure.
+ */
+typedef int (*poll_fd_cb_t)(int fd, void *arg);
+
+/* Poll modes */
+enum poll_mode {
+	/* poll continuously, lowest latency */
+	POLL_MODE_BUSY,
+	/* poll for spin time after activity, then sleep with backoff */
+	POLL_MODE_HYBRID,
+	/* sleep for fixed time between polls */
+	POLL_MODE_SLEEP,
+	POLL_MODE_MAX
+};
+
+/* Poll configuration */
+struct poll_cfg {
+	/* poll mode */
+	enum poll_mode mode;
+	/* hybrid: time to keep polling after last activity */
+	uint32_t spin_us;
+	/* hybrid: first sleep after spinning, doubled on every idle poll */
+	uint32_t min_sleep_us;
+	/* sleep: time between polls, hybrid: max sleep time */
+	uint32_t max_sleep_us;
+};
+
+/* Poll statistics */
+struct poll_stats {
+	/* number of polls */
+	uint64_t polls;
+	/* number of polls which found work */
+	uint64_t busy_polls;
+	/* number of sleeps */
+	uint64_t sleeps;
+	/* time spent in polls which found work */
+	uint64_t busy_ns;
+	/* time spent in polls which found no work */
+	uint64_t idle_ns;
+	/* time spent sleeping */
+	uint64_t sleep_ns;
+};
+
+/* Get poll mode from name.
+ *
+ * @param name: busy, hybrid or sleep.
+ *
+ * return value: enum poll_mode on success, -errno on failure.
+ */
+int poll_get_mode(const char *name);
+
+/* Get name of poll mode.
+ *
+ * return value: name of mode.
+ */
+const char *poll_get_mode_name(enum poll_mode mode);
+
+/* Initialize poll engine.
+ *
+ * @param cfg: non-null pointer to struct poll_cfg.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int poll_init(struct poll_cfg *cfg);
+
+/* Add fd to poll engine.
+ *
+ * @param fd: fd to be watched for readability.
+ * @param cb: non-null callback to be called when fd is readable.
+ * @param arg: argument for callback.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int poll_add_fd(int fd, poll_fd_cb_t cb, void *arg);
+
+/* Remove fd from poll engine.
+ *
+ * @param fd: fd added with poll_add_fd.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int poll_del_fd(int fd);
+
+/* Wake up poll engine if it is waiting, safe to call from signal handler.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int poll_wakeup();
+
+/* Account for last poll and wait as per poll mode before next poll.
+ *
+ * Callbacks of fds which become readable are called while waiting,
+ * fds are checked without waiting in busy mode and while spinning in
+ * hybrid mode.
+ *
+ * @param work: number of messages and events processed in last poll.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int poll_wait(int work);
+
+/* Get poll statistics.
+ *
+ * @param stats: non-null pointer to struct poll_stats.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int poll_get_stats(struct poll_stats *stats);
+
+/* Print poll statistics with busy/idle/sleep time ratios.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int poll_print_stats();
+
+/* Uninitialize poll engine.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int poll_uninit();
+
+#endif /* __APP_POLL_H__ */
@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include "app_timer.h"
+#include "app_poll.h"
+
+#define NSEC_PER_MSEC		1000000ULL
+#define MSEC_PER_SEC		1000ULL
+
+static struct app_timer *wheel[APP_TIMER_WHEEL_SZ];
+/* last processed tick */
+static uint64_t cur_tick;
+/* tick at which timerfd is armed, 0 if disarmed */
+static uint64_t armed_tick;
+static int timer_fd = -1;
+static app_timer_tick_cb_t tick_done;
+
+static inline uint64_t get_tick()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((ts.tv_sec * MSEC_PER_SEC) + (ts.tv_nsec / NSEC_PER_MSEC)) /
+	       APP_TIMER_TICK_MS;
+}
+
+static void wheel_add(struct app_timer *t)
+{
+	struct app_timer **slot;
+
+	slot = &wheel[t->expires % APP_TIMER_WHEEL_SZ];
+	t->next = *slot;
+	if (t->next)
+		t->next->pprev = &t->next;
+	t->pprev = slot;
+	*slot = t;
+	t->pending = true;
+}
+
+static void wheel_del(struct app_timer *t)
+{
+	if (!t->pending)
+		return;
+
+	*t->pprev = t->next;
+	if (t->next)
+		t->next->pprev = t->pprev;
+	t->next = NULL;
+	t->pprev = NULL;
+	t->pending = false;
+}
+
+/* Arm timerfd for earliest pending timer */
+static void arm_timer_fd()
+{
+	struct itimerspec itim = { 0 };
+	struct app_timer *t;
+	uint64_t next = 0, ms;
+	int i;
+
+	for (i = 0; i < APP_TIMER_WHEEL_SZ; i++) {
+		for (t = wheel[i]; t; t = t->next) {
+			if (!next || t->expires < next)
+				next = t->expires;
+		}
+	}
+	if (next == armed_tick)
+		return;
+
+	armed_tick = next;
+	if (next) {
+		ms = next * APP_TIMER_TICK_MS;
+		itim.it_value.tv_sec = ms / MSEC_PER_SEC;
+		itim.it_value.tv_nsec = (ms % MSEC_PER_SEC) * NSEC_PER_MSEC;
+	}
+	timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &itim, NULL);
+}
+
+static int timer_fd_cb(int fd, void *arg)
+{
+	struct app_timer *expired = NULL, *t, *next;
+	uint64_t expirations, now, tick;
+	int n;
+
+	read(fd, &expirations, sizeof(expirations));
+	armed_tick = 0;
+	now = get_tick();
+	/* visit each slot at most once even if we are late by a rotation */
+	tick = (now - cur_tick > APP_TIMER_WHEEL_SZ) ?
+	       (now - APP_TIMER_WHEEL_SZ) : cur_tick;
+	for (; tick <= now; tick++) {
+		for (t = wheel[tick % APP_TIMER_WHEEL_SZ]; t; t = next) {
+			next = t->next;
+			if (t->expires > now)
+				continue;
+
+			wheel_del(t);
+			t->next = expired;
+			expired = t;
+		}
+	}
+	cur_tick = now;
+
+	for (n = 0, t = expired; t; t = next, n++) {
+		next = t->next;
+		t->next = NULL;
+		/* skip missed periods instead of expiring in a burst */
+		t->expires = now + t->period;
+		wheel_add(t);
+		t->cb(t->arg);
+	}
+	if (n && tick_done)
+		tick_done();
+
+	arm_timer_fd();
+
+	return 0;
+}
+
+int app_timer_init(app_timer_tick_cb_t tick_cb)
+{
+	int err;
+
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timer_fd < 0)
+		return -errno;
+
+	err = poll_add_fd(timer_fd, timer_fd_cb, NULL);
+	if (err) {
+		close(timer_fd);
+		timer_fd = -1;
+		return err;
+	}
+
+	memset(wheel, 0, sizeof(wheel));
+	cur_tick = get_tick();
+	armed_tick = 0;
+	tick_done = tick_cb;
+
+	return 0;
+}
+
+int app_timer_start(struct app_timer *t, uint32_t period_ms,
+		    app_timer_cb_t cb, void *arg)
+{
+	if (!t || !cb || !period_ms || timer_fd < 0)
+		return -EINVAL;
+
+	wheel_del(t);
+	t->period = (period_ms + APP_TIMER_TICK_MS - 1) / APP_TIMER_TICK_MS;
+	t->cb = cb;
+	t->arg = arg;
+	t->parked = false;
+	t->expires = get_tick() + t->period;
+	wheel_add(t);
+	arm_timer_fd();
+
+	return 0;
+}
+
+int app_timer_stop(struct app_timer *t)
+{
+	if (!t)
+		return -EINVAL;
+
+	wheel_del(t);
+	t->parked = false;
+	arm_timer_fd();
+
+	return 0;
+}
+
+int app_timer_park(struct app_timer *t)
+{
+	if (!t || !t->cb)
+		return -EINVAL;
+
+	wheel_del(t);
+	t->parked = true;
+	arm_timer_fd();
+
+	return 0;
+}
+
+int app_timer_unpark(struct app_timer *t)
+{
+	if (!t || !t->cb)
+		return -EINVAL;
+
+	if (!t->parked)
+		return 0;
+
+	t->parked = false;
+	t->expires = get_tick() + t->period;
+	wheel_add(t);
+	arm_timer_fd();
+
+	return 0;
+}
+
+int app_timer_uninit()
+{
+	struct app_timer *t;
+	int i;
+
+	for (i = 0; i < APP_TIMER_WHEEL_SZ; i++) {
+		while ((t = wheel[i]))
+			wheel_del(t);
+	}
+	if (timer_fd >= 0) {
+		poll_del_fd(timer_fd);
+		close(timer_fd);
+		timer_fd = -1;
+	}
+	tick_done = NULL;
+
+	return 0;
+}
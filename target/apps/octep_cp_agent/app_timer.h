@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __APP_TIMER_H__
+#define __APP_TIMER_H__
+
+/* Timer resolution in msecs */
+#define APP_TIMER_TICK_MS	10
+/* Number of slots in timer wheel */
+#define APP_TIMER_WHEEL_SZ	512
+
+/* Callback for expired timer */
+typedef void (*app_timer_cb_t)(void *arg);
+
+/* Callback after all timers expiring in a tick have been processed */
+typedef void (*app_timer_tick_cb_t)(void);
+
+/* Timer */
+struct app_timer {
+	/* tick at which timer expires */
+	uint64_t expires;
+	/* period in ticks */
+	uint32_t period;
+	/* timer is in wheel */
+	bool pending;
+	/* timer is parked, it is not scheduled until unparked */
+	bool parked;
+	/* expiry callback */
+	app_timer_cb_t cb;
+	/* argument for callback */
+	void *arg;
+	/* wheel slot list */
+	struct app_timer *next;
+	struct app_timer **pprev;
+};
+
+/* Initialize timer wheel.
+ *
+ * Wheel is driven by a timerfd added to poll engine, so poll engine should
+ * be initialized first. timerfd is armed only for the next expiry.
+ *
+ * @param tick_cb: optional callback after processing timers of a tick.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int app_timer_init(app_timer_tick_cb_t tick_cb);
+
+/* Start periodic timer.
+ *
+ * @param t: non-null pointer to struct app_timer.
+ * @param period_ms: period in msecs, rounded up to APP_TIMER_TICK_MS.
+ * @param cb: non-null expiry callback.
+ * @param arg: argument for callback.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int app_timer_start(struct app_timer *t, uint32_t period_ms,
+		    app_timer_cb_t cb, void *arg);
+
+/* Stop timer.
+ *
+ * @param t: non-null pointer to struct app_timer.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int app_timer_stop(struct app_timer *t);
+
+/* Park timer, it keeps its configuration but is removed from wheel.
+ *
+ * @param t: non-null pointer to struct app_timer.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int app_timer_park(struct app_timer *t);
+
+/* Unpark timer, it expires one period from now.
+ *
+ * @param t: non-null pointer to struct app_timer.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int app_timer_unpark(struct app_timer *t);
+
+/* Uninitialize timer wheel.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int app_timer_uninit();
+
+#endif /* __APP_TIMER_H__ */
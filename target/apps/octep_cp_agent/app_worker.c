@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "octep_cp_lib.h"
+#include "octep_cp_log.h"
+#include "loop.h"
+#include "app_poll.h"
+#include "app_worker.h"
+
+#define NSEC_PER_USEC		1000ULL
+#define NSEC_PER_SEC		1000000000ULL
+
+/* Max pf's a worker can own */
+#define WORKER_PFS_MAX		(OCTEP_CP_DOM_MAX * OCTEP_CP_PF_PER_DOM_MAX)
+
+/* pf work item, dom and pf index in library configuration */
+#define WORKER_ITEM(dom, pf)	(((uint32_t)(dom) << 16) | (pf))
+#define WORKER_ITEM_DOM(item)	((item) >> 16)
+#define WORKER_ITEM_PF(item)	((item) & 0xffff)
+
+struct worker {
+	pthread_t thread;
+	bool started;
+	int cpu;
+	struct loop_ctx *ctx;
+	/* protects pf queue, taken by owner and by thieves */
+	pthread_mutex_t lock;
+	/* queue of pf's, owner polls from head and requeues at tail */
+	uint32_t pfs[WORKER_PFS_MAX];
+	uint32_t head;
+	uint32_t num;
+	/* messages processed in last pass over pf's, read by thieves */
+	volatile int pass_work;
+	struct worker_stats stats;
+} __attribute__((aligned(64)));
+
+static struct worker workers[WORKER_MAX];
+static int num_workers = 0;
+static struct poll_cfg wcfg;
+static volatile int quit = 0;
+
+extern struct octep_cp_lib_cfg cp_lib_cfg;
+
+static inline uint64_t get_time_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+/* Take pf at head of queue of worker if more than keep pf's are queued */
+static bool pop_pf(struct worker *w, uint32_t *item, uint32_t keep)
+{
+	bool ret = false;
+
+	pthread_mutex_lock(&w->lock);
+	if (w->num > keep) {
+		*item = w->pfs[w->head];
+		w->head = (w->head + 1) % WORKER_PFS_MAX;
+		w->num--;
+		ret = true;
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	return ret;
+}
+
+static void push_pf(struct worker *w, uint32_t item)
+{
+	pthread_mutex_lock(&w->lock);
+	w->pfs[(w->head + w->num) % WORKER_PFS_MAX] = item;
+	w->num++;
+	pthread_mutex_unlock(&w->lock);
+}
+
+static uint32_t num_pfs(struct worker *w)
+{
+	uint32_t num;
+
+	pthread_mutex_lock(&w->lock);
+	num = w->num;
+	pthread_mutex_unlock(&w->lock);
+
+	return num;
+}
+
+/* Take over pf waiting longest behind the busiest worker. A worker with a
+ * single queued pf keeps it, so that one busy pf does not move back and
+ * forth between workers.
+ */
+static bool steal_pf(struct worker *w)
+{
+	struct worker *victim = NULL;
+	uint32_t item;
+	int i, work = 0;
+
+	/* queue length is only a hint here, pop_pf rechecks it */
+	for (i = 0; i < num_workers; i++) {
+		if (&workers[i] == w || workers[i].num < 2)
+			continue;
+
+		if (workers[i].pass_work > work) {
+			work = workers[i].pass_work;
+			victim = &workers[i];
+		}
+	}
+	if (!victim || !pop_pf(victim, &item, 1))
+		return false;
+
+	push_pf(w, item);
+	w->stats.steals++;
+
+	return true;
+}
+
+static void do_sleep(struct worker *w, uint32_t us)
+{
+	struct timespec ts;
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * NSEC_PER_USEC;
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+	w->stats.sleeps++;
+}
+
+/* Wait as per poll mode after a pass over all pf's of worker */
+static void wait_pass(struct worker *w, int work, uint64_t *active_ns,
+		      uint32_t *sleep_us)
+{
+	uint64_t now;
+
+	now = get_time_ns();
+	if (work > 0) {
+		*active_ns = now;
+		*sleep_us = wcfg.min_sleep_us;
+	}
+
+	switch (wcfg.mode) {
+	case POLL_MODE_HYBRID:
+		if (work > 0 ||
+		    (now - *active_ns) < (wcfg.spin_us * NSEC_PER_USEC))
+			break;
+
+		do_sleep(w, *sleep_us);
+		*sleep_us = (*sleep_us < (wcfg.max_sleep_us / 2)) ?
+			    (*sleep_us * 2) : wcfg.max_sleep_us;
+		break;
+	case POLL_MODE_SLEEP:
+		do_sleep(w, wcfg.max_sleep_us);
+		break;
+	default:
+		break;
+	}
+}
+
+static void *worker_main(void *arg)
+{
+	struct worker *w = (struct worker *)arg;
+	int n, pass_left = 0, pass_work = 0;
+	uint32_t item, sleep_us;
+	uint64_t active_ns;
+
+	active_ns = get_time_ns();
+	sleep_us = wcfg.min_sleep_us;
+	while (!quit) {
+		if (pass_left <= 0) {
+			w->pass_work = pass_work;
+			/* idle worker takes over pf's of busy workers */
+			if (!pass_work)
+				steal_pf(w);
+			wait_pass(w, pass_work, &active_ns, &sleep_us);
+			pass_left = num_pfs(w);
+			pass_work = 0;
+			continue;
+		}
+
+		pass_left--;
+		if (!pop_pf(w, &item, 0)) {
+			pass_left = 0;
+			continue;
+		}
+
+		n = loop_process_pf(w->ctx, WORKER_ITEM_DOM(item),
+				    WORKER_ITEM_PF(item));
+		push_pf(w, item);
+		w->stats.polls++;
+		if (n > 0) {
+			pass_work += n;
+			w->stats.msgs += n;
+		}
+	}
+
+	return NULL;
+}
+
+int worker_parse_cpus(const char *str, int *cpus, int max)
+{
+	long first, last, cpu;
+	const char *p = str;
+	char *end;
+	int num = 0;
+
+	if (!str || !cpus || max <= 0)
+		return -EINVAL;
+
+	while (*p) {
+		first = strtol(p, &end, 10);
+		if (end == p || first < 0)
+			return -EINVAL;
+
+		last = first;
+		if (*end == '-') {
+			p = end + 1;
+			last = strtol(p, &end, 10);
+			if (end == p || last < first)
+				return -EINVAL;
+		}
+		for (cpu = first; cpu <= last; cpu++) {
+			if (num >= max)
+				return -ENOSPC;
+			cpus[num++] = cpu;
+		}
+
+		if (*end == ',')
+			end++;
+		else if (*end)
+			return -EINVAL;
+		p = end;
+	}
+
+	return (num) ? num : -EINVAL;
+}
+
+int worker_init(const int *cpus, int num, struct poll_cfg *cfg)
+{
+	pthread_attr_t attr;
+	struct worker *w;
+	cpu_set_t cpuset;
+	int i, j, n, err;
+
+	if (!cpus || num <= 0 || num > WORKER_MAX || !cfg)
+		return -EINVAL;
+
+	wcfg = *cfg;
+	quit = 0;
+	num_workers = num;
+	for (i = 0; i < num_workers; i++) {
+		w = &workers[i];
+		memset(w, 0, sizeof(*w));
+		w->cpu = cpus[i];
+		pthread_mutex_init(&w->lock, NULL);
+	}
+
+	for (i = 0; i < num_workers; i++) {
+		workers[i].ctx = loop_ctx_alloc();
+		if (!workers[i].ctx) {
+			err = -ENOMEM;
+			goto init_fail;
+		}
+	}
+
+	/* distribute pf's round robin */
+	n = 0;
+	for (i = 0; i < cp_lib_cfg.ndoms; i++) {
+		for (j = 0; j < cp_lib_cfg.doms[i].npfs; j++)
+			push_pf(&workers[n++ % num_workers], WORKER_ITEM(i, j));
+	}
+
+	for (i = 0; i < num_workers; i++) {
+		w = &workers[i];
+		pthread_attr_init(&attr);
+		CPU_ZERO(&cpuset);
+		CPU_SET(w->cpu, &cpuset);
+		pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+		err = -pthread_create(&w->thread, &attr, worker_main, w);
+		pthread_attr_destroy(&attr);
+		if (err) {
+			OCTEP_CP_LOG(ERR, APP, "Unable to start worker on cpu %d\n", w->cpu);
+			goto init_fail;
+		}
+		w->started = true;
+		OCTEP_CP_LOG(INFO, APP, "worker[%d] cpu %d pfs %u\n", i, w->cpu,
+			     num_pfs(w));
+	}
+
+	return 0;
+
+init_fail:
+	worker_uninit();
+
+	return err;
+}
+
+int worker_get_stats(int idx, struct worker_stats *stats)
+{
+	if (idx < 0 || idx >= num_workers || !stats)
+		return -EINVAL;
+
+	*stats = workers[idx].stats;
+
+	return 0;
+}
+
+int worker_print_stats()
+{
+	struct worker_stats stats;
+	int i;
+
+	for (i = 0; i < num_workers; i++) {
+		worker_get_stats(i, &stats);
+		printf("APP: worker[%d] cpu %d pfs %u polls %lu msgs %lu "
+		       "steals %lu sleeps %lu\n",
+		       i, workers[i].cpu, num_pfs(&workers[i]), stats.polls,
+		       stats.msgs, stats.steals, stats.sleeps);
+	}
+
+	return 0;
+}
+
+int worker_uninit()
+{
+	struct worker *w;
+	int i;
+
+	quit = 1;
+	for (i = 0; i < num_workers; i++) {
+		w = &workers[i];
+		if (w->started)
+			pthread_join(w->thread, NULL);
+		w->started = false;
+		loop_ctx_free(w->ctx);
+		w->ctx = NULL;
+		pthread_mutex_destroy(&w->lock);
+	}
+	num_workers = 0;
+
+	return 0;
+}
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __APP_WORKER_H__
+#define __APP_WORKER_H__
+
+/* Max worker threads */
+#define WORKER_MAX		64
+
+/* Worker statistics */
+struct worker_stats {
+	/* number of pf polls */
+	uint64_t polls;
+	/* number of messages processed */
+	uint64_t msgs;
+	/* number of pf's stolen from other workers */
+	uint64_t steals;
+	/* number of sleeps */
+	uint64_t sleeps;
+};
+
+/* Parse list of cpus for workers.
+ *
+ * @param str: comma separated cpus or cpu ranges, eg: 2,3,8-11
+ * @param cpus: non-null array of size max to be filled with cpus.
+ * @param max: max number of cpus.
+ *
+ * return value: number of cpus on success, -errno on failure.
+ */
+int worker_parse_cpus(const char *str, int *cpus, int max);
+
+/* Start worker threads processing pf mailboxes.
+ *
+ * pf's of library configuration are distributed across workers, a worker
+ * which finds no work takes over pf's waiting behind a busy worker.
+ * Workers wait between idle polls as per poll mode. loop_init should be
+ * called before starting workers.
+ *
+ * @param cpus: non-null array of cpus, one worker is pinned to each cpu.
+ * @param num: number of workers.
+ * @param cfg: non-null pointer to struct poll_cfg.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int worker_init(const int *cpus, int num, struct poll_cfg *cfg);
+
+/* Get statistics of a worker.
+ *
+ * @param idx: index of worker.
+ * @param stats: non-null pointer to struct worker_stats.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int worker_get_stats(int idx, struct worker_stats *stats);
+
+/* Print statistics of all workers.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int worker_print_stats();
+
+/* Stop worker threads.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int worker_uninit();
+
+#endif /* __APP_WORKER_H__ */
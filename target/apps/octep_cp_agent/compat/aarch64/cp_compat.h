@@ -92,6 +92,26 @@ cp_write64(uint64_t value, volatile void *addr)
 	cp_write64_relaxed(value, addr);
 }
 
+/* Read free running virtual counter */
+static __cp_always_inline uint64_t
+cp_get_cycles(void)
+{
+	uint64_t cycles;
+
+	asm volatile("mrs %0, cntvct_el0" : "=r" (cycles));
+	return cycles;
+}
+
+/* Frequency of cp_get_cycles counter, 0 if unknown */
+static __cp_always_inline uint64_t
+cp_get_cycles_hz(void)
+{
+	uint64_t hz;
+
+	asm volatile("mrs %0, cntfrq_el0" : "=r" (hz));
+	return hz;
+}
+
 static inline void
 cp_eth_random_addr(uint8_t *addr)
 {
@@ -76,6 +76,24 @@ cp_write64(uint64_t value, volatile void *addr)
 	cp_write64_relaxed(value, addr);
 }
 
+/* Read time stamp counter */
+static __cp_always_inline uint64_t
+cp_get_cycles(void)
+{
+	uint32_t lo, hi;
+
+	asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t)hi << 32) | lo;
+}
+
+/* Frequency of cp_get_cycles counter, 0 if unknown */
+static __cp_always_inline uint64_t
+cp_get_cycles_hz(void)
+{
+	/* tsc frequency is not architecturally visible */
+	return 0;
+}
+
 static inline void
 cp_eth_random_addr(uint8_t *addr)
 {
@@ -3,23 +3,102 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdbool.h>
 
 #include "octep_cp_lib.h"
+#include "octep_cp_log.h"
+#include "octep_cp_stats.h"
 #include "cp_compat.h"
 #include "octep_ctrl_net.h"
 #include "octep_hw.h"
 #include "loop.h"
 #include "app_config.h"
-
-static struct octep_cp_msg *rx_msg;
+#include "app_hist.h"
+#include "app_cycles.h"
+
+/* per thread message buffers */
+struct loop_ctx {
+	struct octep_cp_msg *rx_msg;
+	/* views of messages in mailbox memory */
+	struct octep_cp_msg *rx_view;
+	/* receive and respond in mailbox memory when library supports it */
+	bool zero_copy;
+	/* responses to a receive batch, sent in one burst by flush_resps */
+	struct octep_cp_msg *tx_msg;
+	struct octep_ctrl_net_h2f_resp *tx_resp;
+	/* command of each response for send latency, -1 if not counted */
+	int *tx_cmd;
+	int tx_num;
+	/* collect responses instead of sending them one at a time */
+	bool tx_batch;
+	/* latency in cycles, written by thread using the context */
+	struct app_hist lat[LOOP_LAT_MAX][OCTEP_CTRL_NET_H2F_CMD_MAX];
+	/* next context in ctx_list */
+	struct loop_ctx *next;
+};
+
+/* pf lock is held while a pf is processed and by loop_suspend_pem */
+struct loop_pf_lock {
+	pthread_mutex_t m;
+} __attribute__((aligned(64)));
+
+static struct loop_ctx *main_ctx;
 static int rx_num;
+static struct loop_pf_lock pf_locks[OCTEP_CP_DOM_MAX][OCTEP_CP_PF_PER_DOM_MAX];
+/* pem suspended by loop_suspend_pem, pem stays suspended if its reset fails */
+static bool pem_suspended[OCTEP_CP_DOM_MAX];
 static int max_msg_sz = sizeof(union octep_ctrl_net_max_data);
 static struct app_cfg loop_cfg = { 0 };
+
+/* pf with a ready host, indices in library configuration */
+struct loop_active_pf {
+	uint16_t dom_idx;
+	uint16_t pf_idx;
+};
+
+/* pf's polled by loop_process_msgs */
+static struct loop_active_pf active_pfs[OCTEP_CP_DOM_MAX *
+					OCTEP_CP_PF_PER_DOM_MAX];
+static int num_active_pfs = 0;
+/* host version of pf's by index in library configuration, 0 if host is
+ * not ready. Written with pf lock held.
+ */
 static uint32_t host_versions[OCTEP_CP_DOM_MAX][OCTEP_CP_PF_PER_DOM_MAX];
+/* cycles at start of last receive which emptied the host-to-fw queue of a
+ * pf, 0 if unknown. Written with pf lock held.
+ */
+static uint64_t drain_cycles[OCTEP_CP_DOM_MAX][OCTEP_CP_PF_PER_DOM_MAX];
+
+/* allocated contexts, for merging latency histograms */
+static struct loop_ctx *ctx_list;
+static pthread_mutex_t ctx_list_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *lat_names[LOOP_LAT_MAX] = {
+	"ring",
+	"handler",
+	"send"
+};
+
+static const char *cmd_names[OCTEP_CTRL_NET_H2F_CMD_MAX] = {
+	[OCTEP_CTRL_NET_H2F_CMD_INVALID] = "invalid",
+	[OCTEP_CTRL_NET_H2F_CMD_MTU] = "mtu",
+	[OCTEP_CTRL_NET_H2F_CMD_MAC] = "mac",
+	[OCTEP_CTRL_NET_H2F_CMD_GET_IF_STATS] = "get_if_stats",
+	[OCTEP_CTRL_NET_H2F_CMD_GET_XSTATS] = "get_xstats",
+	[OCTEP_CTRL_NET_H2F_CMD_GET_Q_STATS] = "get_q_stats",
+	[OCTEP_CTRL_NET_H2F_CMD_LINK_STATUS] = "link_status",
+	[OCTEP_CTRL_NET_H2F_CMD_RX_STATE] = "rx_state",
+	[OCTEP_CTRL_NET_H2F_CMD_LINK_INFO] = "link_info",
+	[OCTEP_CTRL_NET_H2F_CMD_GET_INFO] = "get_info",
+	[OCTEP_CTRL_NET_H2F_CMD_DEV_REMOVE] = "dev_remove",
+	[OCTEP_CTRL_NET_H2F_CMD_OFFLOADS] = "offloads"
+};
 
 extern struct octep_cp_lib_cfg cp_lib_cfg;
 
@@ -35,7 +114,7 @@ int loop_init_pem(int dom_idx)
 {
 	int j;
 
-	printf("APP: Loop Init PEM %d\n", dom_idx);
+	OCTEP_CP_LOG(INFO, APP, "Loop Init PEM %d\n", dom_idx);
 	/* for now only support single buffer messages */
 	for (j = 0; j < cp_lib_cfg.doms[dom_idx].npfs; j++) {
 		if (cp_lib_cfg.doms[dom_idx].pfs[j].max_msg_sz < max_msg_sz)
@@ -50,30 +129,66 @@ int loop_init_pem(int dom_idx)
 	memset(&host_versions[dom_idx],
 	       0,
 	       sizeof(uint32_t) * OCTEP_CP_PF_PER_DOM_MAX);
+	memset(&drain_cycles[dom_idx],
+	       0,
+	       sizeof(uint64_t) * OCTEP_CP_PF_PER_DOM_MAX);
 
 	return 0;
 }
 
-int loop_init(int max_msgs)
+void loop_ctx_free(struct loop_ctx *ctx)
 {
-	int i, ret;
-	struct octep_cp_msg *msg;
+	struct loop_ctx **p;
+	int i;
 
-	printf("APP: Loop Init\n");
-	/* for now only support single buffer messages */
-	for (i=0; i<cp_lib_cfg.ndoms; i++) {
-		ret = loop_init_pem(i);
-		if (ret)
-			return ret;
+	if (!ctx)
+		return;
+
+	pthread_mutex_lock(&ctx_list_lock);
+	for (p = &ctx_list; *p; p = &(*p)->next) {
+		if (*p == ctx) {
+			*p = ctx->next;
+			break;
+		}
 	}
+	pthread_mutex_unlock(&ctx_list_lock);
 
-	rx_num = max_msgs;
-	rx_msg = calloc(rx_num, sizeof(struct octep_cp_msg));
-	if (!rx_msg)
-		return -ENOMEM;
+	if (ctx->rx_msg) {
+		for (i = 0; i < rx_num; i++) {
+			if (ctx->rx_msg[i].sg_list[0].msg)
+				free(ctx->rx_msg[i].sg_list[0].msg);
+		}
+		free(ctx->rx_msg);
+	}
+	free(ctx->rx_view);
+	free(ctx->tx_msg);
+	free(ctx->tx_resp);
+	free(ctx->tx_cmd);
+	free(ctx);
+}
+
+struct loop_ctx *loop_ctx_alloc()
+{
+	struct octep_cp_msg *msg;
+	struct loop_ctx *ctx;
+	int i;
+
+	ctx = calloc(1, sizeof(struct loop_ctx));
+	if (!ctx)
+		return NULL;
+
+	ctx->zero_copy = true;
+	ctx->rx_msg = calloc(rx_num, sizeof(struct octep_cp_msg));
+	ctx->rx_view = calloc(rx_num, sizeof(struct octep_cp_msg));
+	ctx->tx_msg = calloc(rx_num, sizeof(struct octep_cp_msg));
+	ctx->tx_resp = calloc(rx_num, sizeof(struct octep_ctrl_net_h2f_resp));
+	ctx->tx_cmd = calloc(rx_num, sizeof(int));
+	if (!ctx->rx_msg || !ctx->rx_view || !ctx->tx_msg || !ctx->tx_resp ||
+	    !ctx->tx_cmd)
+		goto mem_alloc_fail;
 
-	for (i=0; i<rx_num; i++) {
-		msg = &rx_msg[i];
+	for (i = 0; i < rx_num; i++) {
+		msg = &ctx->rx_msg[i];
 		msg->info.s.sz = max_msg_sz;
 		msg->sg_num = 1;
 		msg->sg_list[0].sz = max_msg_sz;
@@ -82,26 +197,72 @@ int loop_init(int max_msgs)
 			goto mem_alloc_fail;
 	}
 
-	loop_cfg.npem = cfg.npem;
+	pthread_mutex_lock(&ctx_list_lock);
+	ctx->next = ctx_list;
+	ctx_list = ctx;
+	pthread_mutex_unlock(&ctx_list_lock);
+
+	return ctx;
+
+mem_alloc_fail:
+	loop_ctx_free(ctx);
+
+	return NULL;
+}
+
+int loop_pem_joined(int dom_idx)
+{
+	struct octep_cp_lib_info info;
+	int i;
+
+	octep_cp_lib_get_info(&info);
+	for (i = 0; i < info.ndoms; i++) {
+		if (info.doms[i].idx == cp_lib_cfg.doms[dom_idx].idx)
+			return 1;
+	}
+
+	return 0;
+}
+
+int loop_init(int max_msgs)
+{
+	int i, j, ret;
+
+	OCTEP_CP_LOG(INFO, APP, "Loop Init\n");
+	for (i = 0; i < OCTEP_CP_DOM_MAX; i++) {
+		for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX; j++)
+			pthread_mutex_init(&pf_locks[i][j].m, NULL);
+	}
+
 	memset(&host_versions,
 	       0,
 	       sizeof(uint32_t) * OCTEP_CP_DOM_MAX * OCTEP_CP_PF_PER_DOM_MAX);
+	ret = cycles_init();
+	if (ret)
+		OCTEP_CP_LOG(WARNING, APP,
+			     "cycle counter calibration failed, latencies will read 0\n");
+	/* for now only support single buffer messages */
+	for (i=0; i<cp_lib_cfg.ndoms; i++) {
+		/* pem's which join late are initialized once they are up */
+		if (!loop_pem_joined(i))
+			continue;
 
-	printf("APP: using single buffer with msg sz %u.\n", max_msg_sz);
+		ret = loop_init_pem(i);
+		if (ret)
+			return ret;
+	}
 
-	return 0;
+	rx_num = max_msgs;
+	main_ctx = loop_ctx_alloc();
+	if (!main_ctx)
+		return -ENOMEM;
 
-mem_alloc_fail:
-	for (i = 0; i < rx_num; i++) {
-		msg = &rx_msg[i];
-		if (msg->sg_list[0].msg)
-			free(msg->sg_list[0].msg);
-		msg->sg_list[0].sz = 0;
-		msg->sg_num = 0;
-	}
-	free(rx_msg);
+	loop_cfg.npem = cfg.npem;
+	loop_update_active();
+
+	OCTEP_CP_LOG(INFO, APP, "using single buffer with msg sz %u.\n", max_msg_sz);
 
-	return -ENOMEM;
+	return 0;
 }
 
 static int process_mtu(struct if_cfg *iface,
@@ -113,12 +274,12 @@ static int process_mtu(struct if_cfg *iface,
 	if (req->mtu.cmd == OCTEP_CTRL_NET_CMD_GET) {
 		resp->mtu.val = iface->mtu;
 
-		printf("APP: Cmd: get mtu : %u\n", resp->mtu.val);
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: get mtu : %u\n", resp->mtu.val);
 		ret = mtu_sz;
 	}
 	else {
 		iface->mtu = req->mtu.val;
-		printf("APP: Cmd: set mtu : %u\n", req->mtu.val);
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: set mtu : %u\n", req->mtu.val);
 	}
 	resp->hdr.s.reply = OCTEP_CTRL_NET_REPLY_OK;
 
@@ -134,23 +295,23 @@ static int process_mac(struct if_cfg *iface,
 	if (req->mac.cmd == OCTEP_CTRL_NET_CMD_GET) {
 		memcpy(&resp->mac.addr, &iface->mac_addr, ETH_ALEN);
 		ret = mac_sz;
-		printf("APP: Cmd: get mac : %02x:%02x:%02x:%02x:%02x:%02x\n",
-			   resp->mac.addr[0],
-			   resp->mac.addr[1],
-			   resp->mac.addr[2],
-			   resp->mac.addr[3],
-			   resp->mac.addr[4],
-			   resp->mac.addr[5]);
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: get mac : %02x:%02x:%02x:%02x:%02x:%02x\n",
+			     resp->mac.addr[0],
+			     resp->mac.addr[1],
+			     resp->mac.addr[2],
+			     resp->mac.addr[3],
+			     resp->mac.addr[4],
+			     resp->mac.addr[5]);
 	}
 	else {
 		memcpy(&iface->mac_addr, &req->mac.addr, ETH_ALEN);
-		printf("APP: Cmd: set mac : %02x:%02x:%02x:%02x:%02x:%02x\n",
-			   req->mac.addr[0],
-			   req->mac.addr[1],
-			   req->mac.addr[2],
-			   req->mac.addr[3],
-			   req->mac.addr[4],
-			   req->mac.addr[5]);
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: set mac : %02x:%02x:%02x:%02x:%02x:%02x\n",
+			     req->mac.addr[0],
+			     req->mac.addr[1],
+			     req->mac.addr[2],
+			     req->mac.addr[3],
+			     req->mac.addr[4],
+			     req->mac.addr[5]);
 	}
 	resp->hdr.s.reply = OCTEP_CTRL_NET_REPLY_OK;
 
@@ -164,7 +325,7 @@ static int process_get_if_stats(struct if_stats *ifstats,
 	/* struct if_stats = struct octep_ctrl_net_h2f_resp_cmd_get_stats */
 	memcpy(&resp->if_stats, ifstats, if_stats_sz);
 	resp->hdr.s.reply = OCTEP_CTRL_NET_REPLY_OK;
-	printf("APP: Cmd: get if stats\n");
+	OCTEP_CP_LOG(DEBUG, APP, "Cmd: get if stats\n");
 
 	return if_stats_sz;
 }
@@ -178,11 +339,11 @@ static int process_link_status(struct if_cfg *iface,
 	if (req->link.cmd == OCTEP_CTRL_NET_CMD_GET) {
 		resp->link.state = iface->link_state;
 		ret = state_sz;
-		printf("APP: Cmd: get link state : %u\n", resp->link.state);
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: get link state : %u\n", resp->link.state);
 	}
 	else {
 		iface->link_state = req->link.state;
-		printf("APP: Cmd: set link state : %u\n", req->link.state);
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: set link state : %u\n", req->link.state);
 	}
 	resp->hdr.s.reply = OCTEP_CTRL_NET_REPLY_OK;
 
@@ -198,11 +359,11 @@ static int process_rx_state(struct if_cfg *iface,
 	if (req->rx.cmd == OCTEP_CTRL_NET_CMD_GET) {
 		resp->rx.state = iface->rx_state;
 		ret = state_sz;
-		printf("APP: Cmd: get rx state : %u\n", resp->rx.state);
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: get rx state : %u\n", resp->rx.state);
 	}
 	else {
 		iface->rx_state = req->rx.state;
-		printf("APP: Cmd: set rx state : %u\n", req->rx.state);
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: set rx state : %u\n", req->rx.state);
 	}
 	resp->hdr.s.reply = OCTEP_CTRL_NET_REPLY_OK;
 
@@ -222,18 +383,18 @@ static int process_link_info(struct if_cfg *iface,
 		resp->link_info.pause = iface->pause_mode;
 		resp->link_info.speed = iface->speed;
 		ret = link_info_sz;
-		printf("APP: Cmd: get link info\n");
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: get link info\n");
 	}
 	else {
 		iface->advertised_modes = req->link_info.info.advertised_modes;
 		iface->autoneg = req->link_info.info.autoneg;
 		iface->pause_mode = req->link_info.info.pause;
 		iface->speed = req->link_info.info.speed;
-		printf("APP: Cmd: set link info: am:%lx a:%x p:%x s:%x\n",
-			req->link_info.info.advertised_modes,
-			req->link_info.info.autoneg,
-			req->link_info.info.pause,
-			req->link_info.info.speed);
+		OCTEP_CP_LOG(DEBUG, APP, "Cmd: set link info: am:%lx a:%x p:%x s:%x\n",
+			     req->link_info.info.advertised_modes,
+			     req->link_info.info.autoneg,
+			     req->link_info.info.pause,
+			     req->link_info.info.speed);
 	}
 	resp->hdr.s.reply = OCTEP_CTRL_NET_REPLY_OK;
 
@@ -245,7 +406,7 @@ static int process_get_info(struct octep_fw_info *info,
 			    struct octep_ctrl_net_h2f_resp *resp)
 {
 	memcpy(&resp->info.fw_info, info, sizeof(struct octep_fw_info));
-	printf("APP: Cmd: get info\n");
+	OCTEP_CP_LOG(DEBUG, APP, "Cmd: get info\n");
 	resp->hdr.s.reply = OCTEP_CTRL_NET_REPLY_OK;
 
 	return info_sz;
@@ -260,7 +421,7 @@ static int process_dev_remove(union octep_cp_msg_info *fn_ctx,
 	struct pf_cfg *pf;
 	int i;
 
-	printf("\nCmd: device remove\n");
+	OCTEP_CP_LOG(DEBUG, APP, "Cmd: device remove\n");
 
 	orig_fn = app_config_get_fn(&cfg, fn_ctx);
 	if (!orig_fn)
@@ -287,77 +448,200 @@ ret:
 
 }
 
-static int process_msg(union octep_cp_msg_info *ctx, struct octep_cp_msg *msg,
-		       uint32_t host_version)
+static inline bool is_word_aligned(const void *p)
+{
+	return (((uintptr_t)p & (sizeof(uint64_t) - 1)) == 0);
+}
+
+/* Get next response buffer of receive batch */
+static struct octep_ctrl_net_h2f_resp *batch_resp(struct loop_ctx *lctx)
+{
+	struct octep_ctrl_net_h2f_resp *resp;
+
+	resp = &lctx->tx_resp[lctx->tx_num];
+	memset(resp, 0, sizeof(struct octep_ctrl_net_h2f_resp));
+
+	return resp;
+}
+
+/* Add response built in batch_resp to receive batch */
+static void batch_add(struct loop_ctx *lctx, struct octep_cp_msg *msg,
+		      uint32_t resp_sz, int cmd)
+{
+	struct octep_cp_msg *resp_msg;
+
+	resp_msg = &lctx->tx_msg[lctx->tx_num];
+	resp_msg->info = msg->info;
+	resp_msg->info.s.sz = resp_sz;
+	resp_msg->sg_num = 1;
+	resp_msg->sg_list[0].sz = resp_sz;
+	resp_msg->sg_list[0].msg = &lctx->tx_resp[lctx->tx_num];
+	lctx->tx_cmd[lctx->tx_num] = cmd;
+	lctx->tx_num++;
+}
+
+/* Reserve response space in mailbox, NULL if response has to be copied */
+static struct octep_ctrl_net_h2f_resp *
+reserve_resp(struct loop_ctx *lctx, union octep_cp_msg_info *ctx,
+	     struct octep_cp_msg *msg, struct octep_cp_msg *resp_msg)
+{
+	volatile uint8_t *b;
+	uint32_t i;
+
+	if (lctx->tx_batch)
+		return batch_resp(lctx);
+
+	if (!lctx->zero_copy)
+		return NULL;
+
+	resp_msg->info = msg->info;
+	resp_msg->info.s.sz = sizeof(struct octep_ctrl_net_h2f_resp);
+	if (octep_cp_lib_send_msg_resp_reserve(ctx, resp_msg))
+		return NULL;
+
+	/* build in place only if response does not roll over */
+	if (resp_msg->sg_num != 1 || !is_word_aligned(resp_msg->sg_list[0].msg))
+		return NULL;
+
+	/* mailbox memory may be mapped uncached, avoid memset */
+	b = resp_msg->sg_list[0].msg;
+	for (i = 0; i < sizeof(struct octep_ctrl_net_h2f_resp); i++)
+		b[i] = 0;
+
+	return resp_msg->sg_list[0].msg;
+}
+
+/* Count message that could not be handled against its sender */
+static void count_handler_error(union octep_cp_msg_info *info)
+{
+	struct octep_cp_stats *s;
+
+	s = octep_cp_lib_get_stats(info->s.pem_idx, info->s.pf_idx,
+				   (info->s.is_vf) ? info->s.vf_idx : -1);
+	if (!s)
+		s = octep_cp_lib_get_stats(info->s.pem_idx, info->s.pf_idx, -1);
+	if (s)
+		OCTEP_CP_STATS_INC(s, handler_errors);
+}
+
+/* Process a request.
+ *
+ * @param ring_cycles: cycles before which request was not in ring, 0 if
+ *                     unknown.
+ */
+static int process_msg(struct loop_ctx *lctx, union octep_cp_msg_info *ctx,
+		       struct octep_cp_msg *msg, uint32_t host_version,
+		       uint64_t ring_cycles)
 {
 	struct octep_ctrl_net_h2f_req *req;
-	struct octep_ctrl_net_h2f_resp resp = { 0 };
+	struct octep_ctrl_net_h2f_resp resp_buf = { 0 };
+	struct octep_ctrl_net_h2f_resp *resp;
 	struct octep_cp_msg resp_msg;
 	struct fn_cfg *fn;
-	int resp_sz, cmd;
+	uint64_t start, send_start;
+	int resp_sz, cmd, ret;
 	int err = 0;
 
+	start = cp_get_cycles();
 	fn = app_config_get_fn(&loop_cfg, &msg->info);
 	if (!fn) {
-		printf("APP: Invalid msg[%lx]\n", msg->info.words[0]);
+		OCTEP_CP_LOG(ERR, APP, "Invalid msg[%lx]\n", msg->info.words[0]);
+		count_handler_error(&msg->info);
 		return err;
 	}
 
+	resp = reserve_resp(lctx, ctx, msg, &resp_msg);
+	if (!resp)
+		resp = &resp_buf;
+
+handle:
 	req = (struct octep_ctrl_net_h2f_req *)msg->sg_list[0].msg;
-	resp.hdr.words[0] = req->hdr.words[0];
+	resp->hdr.words[0] = req->hdr.words[0];
 	fn->iface.host_if_id = req->hdr.s.sender;
 	resp_sz = resp_hdr_sz;
 	cmd = req->hdr.s.cmd;
 
-	if (host_version < octep_ctrl_net_h2f_cmd_versions[cmd])
+	if (cmd < OCTEP_CTRL_NET_H2F_CMD_MAX &&
+	    host_version < octep_ctrl_net_h2f_cmd_versions[cmd])
 		cmd = OCTEP_CTRL_NET_H2F_CMD_INVALID;
 
 	switch (cmd) {
 		case OCTEP_CTRL_NET_H2F_CMD_MTU:
-			resp_sz += process_mtu(&fn->iface, req, &resp);
+			resp_sz += process_mtu(&fn->iface, req, resp);
 			break;
 		case OCTEP_CTRL_NET_H2F_CMD_MAC:
-			resp_sz += process_mac(&fn->iface, req, &resp);
+			resp_sz += process_mac(&fn->iface, req, resp);
 			break;
 		case OCTEP_CTRL_NET_H2F_CMD_GET_IF_STATS:
-			resp_sz += process_get_if_stats(&fn->ifstats, req, &resp);
+			resp_sz += process_get_if_stats(&fn->ifstats, req, resp);
 			break;
 		case OCTEP_CTRL_NET_H2F_CMD_LINK_STATUS:
-			resp_sz += process_link_status(&fn->iface, req, &resp);
+			resp_sz += process_link_status(&fn->iface, req, resp);
 			break;
 		case OCTEP_CTRL_NET_H2F_CMD_RX_STATE:
-			resp_sz += process_rx_state(&fn->iface, req, &resp);
+			resp_sz += process_rx_state(&fn->iface, req, resp);
 			break;
 		case OCTEP_CTRL_NET_H2F_CMD_LINK_INFO:
-			resp_sz += process_link_info(&fn->iface, req, &resp);
+			resp_sz += process_link_info(&fn->iface, req, resp);
 			break;
 		case OCTEP_CTRL_NET_H2F_CMD_GET_INFO:
-			resp_sz += process_get_info(&fn->info, req, &resp);
+			resp_sz += process_get_info(&fn->info, req, resp);
 			break;
 		case OCTEP_CTRL_NET_H2F_CMD_DEV_REMOVE:
-			resp_sz += process_dev_remove(&msg->info, fn, &resp);
+			resp_sz += process_dev_remove(&msg->info, fn, resp);
 			break;
 		case OCTEP_CTRL_NET_H2F_CMD_INVALID:
-			printf("APP: Out of range Cmd : %u host version %u"
-			       " cmd version %u\n",
-			       req->hdr.s.cmd,
-			       host_version,
-			       octep_ctrl_net_h2f_cmd_versions[req->hdr.s.cmd]);
-			resp.hdr.s.reply = OCTEP_CTRL_NET_REPLY_UNSUPPORTED;
+			OCTEP_CP_LOG(ERR, APP, "Out of range Cmd : %u host version %u"
+				     " cmd version %u\n",
+				     req->hdr.s.cmd,
+				     host_version,
+				     octep_ctrl_net_h2f_cmd_versions[req->hdr.s.cmd]);
+			resp->hdr.s.reply = OCTEP_CTRL_NET_REPLY_UNSUPPORTED;
+			count_handler_error(&msg->info);
 			break;
 		default:
-			printf("APP: Unhandled Cmd : %u\n", req->hdr.s.cmd);
+			OCTEP_CP_LOG(ERR, APP, "Unhandled Cmd : %u\n", req->hdr.s.cmd);
+			count_handler_error(&msg->info);
 			resp_sz = 0;
 			break;
 	}
 
-	if (resp_sz >= resp_hdr_sz) {
+	/* unknown commands are accounted as invalid */
+	if (cmd >= OCTEP_CTRL_NET_H2F_CMD_MAX)
+		cmd = OCTEP_CTRL_NET_H2F_CMD_INVALID;
+	if (ring_cycles)
+		hist_add(&lctx->lat[LOOP_LAT_RING][cmd], start - ring_cycles);
+	send_start = cp_get_cycles();
+	hist_add(&lctx->lat[LOOP_LAT_HANDLER][cmd], send_start - start);
+
+	if (resp_sz >= resp_hdr_sz && lctx->tx_batch) {
+		/* send latency is added when batch is flushed */
+		batch_add(lctx, msg, resp_sz, cmd);
+		fn->ifstats.tx_stats.pkts++;
+		fn->ifstats.tx_stats.octs += resp_sz;
+	} else if (resp_sz >= resp_hdr_sz) {
 		resp_msg.info = msg->info;
 		resp_msg.info.s.sz = resp_sz;
 		resp_msg.sg_num = 1;
 		resp_msg.sg_list[0].sz = resp_sz;
-		resp_msg.sg_list[0].msg = &resp;
-		octep_cp_lib_send_msg_resp(ctx, &resp_msg, 1);
+		if (resp != &resp_buf) {
+			ret = octep_cp_lib_send_msg_resp_commit(ctx, &resp_msg);
+			/* a send from another thread, such as a notification,
+			 * dropped the reservation, handlers are idempotent so
+			 * request is handled again into a local response
+			 */
+			if (ret == -ESTALE) {
+				resp = &resp_buf;
+				goto handle;
+			}
+		} else {
+			resp_msg.sg_list[0].msg = resp;
+			ret = octep_cp_lib_send_msg_resp(ctx, &resp_msg, 1);
+		}
+		hist_add(&lctx->lat[LOOP_LAT_SEND][cmd],
+			 cp_get_cycles() - send_start);
+		if (ret < 0)
+			count_handler_error(&msg->info);
 		fn->ifstats.tx_stats.pkts++;
 		fn->ifstats.tx_stats.octs += resp_sz;
 	}
@@ -368,49 +652,35 @@ static int process_msg(union octep_cp_msg_info *ctx, struct octep_cp_msg *msg,
 	return err;
 }
 
-static uint32_t get_host_version(int pem_idx, int pf_idx)
+static int reply_error(struct loop_ctx *lctx, union octep_cp_msg_info *ctx,
+		       struct octep_cp_msg *msg)
 {
-	struct octep_cp_lib_info info;
-	struct octep_cp_dom_info *dom;
-	struct octep_cp_pf_info *pf;
-	int i, j, err;
-
-	if (!host_versions[pem_idx][pf_idx]) {
-		err = octep_cp_lib_get_info(&info);
-		if (err)
-			return 0;
-
-		for (i = 0; i < info.ndoms; i++) {
-			dom = &info.doms[i];
-			for (j = 0; j < dom->npfs; j++) {
-				pf = &dom->pfs[j];
-				host_versions[dom->idx][pf->idx] = pf->host_version;
-			}
-		}
-	}
-
-	return host_versions[pem_idx][pf_idx];
-}
-
-static int reply_error(union octep_cp_msg_info *ctx, struct octep_cp_msg *msg)
-{
-	struct octep_ctrl_net_h2f_resp resp = { 0 };
+	struct octep_ctrl_net_h2f_resp resp_buf = { 0 };
+	struct octep_ctrl_net_h2f_resp *resp = &resp_buf;
 	struct octep_cp_msg resp_msg = { 0 };
 	struct octep_ctrl_net_h2f_req *req;
 	struct fn_cfg *fn;
 
+	if (lctx->tx_batch)
+		resp = batch_resp(lctx);
+
 	req = (struct octep_ctrl_net_h2f_req *)msg->sg_list[0].msg;
-	resp.hdr.words[0] = req->hdr.words[0];
-	resp.hdr.s.reply = OCTEP_CTRL_NET_REPLY_UNSUPPORTED;
+	resp->hdr.words[0] = req->hdr.words[0];
+	resp->hdr.s.reply = OCTEP_CTRL_NET_REPLY_UNSUPPORTED;
 
-	resp_msg.info = msg->info;
-	resp_msg.info.s.sz = resp_hdr_sz;
+	if (lctx->tx_batch) {
+		batch_add(lctx, msg, resp_hdr_sz, -1);
+	} else {
+		resp_msg.info = msg->info;
+		resp_msg.info.s.sz = resp_hdr_sz;
 
-	resp_msg.sg_num = 1;
-	resp_msg.sg_list[0].sz = resp_hdr_sz;
-	resp_msg.sg_list[0].msg = &resp;
+		resp_msg.sg_num = 1;
+		resp_msg.sg_list[0].sz = resp_hdr_sz;
+		resp_msg.sg_list[0].msg = resp;
 
-	octep_cp_lib_send_msg_resp(ctx, &resp_msg, 1);
+		if (octep_cp_lib_send_msg_resp(ctx, &resp_msg, 1) < 0)
+			count_handler_error(&msg->info);
+	}
 	fn = app_config_get_fn(&loop_cfg, &msg->info);
 	if (fn) {
 		fn->ifstats.tx_stats.pkts++;
@@ -422,51 +692,311 @@ static int reply_error(union octep_cp_msg_info *ctx, struct octep_cp_msg *msg)
 	return 0;
 }
 
-int loop_process_msgs()
+/* Send responses collected for a receive batch with one library call, so
+ * that the pf mailbox indices are read and written once and the host is
+ * interrupted once for the whole batch.
+ */
+static void flush_resps(struct loop_ctx *lctx, union octep_cp_msg_info *ctx)
+{
+	union octep_cp_msg_info info;
+	uint64_t start, cycles;
+	int m, ret;
+
+	if (!lctx->tx_num)
+		return;
+
+	start = cp_get_cycles();
+	ret = octep_cp_lib_send_msg_resp(ctx, lctx->tx_msg, lctx->tx_num);
+	cycles = cp_get_cycles() - start;
+	for (m = 0; m < lctx->tx_num; m++) {
+		if (lctx->tx_cmd[m] >= 0)
+			hist_add(&lctx->lat[LOOP_LAT_SEND][lctx->tx_cmd[m]],
+				 cycles);
+		if (m < ret)
+			continue;
+
+		/* library rewrites pem and pf in header of sent messages */
+		info = lctx->tx_msg[m].info;
+		info.s.pem_idx = ctx->s.pem_idx;
+		info.s.pf_idx = ctx->s.pf_idx;
+		count_handler_error(&info);
+	}
+	lctx->tx_num = 0;
+}
+
+/* Get request from mailbox view, copy it into msg if it is not contiguous
+ * and aligned in mailbox memory.
+ */
+static struct octep_cp_msg *get_view_msg(struct octep_cp_msg *view,
+					 struct octep_cp_msg *msg)
+{
+	uint32_t off, cp_sz;
+	int s;
+
+	if (view->sg_num == 1 && is_word_aligned(view->sg_list[0].msg))
+		return view;
+
+	msg->info = view->info;
+	off = 0;
+	for (s = 0; s < view->sg_num && off < max_msg_sz; s++) {
+		cp_sz = (view->sg_list[s].sz <= (max_msg_sz - off)) ?
+			view->sg_list[s].sz : (max_msg_sz - off);
+		memcpy((uint8_t *)msg->sg_list[0].msg + off,
+		       view->sg_list[s].msg, cp_sz);
+		off += cp_sz;
+	}
+
+	return msg;
+}
+
+static int recv_msgs(struct loop_ctx *lctx, union octep_cp_msg_info *ctx)
+{
+	int ret;
+
+	if (lctx->zero_copy) {
+		ret = octep_cp_lib_recv_msg_peek(ctx, lctx->rx_view, rx_num);
+		if (ret != -ENOTSUP)
+			return ret;
+
+		OCTEP_CP_LOG(INFO, APP, "mailbox peek not supported, copying messages\n");
+		lctx->zero_copy = false;
+	}
+
+	return octep_cp_lib_recv_msg(ctx, lctx->rx_msg, rx_num);
+}
+
+int loop_process_pf(struct loop_ctx *lctx, int dom_idx, int pf_idx)
 {
 	union octep_cp_msg_info ctx;
 	struct octep_cp_msg* msg;
+	uint64_t ring_cycles, recv_start;
 	uint32_t host_version;
-	int ret, i, j, m;
+	int ret, m;
+
+	/* skip pf while its pem is suspended */
+	if (pthread_mutex_trylock(&pf_locks[dom_idx][pf_idx].m))
+		return 0;
+
+	if (dom_idx >= cp_lib_cfg.ndoms ||
+	    pf_idx >= cp_lib_cfg.doms[dom_idx].npfs) {
+		pthread_mutex_unlock(&pf_locks[dom_idx][pf_idx].m);
+		return 0;
+	}
+
+	/* host is not ready */
+	host_version = host_versions[dom_idx][pf_idx];
+	if (!host_version) {
+		pthread_mutex_unlock(&pf_locks[dom_idx][pf_idx].m);
+		return 0;
+	}
+
+	ctx.words[0] = 0;
+	ctx.s.pem_idx = cp_lib_cfg.doms[dom_idx].idx;
+	ctx.s.pf_idx = cp_lib_cfg.doms[dom_idx].pfs[pf_idx].idx;
+	recv_start = cp_get_cycles();
+	ret = recv_msgs(lctx, &ctx);
+	/* requests received now arrived after the last receive which
+	 * emptied the queue, which bounds their time in ring.
+	 */
+	ring_cycles = drain_cycles[dom_idx][pf_idx];
+	if (ret < rx_num)
+		drain_cycles[dom_idx][pf_idx] = recv_start;
+	if (ret <= 0) {
+		pthread_mutex_unlock(&pf_locks[dom_idx][pf_idx].m);
+		return 0;
+	}
+
+	if (host_version < cp_lib_cfg.min_version ||
+	    host_version > cp_lib_cfg.max_version)
+		host_version = 0;
+
+	/* a single response is built in place in mailbox when possible */
+	lctx->tx_batch = (ret > 1);
+	for (m = 0; m < ret; m++) {
+		msg = (lctx->zero_copy) ?
+		      get_view_msg(&lctx->rx_view[m], &lctx->rx_msg[m]) :
+		      &lctx->rx_msg[m];
+		(host_version) ? process_msg(lctx, &ctx, msg, host_version,
+					     ring_cycles) :
+				 reply_error(lctx, &ctx, msg);
+		/* library will overwrite msg size in header so reset it */
+		lctx->rx_msg[m].info.s.sz = max_msg_sz;
+	}
+	flush_resps(lctx, &ctx);
+	if (lctx->zero_copy)
+		octep_cp_lib_recv_msg_commit(&ctx, lctx->rx_view, ret);
+	pthread_mutex_unlock(&pf_locks[dom_idx][pf_idx].m);
+
+	return ret;
+}
+
+int loop_process_msgs()
+{
+	int ret, i, n = 0;
+
+	for (i = 0; i < num_active_pfs; i++) {
+		ret = loop_process_pf(main_ctx, active_pfs[i].dom_idx,
+				      active_pfs[i].pf_idx);
+		if (ret > 0)
+			n += ret;
+	}
+
+	return n;
+}
+
+/* Find index of pf in library configuration */
+static int find_pf(int pem_idx, int pf_idx, int *dom_i, int *pf_j)
+{
+	int i, j;
 
 	for (i = 0; i < cp_lib_cfg.ndoms; i++) {
-		ctx.s.pem_idx = cp_lib_cfg.doms[i].idx;
+		if (cp_lib_cfg.doms[i].idx != pem_idx)
+			continue;
+
 		for (j = 0; j < cp_lib_cfg.doms[i].npfs; j++) {
-			ctx.s.pf_idx = cp_lib_cfg.doms[i].pfs[j].idx;
-			ret = octep_cp_lib_recv_msg(&ctx, rx_msg, rx_num);
-			host_version = get_host_version(ctx.s.pem_idx, ctx.s.pf_idx);
-
-			if (host_version < cp_lib_cfg.min_version ||
-			    host_version > cp_lib_cfg.max_version)
-				host_version = 0;
-
-			for (m = 0; m < ret; m++) {
-				msg = &rx_msg[m];
-				(host_version) ? process_msg(&ctx, msg, host_version) :
-						 reply_error(&ctx, msg);
-				/* library will overwrite msg size in header so reset it */
-				msg->info.s.sz = max_msg_sz;
+			if (cp_lib_cfg.doms[i].pfs[j].idx == pf_idx) {
+				*dom_i = i;
+				*pf_j = j;
+				return 0;
 			}
 		}
 	}
 
+	return -ENOENT;
+}
+
+int loop_update_active()
+{
+	static struct octep_cp_active_pf lib_pfs[OCTEP_CP_DOM_MAX *
+						 OCTEP_CP_PF_PER_DOM_MAX];
+	static uint32_t versions[OCTEP_CP_DOM_MAX][OCTEP_CP_PF_PER_DOM_MAX];
+	int i, j, k, n;
+
+	n = octep_cp_lib_get_active_pfs(lib_pfs,
+					OCTEP_CP_DOM_MAX * OCTEP_CP_PF_PER_DOM_MAX);
+	if (n < 0)
+		return n;
+
+	memset(versions, 0, sizeof(versions));
+	num_active_pfs = 0;
+	for (k = 0; k < n; k++) {
+		if (find_pf(lib_pfs[k].dom_idx, lib_pfs[k].pf_idx, &i, &j))
+			continue;
+
+		versions[i][j] = lib_pfs[k].host_version;
+		active_pfs[num_active_pfs].dom_idx = i;
+		active_pfs[num_active_pfs].pf_idx = j;
+		num_active_pfs++;
+	}
+
+	for (i = 0; i < cp_lib_cfg.ndoms; i++) {
+		for (j = 0; j < cp_lib_cfg.doms[i].npfs; j++) {
+			if (versions[i][j] == host_versions[i][j])
+				continue;
+
+			/* pf locks of a suspended pem are already held */
+			if (!pem_suspended[i])
+				pthread_mutex_lock(&pf_locks[i][j].m);
+			host_versions[i][j] = versions[i][j];
+			drain_cycles[i][j] = 0;
+			if (!pem_suspended[i])
+				pthread_mutex_unlock(&pf_locks[i][j].m);
+		}
+	}
+
+	return num_active_pfs;
+}
+
+int loop_suspend_pem(int dom_idx)
+{
+	int j;
+
+	if (dom_idx < 0 || dom_idx >= OCTEP_CP_DOM_MAX)
+		return -EINVAL;
+
+	if (pem_suspended[dom_idx])
+		return 0;
+
+	/* waits for pf's being processed by other threads */
+	for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX; j++)
+		pthread_mutex_lock(&pf_locks[dom_idx][j].m);
+	pem_suspended[dom_idx] = true;
+
 	return 0;
 }
 
-int loop_uninit()
+int loop_resume_pem(int dom_idx)
 {
-	int i;
+	int j;
+
+	if (dom_idx < 0 || dom_idx >= OCTEP_CP_DOM_MAX)
+		return -EINVAL;
+
+	if (!pem_suspended[dom_idx])
+		return 0;
+
+	for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX; j++)
+		pthread_mutex_unlock(&pf_locks[dom_idx][j].m);
+	pem_suspended[dom_idx] = false;
+
+	return 0;
+}
+
+int loop_get_latency(enum loop_lat type, int cmd, struct app_hist *hist)
+{
+	struct loop_ctx *ctx;
 
-	for (i=0 ;i<rx_num; i++) {
-		if (rx_msg[i].sg_list[0].msg)
-			free(rx_msg[i].sg_list[0].msg);
-		rx_msg[i].sg_list[0].sz = 0;
+	if (type < 0 || type >= LOOP_LAT_MAX ||
+	    cmd < 0 || cmd >= OCTEP_CTRL_NET_H2F_CMD_MAX || !hist)
+		return -EINVAL;
+
+	memset(hist, 0, sizeof(struct app_hist));
+	pthread_mutex_lock(&ctx_list_lock);
+	for (ctx = ctx_list; ctx; ctx = ctx->next)
+		hist_merge(hist, &ctx->lat[type][cmd]);
+	pthread_mutex_unlock(&ctx_list_lock);
+
+	return 0;
+}
+
+int loop_process_sigusr1()
+{
+	static struct app_hist hist;
+	int type, cmd;
+
+	printf("Latency (ns)\n");
+	printf("%-12s %-8s %10s %10s %10s %10s %10s %10s\n",
+	       "cmd", "type", "count", "min", "p50", "p90", "p99", "max");
+	for (cmd = 0; cmd < OCTEP_CTRL_NET_H2F_CMD_MAX; cmd++) {
+		for (type = 0; type < LOOP_LAT_MAX; type++) {
+			if (loop_get_latency(type, cmd, &hist) || !hist.count)
+				continue;
+
+			printf("%-12s %-8s %10lu %10lu %10lu %10lu %10lu %10lu\n",
+			       cmd_names[cmd], lat_names[type], hist.count,
+			       cycles_to_ns(hist.min),
+			       cycles_to_ns(hist_percentile(&hist, 50)),
+			       cycles_to_ns(hist_percentile(&hist, 90)),
+			       cycles_to_ns(hist_percentile(&hist, 99)),
+			       cycles_to_ns(hist.max));
+		}
 	}
-	free(rx_msg);
+
+	return 0;
+}
+
+int loop_uninit()
+{
+	loop_ctx_free(main_ctx);
+	main_ctx = NULL;
+	num_active_pfs = 0;
 
 	memset(&host_versions,
 	       0,
 	       sizeof(uint32_t) * OCTEP_CP_DOM_MAX * OCTEP_CP_PF_PER_DOM_MAX);
+	memset(&drain_cycles,
+	       0,
+	       sizeof(uint64_t) * OCTEP_CP_DOM_MAX * OCTEP_CP_PF_PER_DOM_MAX);
 
 	return 0;
 }
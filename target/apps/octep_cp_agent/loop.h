@@ -4,6 +4,23 @@
 #ifndef __LOOP_H__
 #define __LOOP_H__
 
+/* Per thread message processing context */
+struct loop_ctx;
+struct app_hist;
+
+/* Latencies measured per command */
+enum loop_lat {
+	/* upper bound of time request waited in host-to-fw queue, from the
+	 * last receive which emptied the queue to start of processing.
+	 */
+	LOOP_LAT_RING,
+	/* time to handle request and build response */
+	LOOP_LAT_HANDLER,
+	/* time to send response */
+	LOOP_LAT_SEND,
+	LOOP_LAT_MAX
+};
+
 /* Initialize loop mode implementation.
  *
  * return value: 0 on success, -errno on failure.
@@ -16,13 +33,84 @@ int loop_init(int max_msgs);
  */
 int loop_init_pem(int dom_idx);
 
+/* Check if library has initialized a pem.
+ *
+ * return value: 1 if pem is initialized, 0 if it has not joined yet.
+ */
+int loop_pem_joined(int dom_idx);
+
 /* Process interrupts and host messages.
  *
- * return value: size of response in words on success, -errno on failure.
+ * return value: number of messages processed on success, -errno on failure.
  */
 int loop_process_msgs();
 
+/* Allocate message buffers for a thread processing pf's.
+ *
+ * Should be called after loop_init.
+ *
+ * return value: context on success, NULL on failure.
+ */
+struct loop_ctx *loop_ctx_alloc();
+
+/* Free context allocated by loop_ctx_alloc.
+ */
+void loop_ctx_free(struct loop_ctx *ctx);
+
+/* Process host messages of a pf.
+ *
+ * A pf can be processed by one thread at a time, different pf's can be
+ * processed concurrently using a context per thread. pf's of a suspended
+ * pem are skipped.
+ *
+ * @param ctx: context from loop_ctx_alloc.
+ * @param dom_idx: index of dom in library configuration.
+ * @param pf_idx: index of pf in library configuration dom.
+ *
+ * return value: number of messages processed on success, -errno on failure.
+ */
+int loop_process_pf(struct loop_ctx *ctx, int dom_idx, int pf_idx);
+
+/* Update pf's with a ready host from library.
+ *
+ * Only these pf's are polled for messages, should be called after host
+ * ready/gone events and pem reinitialization.
+ *
+ * return value: number of active pf's on success, -errno on failure.
+ */
+int loop_update_active();
+
+/* Suspend processing of pf's of a pem.
+ *
+ * Waits for pf's being processed by other threads. Suspend and resume
+ * should be called from the same thread.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int loop_suspend_pem(int dom_idx);
+
+/* Resume processing of pf's of a pem suspended by loop_suspend_pem.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int loop_resume_pem(int dom_idx);
+
+/* Get latency histogram of a command merged over all contexts.
+ *
+ * Values are in cycles, see cycles_to_ns.
+ *
+ * @param type: latency type.
+ * @param cmd: enum octep_ctrl_net_h2f_cmd, unknown commands are counted as
+ *             OCTEP_CTRL_NET_H2F_CMD_INVALID.
+ * @param hist: histogram to fill, owned by caller.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int loop_get_latency(enum loop_lat type, int cmd, struct app_hist *hist);
+
 /* Process user interrupt signal.
+ *
+ * Prints latency histograms of commands.
  *
  * return value: 0 on success, -errno on failure.
  */
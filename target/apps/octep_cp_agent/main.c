@@ -11,10 +11,18 @@
 #include <time.h>
 #include <getopt.h>
 #include <stdlib.h>
+#include <stdbool.h>
 
 #include "octep_cp_lib.h"
+#include "octep_cp_log.h"
+#include "cp_compat.h"
 #include "loop.h"
 #include "app_config.h"
+#include "app_poll.h"
+#include "app_timer.h"
+#include "app_worker.h"
+#include "app_hist.h"
+#include "app_cycles.h"
 
 /* Control plane version */
 #define CP_VERSION_MAJOR		1
@@ -26,86 +34,251 @@
 							  CP_VERSION_VARIANT))
 
 #define MAX_NUM_MSG			6
+/* Default hybrid poll spin time in usecs */
+#define POLL_SPIN_US			100
+/* Default hybrid poll first sleep time in usecs */
+#define POLL_MIN_SLEEP_US		10
+/* pem link check interval after perst, doubled from min to max while
+ * link is down
+ */
+#define PERST_RETRY_MIN_NS		100000ULL
+#define PERST_RETRY_MAX_NS		100000000ULL
+/* link recheck interval of a pem waiting to join, it is normally woken up
+ * by OCTEP_CP_EVENT_TYPE_PEM_UP
+ */
+#define PEM_JOIN_RETRY_NS		1000000000ULL
 
 static volatile int force_quit = 0;
-static volatile int perst[APP_CFG_PEM_MAX] = { 0 };
-static int hb_interval = 0;
+static volatile int print_stats = 0;
 struct octep_cp_lib_cfg cp_lib_cfg = { 0 };
 
-static timer_t tim;
-static struct itimerspec itim = { 0 };
+/* heartbeat timer of a pf */
+struct hb_timer {
+	struct app_timer timer;
+	/* index of dom in cp_lib_cfg */
+	int dom_idx;
+	/* index of pf in cp_lib_cfg dom */
+	int pf_idx;
+};
+static struct hb_timer hb_timers[OCTEP_CP_DOM_MAX][OCTEP_CP_PF_PER_DOM_MAX];
+/* heartbeats due in current timer tick */
+static struct octep_cp_event_info hb_ev[OCTEP_CP_DOM_MAX *
+					OCTEP_CP_PF_PER_DOM_MAX];
+static int num_hb_ev = 0;
+/* fds registered for library events */
+static int ev_fds[OCTEP_CP_DOM_MAX];
+static int num_ev_fds = 0;
+/* host status is rechecked by library while receiving events */
+static struct app_timer host_timer;
+static volatile int host_check = 0;
 static struct timespec cpu_yield_tspec = {
 	.tv_sec = 0,
 	.tv_nsec = 1 * 1000000
 };
 static int max_num_msg = MAX_NUM_MSG;
+static struct poll_cfg poll_cfg = {
+	.mode = POLL_MODE_HYBRID,
+	.spin_us = POLL_SPIN_US,
+	.min_sleep_us = POLL_MIN_SLEEP_US,
+};
 static struct octep_cp_event_info *ev;
+/* cpus of mailbox worker threads, none to process mailboxes in main loop */
+static int worker_cpus[WORKER_MAX];
+static int num_workers = 0;
+static struct octep_cp_log_cfg log_cfg;
+/* perst recovery time in cycles, from perst event to pem reinitialized */
+static struct app_hist perst_hist;
+
+/* perst recovery state of a pem */
+enum pem_state {
+	/* pem is serviced */
+	PEM_STATE_READY,
+	/* perst received, pem to be torn down */
+	PEM_STATE_RESETTING,
+	/* waiting for pem link to come back */
+	PEM_STATE_WAIT_LINK,
+	/* pem is reinitialized, mailboxes to be resumed */
+	PEM_STATE_INIT,
+};
 
-static int app_handle_perst(int dom_idx);
+/* Perst recovery of a pem, advanced from main loop so that other pem's are
+ * serviced while a pem is down. Indexed by domain in cp_lib_cfg, like
+ * heartbeat timers and loop state, events carry the pem index which is
+ * converted with find_dom.
+ */
+struct pem_perst {
+	enum pem_state state;
+	/* cycles at perst event, 0 for a pem joining late */
+	uint64_t start;
+	/* time of next link check and current check interval */
+	uint64_t retry_ns;
+	uint64_t retry_interval_ns;
+};
+static struct pem_perst pem_perst[OCTEP_CP_DOM_MAX];
+/* number of pem's in perst recovery or waiting to join */
+static int num_perst = 0;
+
+static int find_dom(int pem_idx);
+static void app_handle_perst(int dom_idx);
+static void app_handle_pem_up(int dom_idx);
+static int add_event_fds();
 
 static int process_events()
 {
-	int n, i, err;
+	bool update_active = false;
+	int n, i, dom_idx;
 
 	n = octep_cp_lib_recv_event(ev, max_num_msg);
 	if (n < 0)
 		return n;
 
 	for (i = 0; i < n; i++) {
-		if (ev[i].e == OCTEP_CP_EVENT_TYPE_PERST) {
-			printf("APP: Event: perst on dom[%d]\n",
-			       ev[i].u.perst.dom_idx);
-			err = app_handle_perst(ev[i].u.perst.dom_idx);
-			if (err) {
-				printf("APP: Unable to handle perst event on PEM %d!\n",
-				       ev[i].u.perst.dom_idx);
-				return err;
-			}
+		if (ev[i].e == OCTEP_CP_EVENT_TYPE_HOST_READY) {
+			OCTEP_CP_LOG(INFO, APP, "Event: host ready on pem[%d] pf[%d] version %x\n",
+				     ev[i].u.host.dom_idx, ev[i].u.host.pf_idx,
+				     ev[i].u.host.host_version);
+			update_active = true;
+		} else if (ev[i].e == OCTEP_CP_EVENT_TYPE_HOST_GONE) {
+			OCTEP_CP_LOG(INFO, APP, "Event: host gone on pem[%d] pf[%d]\n",
+				     ev[i].u.host.dom_idx, ev[i].u.host.pf_idx);
+			update_active = true;
+		} else if (ev[i].e == OCTEP_CP_EVENT_TYPE_PERST) {
+			OCTEP_CP_LOG(INFO, APP, "Event: perst on dom[%d]\n",
+				     ev[i].u.perst.dom_idx);
+			dom_idx = find_dom(ev[i].u.perst.dom_idx);
+			if (dom_idx >= 0)
+				app_handle_perst(dom_idx);
+		} else if (ev[i].e == OCTEP_CP_EVENT_TYPE_PEM_UP) {
+			OCTEP_CP_LOG(INFO, APP, "Event: pem up on dom[%d]\n",
+				     ev[i].u.pem_up.dom_idx);
+			dom_idx = find_dom(ev[i].u.pem_up.dom_idx);
+			if (dom_idx >= 0)
+				app_handle_pem_up(dom_idx);
 		}
 	}
+	if (update_active)
+		loop_update_active();
 
-	return 0;
+	return n;
 }
 
-static int send_heartbeat()
+static void host_timer_cb(void *arg)
 {
-	struct octep_cp_event_info info;
-	int i, j;
+	host_check = 1;
+}
 
-	info.e = OCTEP_CP_EVENT_TYPE_HEARTBEAT;
-	for (i=0; i<cp_lib_cfg.ndoms; i++) {
-		if (perst[i])
-			continue;
+static int event_fd_cb(int fd, void *arg)
+{
+	return process_events();
+}
+
+/* Watch library event fds, fall back to polling events if unavailable */
+static int add_event_fds()
+{
+	int i, ret;
+
+	for (i = 0; i < num_ev_fds; i++)
+		poll_del_fd(ev_fds[i]);
+	num_ev_fds = 0;
+
+	ret = octep_cp_lib_get_event_fds(ev_fds, OCTEP_CP_DOM_MAX);
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < ret; i++) {
+		if (poll_add_fd(ev_fds[i], event_fd_cb, NULL))
+			break;
+	}
+	num_ev_fds = i;
+
+	return (num_ev_fds == ret) ? 0 : -EINVAL;
+}
+
+static void heartbeat_cb(void *arg)
+{
+	struct hb_timer *hbt = (struct hb_timer *)arg;
+	struct octep_cp_event_info *info;
+
+	info = &hb_ev[num_hb_ev++];
+	info->e = OCTEP_CP_EVENT_TYPE_HEARTBEAT;
+	info->u.hbeat.dom_idx = cp_lib_cfg.doms[hbt->dom_idx].idx;
+	info->u.hbeat.pf_idx = cp_lib_cfg.doms[hbt->dom_idx].pfs[hbt->pf_idx].idx;
+}
+
+/* send heartbeats which fell due in the same timer tick in one batch */
+static void send_heartbeats()
+{
+	if (num_hb_ev)
+		octep_cp_lib_send_events(hb_ev, num_hb_ev);
 
-		info.u.hbeat.dom_idx = cp_lib_cfg.doms[i].idx;
-		for (j=0; j<cp_lib_cfg.doms[i].npfs; j++) {
-			info.u.hbeat.pf_idx = cp_lib_cfg.doms[i].pfs[j].idx;
-			octep_cp_lib_send_event(&info);
+	num_hb_ev = 0;
+}
+
+/* Start heartbeat timer of each pf at its configured interval */
+static int start_heartbeats()
+{
+	struct hb_timer *hbt;
+	struct fn_cfg *fn;
+	int i, j, err;
+
+	err = app_timer_init(send_heartbeats);
+	if (err)
+		return err;
+
+	for (i = 0; i < cp_lib_cfg.ndoms; i++) {
+		for (j = 0; j < cp_lib_cfg.doms[i].npfs; j++) {
+			fn = &cfg.pems[cp_lib_cfg.doms[i].idx].pfs[cp_lib_cfg.doms[i].pfs[j].idx].fn;
+			if (!fn->info.hb_interval)
+				continue;
+
+			hbt = &hb_timers[i][j];
+			hbt->dom_idx = i;
+			hbt->pf_idx = j;
+			err = app_timer_start(&hbt->timer, fn->info.hb_interval,
+					      heartbeat_cb, hbt);
+			if (err) {
+				app_timer_uninit();
+				return err;
+			}
+			OCTEP_CP_LOG(INFO, APP, "pem[%d] pf[%d] heartbeat interval : %u msecs\n",
+				     cp_lib_cfg.doms[i].idx,
+				     cp_lib_cfg.doms[i].pfs[j].idx,
+				     fn->info.hb_interval);
 		}
 	}
 
 	return 0;
 }
 
-static void trigger_alarm(int hb_interval)
+/* Park or unpark heartbeat timers of a pem */
+static void park_heartbeats(int dom_idx, bool park)
 {
-	itim.it_value.tv_sec = (hb_interval / 1000);
-	itim.it_value.tv_nsec = (hb_interval % 1000) * 1000000;
+	struct hb_timer *hbt;
+	int j;
 
-	timer_settime(tim, 0, &itim, NULL);
+	for (j = 0; j < cp_lib_cfg.doms[dom_idx].npfs; j++) {
+		hbt = &hb_timers[dom_idx][j];
+		if (!hbt->timer.cb)
+			continue;
+
+		if (park)
+			app_timer_park(&hbt->timer);
+		else
+			app_timer_unpark(&hbt->timer);
+	}
 }
 
 void sigint_handler(int sig_num) {
 
+	/* only async signal safe calls here, logging is not, as log rings
+	 * have a single writer and signal may be taken on any thread
+	 */
 	if (sig_num == SIGINT) {
-		printf("APP: Program quitting.\n");
 		force_quit = 1;
-	} else if (sig_num == SIGALRM) {
-		if (force_quit)
-			return;
-
-		send_heartbeat();
-		trigger_alarm(hb_interval);
+		poll_wakeup();
+	} else if (sig_num == SIGUSR1) {
+		print_stats = 1;
+		poll_wakeup();
 	}
 }
 
@@ -130,56 +303,235 @@ static int set_fw_ready(int ready)
 	int i;
 
 	for (i=0; i<cp_lib_cfg.ndoms; i++) {
+		/* pem's which have not joined are not initialized */
+		if (pem_perst[i].state != PEM_STATE_READY)
+			continue;
+
 		set_fw_ready_for_pem(i, ready);
 	}
 
 	return 0;
 }
 
-static int app_handle_perst(int dom_idx)
+static inline uint64_t get_time_ns()
 {
-	struct pem_cfg *pem;
-	int err;
+	struct timespec ts;
 
-	pem = &cfg.pems[dom_idx];
-	if (!pem->valid)
-		return -EINVAL;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
 
-	perst[dom_idx] = 1;
-	set_fw_ready_for_pem(dom_idx, 0);
-	octep_cp_lib_uninit_pem(dom_idx);
-	loop_uninit_pem(dom_idx);
-	printf("APP: Reinitiazing PEM %d\n", dom_idx);
+/* Advance perst recovery of a pem as far as it can go without waiting.
+ *
+ * return value: 1 if pem is ready again, 0 if recovery is in progress.
+ */
+static int advance_perst(int dom_idx)
+{
+	struct pem_perst *pp = &pem_perst[dom_idx];
+	int pem_idx = cp_lib_cfg.doms[dom_idx].idx;
+	uint64_t now;
+	int err;
 
-	err = octep_cp_lib_init_pem(&cp_lib_cfg, dom_idx);
-	if (err)
-		return err;
-	app_config_update_pem(dom_idx);
-	err = loop_init_pem(dom_idx);
-	if (err) {
+	switch (pp->state) {
+	case PEM_STATE_READY:
+		return 0;
+	case PEM_STATE_RESETTING:
+		/* heartbeats stay parked and mailboxes stay suspended until
+		 * pem is reinitialized.
+		 */
+		park_heartbeats(dom_idx, true);
+		loop_suspend_pem(dom_idx);
+		set_fw_ready_for_pem(dom_idx, 0);
 		octep_cp_lib_uninit_pem(dom_idx);
-		return err;
+		loop_uninit_pem(dom_idx);
+		/* pem event fds are closed by library */
+		add_event_fds();
+		OCTEP_CP_LOG(INFO, APP, "Reinitiazing PEM %d\n", pem_idx);
+		pp->state = PEM_STATE_WAIT_LINK;
+		pp->retry_ns = 0;
+		pp->retry_interval_ns = PERST_RETRY_MIN_NS;
+		/* fall through */
+	case PEM_STATE_WAIT_LINK:
+		now = get_time_ns();
+		if (now < pp->retry_ns)
+			return 0;
+
+		/* library sets fw ready of each pf as soon as its mailbox is
+		 * initialized, host requests wait in mailboxes until pem is
+		 * resumed
+		 */
+		err = octep_cp_lib_init_pem(&cp_lib_cfg, dom_idx);
+		if (err) {
+			if (err != -EAGAIN)
+				OCTEP_CP_LOG(ERR, APP, "Unable to reinitialize PEM %d (%d)\n",
+					     pem_idx, err);
+			pp->retry_ns = now + pp->retry_interval_ns;
+			if (!pp->start)
+				return 0;
+
+			pp->retry_interval_ns = ((pp->retry_interval_ns * 2) <
+						 PERST_RETRY_MAX_NS) ?
+						(pp->retry_interval_ns * 2) :
+						PERST_RETRY_MAX_NS;
+			return 0;
+		}
+		pp->state = PEM_STATE_INIT;
+		/* fall through */
+	case PEM_STATE_INIT:
+		app_config_update_pem(pem_idx);
+		err = loop_init_pem(dom_idx);
+		if (err) {
+			OCTEP_CP_LOG(ERR, APP, "Unable to resume PEM %d (%d)\n",
+				     pem_idx, err);
+			set_fw_ready_for_pem(dom_idx, 0);
+			octep_cp_lib_uninit_pem(dom_idx);
+			pp->state = PEM_STATE_WAIT_LINK;
+			pp->retry_ns = get_time_ns() + PERST_RETRY_MAX_NS;
+			return 0;
+		}
+		app_config_print_pem(pem_idx);
+		loop_update_active();
+		loop_resume_pem(dom_idx);
+		park_heartbeats(dom_idx, false);
+		/* pem event fds are reopened by library */
+		add_event_fds();
+		pp->state = PEM_STATE_READY;
+		num_perst--;
+		if (pp->start)
+			hist_add(&perst_hist, cp_get_cycles() - pp->start);
+		OCTEP_CP_LOG(INFO, APP, "PEM %d ready\n", pem_idx);
+		return 1;
 	}
-	app_config_print_pem(dom_idx);
-	set_fw_ready_for_pem(dom_idx, 1);
-	perst[dom_idx] = 0;
+
 	return 0;
 }
 
+/* Find domain of a pem in cp_lib_cfg.
+ *
+ * return value: domain index, -ENOENT if pem is not configured.
+ */
+static int find_dom(int pem_idx)
+{
+	int i;
+
+	for (i = 0; i < cp_lib_cfg.ndoms; i++) {
+		if (cp_lib_cfg.doms[i].idx == pem_idx)
+			return i;
+	}
+
+	return -ENOENT;
+}
+
+/* Start perst recovery of a domain */
+static void app_handle_perst(int dom_idx)
+{
+	struct pem_perst *pp = &pem_perst[dom_idx];
+
+	/* pem is already down, no events are reported for it until it is
+	 * reinitialized
+	 */
+	if (pp->state != PEM_STATE_READY)
+		return;
+
+	pp->state = PEM_STATE_RESETTING;
+	pp->start = cp_get_cycles();
+	num_perst++;
+	advance_perst(dom_idx);
+}
+
+/* Wait for a pem whose link was down at startup to join */
+static void wait_pem_up(int dom_idx)
+{
+	struct pem_perst *pp = &pem_perst[dom_idx];
+
+	OCTEP_CP_LOG(INFO, APP, "PEM %d link down, waiting for it to join\n",
+		     cp_lib_cfg.doms[dom_idx].idx);
+	park_heartbeats(dom_idx, true);
+	pp->state = PEM_STATE_WAIT_LINK;
+	pp->start = 0;
+	pp->retry_ns = get_time_ns() + PEM_JOIN_RETRY_NS;
+	pp->retry_interval_ns = PEM_JOIN_RETRY_NS;
+	num_perst++;
+}
+
+/* Initialize a late pem once its link is up */
+static void app_handle_pem_up(int dom_idx)
+{
+	struct pem_perst *pp = &pem_perst[dom_idx];
+
+	if (pp->state != PEM_STATE_WAIT_LINK)
+		return;
+
+	pp->retry_ns = 0;
+	advance_perst(dom_idx);
+}
+
+/* Advance perst recovery of all pem's.
+ *
+ * return value: number of pem's which became ready.
+ */
+static int process_perst()
+{
+	int i, n = 0;
+
+	for (i = 0; i < OCTEP_CP_DOM_MAX && num_perst; i++)
+		n += advance_perst(i);
+
+	return n;
+}
+
+static void print_perst_stats()
+{
+	struct app_hist *hist = &perst_hist;
+
+	if (!hist->count)
+		return;
+
+	printf("PERST recovery (ns)\n");
+	printf("%10s %10s %10s %10s %10s %10s\n",
+	       "count", "min", "p50", "p90", "p99", "max");
+	printf("%10lu %10lu %10lu %10lu %10lu %10lu\n",
+	       hist->count,
+	       cycles_to_ns(hist->min),
+	       cycles_to_ns(hist_percentile(hist, 50)),
+	       cycles_to_ns(hist_percentile(hist, 90)),
+	       cycles_to_ns(hist_percentile(hist, 99)),
+	       cycles_to_ns(hist->max));
+}
+
 /* display usage */
 static void print_usage(const char *prgname)
 {
 	printf("%s config_file\n"
 	       "  -y <milliseconds>\n"
 	       "    yield cpu for msecs between subsequent calls to msg poll (default: 1ms)\n"
+	       "    in sleep mode, max yield time in hybrid mode\n"
 	       "  -m <1-n>\n"
-	       "    Max control messages and events to be polled at one time (default: 6)\n",
-	       prgname);
+	       "    Max control messages and events to be polled at one time (default: 6)\n"
+	       "  -p <busy|hybrid|sleep>\n"
+	       "    Poll mode (default: hybrid)\n"
+	       "  -s <microseconds>\n"
+	       "    Keep polling for usecs after activity in hybrid mode (default: %u)\n"
+	       "  -b <microseconds>\n"
+	       "    First yield time after polling in hybrid mode, doubled on\n"
+	       "    every idle poll up to -y (default: %u)\n"
+	       "  -w <cpu list>\n"
+	       "    Process mailboxes in a worker thread pinned to each cpu,\n"
+	       "    eg: 2,3,8-11 (default: process in main loop)\n"
+	       "  -l <levels>\n"
+	       "    Log levels as <level> or <logtype>:<level>, comma separated,\n"
+	       "    eg: info,cnxk:debug,app:debug (default: info)\n",
+	       prgname, POLL_SPIN_US, POLL_MIN_SLEEP_US);
 }
 
 static const char short_options[] =
 	"y:"  /* cpu yield */
 	"m:"  /* max msg count */
+	"p:"  /* poll mode */
+	"s:"  /* hybrid poll spin time */
+	"b:"  /* hybrid poll first yield time */
+	"w:"  /* mailbox worker cpus */
+	"l:"  /* log levels */
 	;
 
 static const struct option lgopts[] = {
@@ -213,6 +565,41 @@ static int parse_args(int argc, char **argv)
 			if (max_num_msg <= 0)
 				max_num_msg = 6;
 
+			break;
+		case 'p':
+			ret = poll_get_mode(optarg);
+			if (ret < 0) {
+				print_usage(prgname);
+				return -1;
+			}
+			poll_cfg.mode = ret;
+
+			break;
+		case 's':
+			poll_cfg.spin_us = atoi(optarg);
+
+			break;
+		case 'b':
+			poll_cfg.min_sleep_us = atoi(optarg);
+			if (poll_cfg.min_sleep_us == 0)
+				poll_cfg.min_sleep_us = POLL_MIN_SLEEP_US;
+
+			break;
+		case 'w':
+			ret = worker_parse_cpus(optarg, worker_cpus, WORKER_MAX);
+			if (ret < 0) {
+				print_usage(prgname);
+				return -1;
+			}
+			num_workers = ret;
+
+			break;
+		case 'l':
+			if (octep_cp_log_set_levels(optarg)) {
+				print_usage(prgname);
+				return -1;
+			}
+
 			break;
 		default:
 			print_usage(prgname);
@@ -230,7 +617,7 @@ static int parse_args(int argc, char **argv)
 
 int main(int argc, char *argv[])
 {
-	int err = 0, src_i, src_j, dst_i, dst_j;
+	int err = 0, src_i, src_j, dst_i, dst_j, work, ret, i;
 	struct pem_cfg *pem;
 	struct pf_cfg *pf;
 
@@ -239,28 +626,47 @@ int main(int argc, char *argv[])
 		return -EINVAL;
 	}
 
+	/* keep logs off the console in message and event paths, start before
+	 * anything is logged so that all logs go to stdout
+	 */
+	log_cfg.out = stdout;
+	ret = octep_cp_log_init(&log_cfg);
+	if (ret)
+		OCTEP_CP_LOG(ERR, APP, "Unable to start buffered logging, err %d\n",
+			     ret);
+
 	err = app_config_init(argv[1]);
 	if (err)
-		return err;
+		goto lib_init_fail;
 
 	parse_args(argc, argv);
 	ev = calloc(max_num_msg, sizeof(struct octep_cp_event_info));
-	if (!ev)
-		return -ENOMEM;
+	if (!ev) {
+		err = -ENOMEM;
+		goto lib_init_fail;
+	}
 
 	signal(SIGINT, sigint_handler);
-	signal(SIGALRM, sigint_handler);
+	signal(SIGUSR1, sigint_handler);
+
+	OCTEP_CP_LOG(INFO, APP, "cpu yield time (-y) = %lds %ldns\n", cpu_yield_tspec.tv_sec,
+		     cpu_yield_tspec.tv_nsec);
+	OCTEP_CP_LOG(INFO, APP, "max control msgs/events per poll (-m) = %d\n", max_num_msg);
+
+	poll_cfg.max_sleep_us = (cpu_yield_tspec.tv_sec * 1000000) +
+				(cpu_yield_tspec.tv_nsec / 1000);
+	if (poll_cfg.min_sleep_us > poll_cfg.max_sleep_us)
+		poll_cfg.min_sleep_us = poll_cfg.max_sleep_us;
+	OCTEP_CP_LOG(INFO, APP, "poll mode (-p) = %s spin (-s) = %uus first yield (-b) = %uus\n",
+		     poll_get_mode_name(poll_cfg.mode), poll_cfg.spin_us,
+		     poll_cfg.min_sleep_us);
+	if (num_workers)
+		OCTEP_CP_LOG(INFO, APP, "mailbox workers (-w) = %d\n", num_workers);
 
-	timer_create(CLOCK_REALTIME, NULL, &tim);
-
-	printf("APP: cpu yield time (-y) = %lds %ldns\n", cpu_yield_tspec.tv_sec,
-							  cpu_yield_tspec.tv_nsec);
-	printf("APP: max control msgs/events per poll (-m) = %d\n", max_num_msg);
-
-	hb_interval = 0;
 	cp_lib_cfg.min_version = CP_VERSION_CURRENT;
 	cp_lib_cfg.max_version = CP_VERSION_CURRENT;
 	cp_lib_cfg.ndoms = cfg.npem;
+	memcpy(cp_lib_cfg.soc, cfg.soc_impl, sizeof(cp_lib_cfg.soc));
 	dst_i = 0;
 	for (src_i = 0; src_i < APP_CFG_PEM_MAX; src_i++) {
 		pem = &cfg.pems[src_i];
@@ -276,42 +682,126 @@ int main(int argc, char *argv[])
 				continue;
 
 			cp_lib_cfg.doms[dst_i].pfs[dst_j].idx = src_j;
-			if (hb_interval == 0 ||
-			    pf->fn.info.hb_interval < hb_interval)
-				hb_interval = pf->fn.info.hb_interval;
-
+			cp_lib_cfg.doms[dst_i].pfs[dst_j].mbox_sz = pf->mbox_sz;
+			cp_lib_cfg.doms[dst_i].pfs[dst_j].mbox_h2fq_pct =
+							pf->mbox_h2fq_pct;
+			cp_lib_cfg.doms[dst_i].pfs[dst_j].tx_backlog =
+							pf->tx_backlog;
+			cp_lib_cfg.doms[dst_i].pfs[dst_j].tx_backlog_policy =
+							pf->tx_backlog_policy;
+			cp_lib_cfg.doms[dst_i].pfs[dst_j].oei_coalesce_msgs =
+							pf->oei_coalesce_msgs;
+			cp_lib_cfg.doms[dst_i].pfs[dst_j].oei_coalesce_usecs =
+							pf->oei_coalesce_usecs;
+			cp_lib_cfg.doms[dst_i].pfs[dst_j].notify_debounce_usecs =
+							pf->notify_debounce_usecs;
 			dst_j++;
 		}
 		dst_i++;
 	}
+	/* each pem waits for its link up to the library timeout, in parallel
+	 * with other pem's, and pem's still down after it join once their
+	 * link comes up
+	 */
+	cp_lib_cfg.pem_nowait = 0;
+	cp_lib_cfg.pem_late_join = 1;
 	err = octep_cp_lib_init(&cp_lib_cfg);
 	if (err)
-		return err;
+		goto lib_init_fail;
+
+	/* reinitialization of pem's from main loop must not block it */
+	cp_lib_cfg.pem_nowait = 1;
 
 	app_config_update();
 	err = loop_init(max_num_msg);
 	if (err) {
 		octep_cp_lib_uninit();
-		return err;
+		goto lib_init_fail;
 	}
 
 	app_config_print();
-	printf("APP: Heartbeat interval : %u msecs\n", hb_interval);
+
+	err = poll_init(&poll_cfg);
+	if (err)
+		goto poll_init_fail;
+
+	err = start_heartbeats();
+	if (err)
+		goto hb_fail;
+
+	for (i = 0; i < cp_lib_cfg.ndoms; i++) {
+		if (!loop_pem_joined(i))
+			wait_pem_up(i);
+	}
+
+	/* events are not signalled on fds for host status changes */
+	err = app_timer_start(&host_timer, OCTEP_CP_HOST_CHECK_MS,
+			      host_timer_cb, NULL);
+	if (err)
+		goto host_timer_fail;
+
+	if (add_event_fds())
+		OCTEP_CP_LOG(INFO, APP, "Event fds unavailable, polling for events\n");
 
 	set_fw_ready(1);
-	trigger_alarm(hb_interval);
+	/* after initial bring up, pf's are let in as soon as they are
+	 * reinitialized on perst
+	 */
+	cp_lib_cfg.fw_ready_on_init = 1;
+	if (num_workers) {
+		err = worker_init(worker_cpus, num_workers, &poll_cfg);
+		if (err)
+			goto worker_fail;
+	}
 	while (!force_quit) {
-		loop_process_msgs();
-		process_events();
-		nanosleep(&cpu_yield_tspec, NULL);
+		work = 0;
+		ret = (num_workers) ? 0 : loop_process_msgs();
+		if (ret > 0)
+			work += ret;
+		if (!num_ev_fds || host_check) {
+			host_check = 0;
+			ret = process_events();
+			if (ret > 0)
+				work += ret;
+		}
+		/* pem's in perst recovery are checked on every poll, other
+		 * pem's are serviced meanwhile
+		 */
+		if (num_perst)
+			work += process_perst();
+		/* keep polling while host interrupts are deferred */
+		ret = octep_cp_lib_flush_intrs(0);
+		if (ret > 0)
+			work += ret;
+		poll_wait(work);
+		if (print_stats) {
+			poll_print_stats();
+			worker_print_stats();
+			loop_process_sigusr1();
+			print_perst_stats();
+			print_stats = 0;
+		}
 	}
+	OCTEP_CP_LOG(INFO, APP, "Program quitting.\n");
+	worker_print_stats();
+	worker_uninit();
+	octep_cp_lib_flush_intrs(1);
+worker_fail:
 	set_fw_ready(0);
-
+	poll_print_stats();
+	print_perst_stats();
+
+host_timer_fail:
+	app_timer_uninit();
+hb_fail:
+	poll_uninit();
+poll_init_fail:
 	octep_cp_lib_uninit();
 	loop_uninit();
 
-	timer_delete(tim);
 	app_config_uninit();
+lib_init_fail:
+	octep_cp_log_uninit();
 
-	return 0;
+	return err;
 }
@@ -0,0 +1,627 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "octep_cp_lib.h"
+#include "octep_cp_sim.h"
+#include "octep_ctrl_net.h"
+#include "octep_host_emu.h"
+#include "app_hist.h"
+
+/* Load generator for octep_cp_agent on simulated soc.
+ *
+ * Emulates host drivers of all pf's found in the simulated soc directory
+ * with octep_host_emu, sends a mix of octep_ctrl_net requests to the agent
+ * and measures response latency and agent cpu usage.
+ */
+
+#define NSEC_PER_USEC		1000ULL
+#define NSEC_PER_SEC		1000000000ULL
+
+#define LG_PF_MAX		(OCTEP_CP_DOM_MAX * OCTEP_CP_PF_PER_DOM_MAX)
+#define LG_THREAD_MAX		64
+/* responses polled at a time */
+#define LG_POLL_MAX		64
+/* time to wait for fw of a pf to be ready */
+#define LG_CONNECT_MS		1000
+/* time to wait for responses in flight at end of run */
+#define LG_DRAIN_NS		(100 * NSEC_PER_USEC * 1000)
+/* control plane version of emulated host drivers */
+#define LG_HOST_VERSION		OCTEP_CP_VERSION(1, 0, 0)
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+
+enum lg_mode {
+	/* keep a fixed number of requests outstanding per pf */
+	LG_MODE_CLOSED,
+	/* send requests at a fixed rate per pf */
+	LG_MODE_OPEN,
+};
+
+enum lg_cmd {
+	LG_CMD_MTU,
+	LG_CMD_MAC,
+	LG_CMD_STATS,
+	LG_CMD_LINK,
+	LG_CMD_INFO,
+	LG_CMD_MAX
+};
+
+#define LG_REQ_SZ(field)	(sizeof(union octep_ctrl_net_req_hdr) + \
+				 sizeof(((struct octep_ctrl_net_h2f_req *)0)->field))
+
+static const struct {
+	const char *name;
+	uint16_t cmd;
+	uint32_t sz;
+} cmds[LG_CMD_MAX] = {
+	[LG_CMD_MTU] = { "mtu", OCTEP_CTRL_NET_H2F_CMD_MTU, LG_REQ_SZ(mtu) },
+	[LG_CMD_MAC] = { "mac", OCTEP_CTRL_NET_H2F_CMD_MAC, LG_REQ_SZ(mac) },
+	[LG_CMD_STATS] = { "stats", OCTEP_CTRL_NET_H2F_CMD_GET_IF_STATS,
+			   sizeof(union octep_ctrl_net_req_hdr) },
+	[LG_CMD_LINK] = { "link", OCTEP_CTRL_NET_H2F_CMD_LINK_INFO,
+			  LG_REQ_SZ(link_info) },
+	[LG_CMD_INFO] = { "info", OCTEP_CTRL_NET_H2F_CMD_GET_INFO,
+			  sizeof(union octep_ctrl_net_req_hdr) },
+};
+
+/* outstanding request */
+struct lg_req {
+	/* nsecs at which request was due, latency is measured from here */
+	uint64_t due_ns;
+	enum lg_cmd cmd;
+};
+
+/* emulated pf host driver */
+struct lg_pf {
+	int pem_idx;
+	int pf_idx;
+	struct octep_host_emu *emu;
+	/* outstanding requests indexed by msg_id & req_mask */
+	struct lg_req *reqs;
+	/* open loop: time at which next request is due */
+	uint64_t next_ns;
+};
+
+/* per command counters */
+struct lg_cmd_stats {
+	uint64_t sent;
+	uint64_t done;
+	/* responses with a reply other than OCTEP_CTRL_NET_REPLY_OK */
+	uint64_t errors;
+	struct app_hist lat;
+};
+
+struct lg_thread {
+	pthread_t thread;
+	int idx;
+	unsigned int seed;
+	/* open loop: sends that were late because of outstanding limit */
+	uint64_t late;
+	/* polls which found fw not ready */
+	uint64_t disconnects;
+	struct lg_cmd_stats stats[LG_CMD_MAX];
+};
+
+static enum lg_mode mode = LG_MODE_CLOSED;
+static char sim_dir[PATH_MAX];
+static int max_pfs = LG_PF_MAX;
+static int num_threads = 1;
+/* closed loop: outstanding requests per pf */
+static uint32_t depth = 1;
+/* open loop: requests per second per pf */
+static double rate;
+static uint32_t max_pending = OCTEP_HOST_EMU_PENDING_DEF;
+static uint32_t duration_s = 10;
+/* cumulative command weights */
+static uint32_t mix[LG_CMD_MAX];
+
+static struct lg_pf pfs[LG_PF_MAX];
+static int num_pfs;
+static uint32_t req_mask;
+static pid_t agent_pid;
+static struct lg_thread threads[LG_THREAD_MAX];
+static uint64_t start_ns, end_ns;
+static volatile bool stop;
+
+static uint64_t get_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+static enum lg_cmd pick_cmd(struct lg_thread *t)
+{
+	uint32_t r;
+	int i;
+
+	r = rand_r(&t->seed) % mix[LG_CMD_MAX - 1];
+	for (i = 0; i < LG_CMD_MAX - 1; i++)
+		if (r < mix[i])
+			break;
+
+	return i;
+}
+
+static int send_req(struct lg_thread *t, struct lg_pf *pf, uint64_t due_ns)
+{
+	struct octep_ctrl_net_h2f_req req;
+	enum lg_cmd cmd;
+	uint16_t msg_id;
+	int err;
+
+	cmd = pick_cmd(t);
+	memset(&req, 0, sizeof(req));
+	req.hdr.s.cmd = cmds[cmd].cmd;
+	/* all commands are gets, agent state is not changed */
+	req.mtu.cmd = OCTEP_CTRL_NET_CMD_GET;
+	err = octep_host_emu_send(pf->emu, OCTEP_HOST_EMU_PF, &req,
+				  cmds[cmd].sz, &msg_id);
+	if (err)
+		return err;
+
+	pf->reqs[msg_id & req_mask].due_ns = due_ns;
+	pf->reqs[msg_id & req_mask].cmd = cmd;
+	t->stats[cmd].sent++;
+
+	return 0;
+}
+
+static void poll_pf(struct lg_thread *t, struct lg_pf *pf)
+{
+	struct octep_host_emu_resp resps[LG_POLL_MAX];
+	struct lg_cmd_stats *st;
+	struct lg_req *req;
+	int n, i;
+
+	n = octep_host_emu_poll(pf->emu, resps, LG_POLL_MAX);
+	if (n == -ENOTCONN) {
+		/* agent reinitialized mailbox, eg: on perst */
+		t->disconnects++;
+		octep_host_emu_connect(pf->emu, 0);
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		req = &pf->reqs[resps[i].msg_id & req_mask];
+		st = &t->stats[req->cmd];
+		st->done++;
+		if (resps[i].resp.hdr.s.reply != OCTEP_CTRL_NET_REPLY_OK)
+			st->errors++;
+		hist_add(&st->lat, resps[i].recv_ns - req->due_ns);
+	}
+}
+
+static void *lg_thread_fn(void *arg)
+{
+	struct lg_thread *t = arg;
+	uint64_t now, interval_ns, drain_ns;
+	struct lg_pf *pf;
+	int i;
+
+	interval_ns = (mode == LG_MODE_OPEN) ? (NSEC_PER_SEC / rate) : 0;
+	if (!interval_ns)
+		interval_ns = 1;
+	/* spread first requests of pf's over an interval */
+	for (i = t->idx; i < num_pfs; i += num_threads)
+		pfs[i].next_ns = start_ns + (rand_r(&t->seed) % interval_ns);
+
+	while (!stop) {
+		now = get_ns();
+		if (now >= end_ns)
+			break;
+
+		for (i = t->idx; i < num_pfs; i += num_threads) {
+			pf = &pfs[i];
+			poll_pf(t, pf);
+			if (mode == LG_MODE_CLOSED) {
+				while (octep_host_emu_pending(pf->emu) < depth &&
+				       !send_req(t, pf, get_ns()))
+					;
+				continue;
+			}
+
+			while (pf->next_ns <= now) {
+				if (octep_host_emu_pending(pf->emu) >= max_pending ||
+				    send_req(t, pf, pf->next_ns)) {
+					t->late++;
+					break;
+				}
+				pf->next_ns += interval_ns;
+			}
+		}
+	}
+
+	/* collect responses in flight */
+	drain_ns = get_ns() + LG_DRAIN_NS;
+	for (i = t->idx; i < num_pfs; i += num_threads) {
+		while (octep_host_emu_pending(pfs[i].emu) && get_ns() < drain_ns)
+			poll_pf(t, &pfs[i]);
+	}
+
+	return NULL;
+}
+
+/* Get cpu time of agent in clock ticks */
+static int get_agent_ticks(uint64_t *ticks)
+{
+	unsigned long utime, stime;
+	char path[64], buf[1024];
+	FILE *f;
+	char *p;
+	int n;
+
+	snprintf(path, sizeof(path), "/proc/%d/stat", agent_pid);
+	f = fopen(path, "r");
+	if (!f)
+		return -errno;
+
+	n = fread(buf, 1, sizeof(buf) - 1, f);
+	fclose(f);
+	buf[(n > 0) ? n : 0] = '\0';
+	/* process name may have spaces, fields are counted from its end */
+	p = strrchr(buf, ')');
+	if (!p)
+		return -EINVAL;
+
+	n = sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+		   &utime, &stime);
+	if (n != 2)
+		return -EINVAL;
+
+	*ticks = utime + stime;
+
+	return 0;
+}
+
+static int add_pf(const char *name)
+{
+	struct octep_host_emu_cfg cfg = { 0 };
+	char path[PATH_MAX * 2], bar4[PATH_MAX], oei[PATH_MAX];
+	int pem_idx, pf_idx, pid, fw_ready, end = 0, n;
+	unsigned long offset;
+	struct lg_pf *pf;
+	uint32_t sz;
+	FILE *f;
+
+	n = sscanf(name, "pem%d_pf%d%n", &pem_idx, &pf_idx, &end);
+	if (n != 2 || name[end] != '\0')
+		return 0;
+
+	snprintf(path, sizeof(path), "%s/%s", sim_dir, name);
+	f = fopen(path, "r");
+	if (!f)
+		return -errno;
+
+	n = fscanf(f, "%4095s %lu %u %d %4095s %d", bar4, &offset, &sz, &pid,
+		   oei, &fw_ready);
+	fclose(f);
+	if (n != 6)
+		return -EINVAL;
+
+	/* skip pf's left behind by an agent which is gone */
+	if (kill(pid, 0))
+		return 0;
+
+	if (agent_pid && pid != agent_pid) {
+		fprintf(stderr, "%s belongs to pid %d, agent is %d\n",
+			name, pid, agent_pid);
+		return 0;
+	}
+	agent_pid = pid;
+
+	pf = &pfs[num_pfs];
+	pf->pem_idx = pem_idx;
+	pf->pf_idx = pf_idx;
+	cfg.path = bar4;
+	cfg.offset = offset;
+	cfg.sz = sz;
+	cfg.version = LG_HOST_VERSION;
+	cfg.max_pending = max_pending;
+	cfg.oei_path = oei;
+	pf->emu = octep_host_emu_open(&cfg);
+	if (!pf->emu) {
+		fprintf(stderr, "pem[%d] pf[%d] %s open failed\n",
+			pem_idx, pf_idx, bar4);
+		return -EIO;
+	}
+	pf->reqs = calloc(req_mask + 1, sizeof(struct lg_req));
+	if (!pf->reqs) {
+		octep_host_emu_close(pf->emu);
+		return -ENOMEM;
+	}
+	n = octep_host_emu_connect(pf->emu, LG_CONNECT_MS);
+	if (n) {
+		fprintf(stderr, "pem[%d] pf[%d] connect failed (%d)\n",
+			pem_idx, pf_idx, n);
+		free(pf->reqs);
+		octep_host_emu_close(pf->emu);
+		return n;
+	}
+	num_pfs++;
+
+	return 0;
+}
+
+static int add_pfs()
+{
+	struct dirent *e;
+	DIR *dir;
+	int err = 0;
+
+	dir = opendir(sim_dir);
+	if (!dir) {
+		fprintf(stderr, "opendir %s failed (%d)\n", sim_dir, errno);
+		return -errno;
+	}
+	while ((e = readdir(dir)) != NULL && num_pfs < max_pfs) {
+		err = add_pf(e->d_name);
+		if (err)
+			break;
+	}
+	closedir(dir);
+
+	return err;
+}
+
+static void remove_pfs()
+{
+	int i;
+
+	for (i = 0; i < num_pfs; i++) {
+		octep_host_emu_disconnect(pfs[i].emu);
+		octep_host_emu_close(pfs[i].emu);
+		free(pfs[i].reqs);
+	}
+	num_pfs = 0;
+}
+
+static void print_row(const char *name, struct lg_cmd_stats *st, double secs)
+{
+	printf("%-6s %12lu %12lu %8lu %12.0f %9.1f %9.1f %9.1f %9.1f\n",
+	       name, st->sent, st->done, st->errors, st->done / secs,
+	       hist_percentile(&st->lat, 50) / 1000.0,
+	       hist_percentile(&st->lat, 99) / 1000.0,
+	       hist_percentile(&st->lat, 99.9) / 1000.0,
+	       st->lat.max / 1000.0);
+}
+
+static void print_report(double secs, uint64_t agent_ticks)
+{
+	struct lg_cmd_stats total = { 0 }, cmd;
+	uint64_t late = 0, disconnects = 0, oei = 0;
+	struct octep_host_emu_stats emu_stats;
+	int i, c;
+
+	printf("\n%-6s %12s %12s %8s %12s %9s %9s %9s %9s\n",
+	       "cmd", "sent", "done", "errors", "resps/s",
+	       "p50_us", "p99_us", "p999_us", "max_us");
+	for (c = 0; c < LG_CMD_MAX; c++) {
+		memset(&cmd, 0, sizeof(cmd));
+		for (i = 0; i < num_threads; i++) {
+			cmd.sent += threads[i].stats[c].sent;
+			cmd.done += threads[i].stats[c].done;
+			cmd.errors += threads[i].stats[c].errors;
+			hist_merge(&cmd.lat, &threads[i].stats[c].lat);
+		}
+		if (!cmd.sent)
+			continue;
+
+		print_row(cmds[c].name, &cmd, secs);
+		total.sent += cmd.sent;
+		total.done += cmd.done;
+		total.errors += cmd.errors;
+		hist_merge(&total.lat, &cmd.lat);
+	}
+	print_row("total", &total, secs);
+
+	for (i = 0; i < num_threads; i++) {
+		late += threads[i].late;
+		disconnects += threads[i].disconnects;
+	}
+	for (i = 0; i < num_pfs; i++)
+		if (!octep_host_emu_get_stats(pfs[i].emu, &emu_stats))
+			oei += emu_stats.rx_oei;
+	printf("\npfs %d, %.2f secs, %lu timed out\n", num_pfs, secs,
+	       total.sent - total.done);
+	printf("oei interrupts %lu, %.2f per response\n", oei,
+	       (total.done) ? (double)oei / total.done : 0.0);
+	if (mode == LG_MODE_OPEN)
+		printf("late sends %lu (outstanding limit %u per pf)\n",
+		       late, max_pending);
+	if (disconnects)
+		printf("fw not ready %lu times\n", disconnects);
+	printf("agent pid %d cpu %.1f%%\n", agent_pid,
+	       (agent_ticks * 100.0) / (sysconf(_SC_CLK_TCK) * secs));
+}
+
+static int parse_mix(char *str)
+{
+	uint32_t weights[LG_CMD_MAX] = { 0 };
+	char *tok, *save, *val;
+	int c, sum = 0;
+
+	for (tok = strtok_r(str, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		val = strchr(tok, '=');
+		if (val)
+			*val++ = '\0';
+		for (c = 0; c < LG_CMD_MAX; c++)
+			if (!strcmp(tok, cmds[c].name))
+				break;
+		if (c == LG_CMD_MAX)
+			return -EINVAL;
+		weights[c] = (val) ? atoi(val) : 1;
+	}
+	for (c = 0; c < LG_CMD_MAX; c++) {
+		sum += weights[c];
+		mix[c] = sum;
+	}
+
+	return (sum > 0) ? 0 : -EINVAL;
+}
+
+static void sigint_handler(int sig_num)
+{
+	stop = true;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [options]\n"
+	       "  -d <dir> simulated soc directory (default: $%s or %s)\n"
+	       "  -n <num> max pf's to emulate (default: all pf's of agent, max %d)\n"
+	       "  -c <cmd[=weight],...> command mix of mtu, mac, stats, link, info\n"
+	       "     (default: mtu,mac,stats,link,info with equal weights)\n"
+	       "  -m <closed|open> closed: keep -o requests outstanding per pf,\n"
+	       "     open: send -r requests per sec per pf (default: closed)\n"
+	       "  -o <num> outstanding requests per pf in closed loop (default: 1)\n"
+	       "  -r <rate> requests per sec per pf in open loop\n"
+	       "  -q <num> max outstanding requests per pf (default: %d)\n"
+	       "  -t <secs> duration (default: 10)\n"
+	       "  -j <num> threads, pf's are distributed over threads (default: 1)\n",
+	       prog, OCTEP_CP_SIM_DIR_ENV, OCTEP_CP_SIM_DIR_DEF, LG_PF_MAX,
+	       OCTEP_HOST_EMU_PENDING_DEF);
+}
+
+static int parse_args(int argc, char **argv)
+{
+	char mix_def[] = "mtu,mac,stats,link,info";
+	const char *dir;
+	int opt;
+
+	dir = getenv(OCTEP_CP_SIM_DIR_ENV);
+	snprintf(sim_dir, sizeof(sim_dir), "%s",
+		 (dir && dir[0]) ? dir : OCTEP_CP_SIM_DIR_DEF);
+	parse_mix(mix_def);
+	while ((opt = getopt(argc, argv, "d:n:c:m:o:r:q:t:j:h")) != -1) {
+		switch (opt) {
+		case 'd':
+			snprintf(sim_dir, sizeof(sim_dir), "%s", optarg);
+			break;
+		case 'n':
+			max_pfs = atoi(optarg);
+			break;
+		case 'c':
+			if (parse_mix(optarg))
+				return -EINVAL;
+			break;
+		case 'm':
+			if (!strcmp(optarg, "open"))
+				mode = LG_MODE_OPEN;
+			else if (!strcmp(optarg, "closed"))
+				mode = LG_MODE_CLOSED;
+			else
+				return -EINVAL;
+			break;
+		case 'o':
+			depth = atoi(optarg);
+			break;
+		case 'r':
+			rate = atof(optarg);
+			break;
+		case 'q':
+			max_pending = atoi(optarg);
+			break;
+		case 't':
+			duration_s = atoi(optarg);
+			break;
+		case 'j':
+			num_threads = atoi(optarg);
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	if (max_pfs < 1 || max_pfs > LG_PF_MAX)
+		max_pfs = LG_PF_MAX;
+	if (num_threads < 1 || num_threads > LG_THREAD_MAX)
+		return -EINVAL;
+	if (!max_pending || max_pending > OCTEP_HOST_EMU_PENDING_MAX)
+		return -EINVAL;
+	if (mode == LG_MODE_OPEN && rate <= 0)
+		return -EINVAL;
+	if (mode == LG_MODE_CLOSED && (!depth || depth > max_pending))
+		return -EINVAL;
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t ticks0 = 0, ticks1 = 0;
+	double secs;
+	int err, i;
+
+	if (parse_args(argc, argv)) {
+		usage(argv[0]);
+		return -EINVAL;
+	}
+
+	/* same slot size as octep_host_emu */
+	req_mask = 1;
+	while (req_mask < max_pending)
+		req_mask <<= 1;
+	req_mask--;
+
+	signal(SIGINT, sigint_handler);
+	err = add_pfs();
+	if (err || !num_pfs) {
+		fprintf(stderr, "No pf's of a running agent in %s\n", sim_dir);
+		remove_pfs();
+		return (err) ? err : -ENODEV;
+	}
+	if (num_threads > num_pfs)
+		num_threads = num_pfs;
+
+	if (mode == LG_MODE_OPEN)
+		printf("open loop, %.0f requests/sec per pf", rate);
+	else
+		printf("closed loop, %u outstanding requests per pf", depth);
+	printf(", %d pf's, %d threads, %u secs\n", num_pfs, num_threads,
+	       duration_s);
+
+	/* agent checks host status every OCTEP_CP_HOST_CHECK_MS */
+	usleep(2 * OCTEP_CP_HOST_CHECK_MS * 1000);
+
+	get_agent_ticks(&ticks0);
+	start_ns = get_ns();
+	end_ns = start_ns + (duration_s * NSEC_PER_SEC);
+	for (i = 0; i < num_threads; i++) {
+		threads[i].idx = i;
+		threads[i].seed = start_ns + i;
+		err = pthread_create(&threads[i].thread, NULL, lg_thread_fn,
+				     &threads[i]);
+		if (err) {
+			stop = true;
+			num_threads = i;
+			break;
+		}
+	}
+	for (i = 0; i < num_threads; i++)
+		pthread_join(threads[i].thread, NULL);
+	secs = (get_ns() - start_ns) / (double)NSEC_PER_SEC;
+	get_agent_ticks(&ticks1);
+
+	print_report(secs, ticks1 - ticks0);
+	remove_pfs();
+
+	return err;
+}
@@ -0,0 +1,451 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+
+/* Control mailbox microbenchmark.
+ *
+ * Runs octep_ctrl_mbox_send and octep_ctrl_mbox_recv of the fw side of a
+ * mailbox in a memfd, for each bar memory access method. Host side of the
+ * mailbox is emulated with a second struct octep_ctrl_mbox on the same
+ * memory with queues swapped, which fills host-to-fw queue before recv and
+ * drains fw-to-host queue after send outside of timed sections.
+ *
+ * Every combination of access method, operation, queue pattern, message
+ * size, sg_num and batch size is run for a fixed time and printed as a csv
+ * line on stdout.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "octep_ctrl_mbox.h"
+#include "cp_compat.h"
+
+/* bar memory offset of mailbox in memfd, barmem 0 is invalid */
+#define BENCH_BARMEM_OFFSET	4096
+/* default mailbox size, same as a pf mailbox in hardware */
+#define BENCH_BARMEM_SZ_DEF	32768
+/* default time per case in msecs */
+#define BENCH_TIME_MS_DEF	10
+/* max timed batches per case */
+#define BENCH_ITER_MAX		200000
+/* max messages per batch */
+#define BENCH_BATCH_MAX		64
+/* max size of a sg buffer */
+#define BENCH_SG_SZ_MAX		UINT16_MAX
+
+#define BENCH_HDR_SZ		sizeof(union octep_ctrl_mbox_msg_hdr)
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+
+enum bench_op {
+	BENCH_OP_SEND,
+	BENCH_OP_RECV,
+	BENCH_OP_MAX
+};
+
+enum bench_pattern {
+	/* queue indices advance and roll over naturally */
+	BENCH_PATTERN_SEQ,
+	/* every batch rolls over the end of queue at an unaligned offset */
+	BENCH_PATTERN_WRAP,
+	BENCH_PATTERN_MAX
+};
+
+static const char *access_names[] = {
+	[OCTEP_CTRL_MBOX_ACCESS_FD] = "fd",
+	[OCTEP_CTRL_MBOX_ACCESS_MMAP] = "mmap",
+	[OCTEP_CTRL_MBOX_ACCESS_FD_VEC] = "fd_vec",
+};
+
+static const char *op_names[BENCH_OP_MAX] = {
+	[BENCH_OP_SEND] = "send",
+	[BENCH_OP_RECV] = "recv",
+};
+
+static const char *pattern_names[BENCH_PATTERN_MAX] = {
+	[BENCH_PATTERN_SEQ] = "seq",
+	[BENCH_PATTERN_WRAP] = "wrap",
+};
+
+static const int batch_sizes[] = { 1, 4, 16, 64 };
+
+/* benchmark state */
+struct bench {
+	/* memfd with bar memory */
+	int fd;
+	/* mapping of memfd */
+	uint8_t *va;
+	size_t map_sz;
+	/* fw side of mailbox, access method under test */
+	struct octep_ctrl_mbox fw;
+	/* host side of mailbox, mmap access */
+	struct octep_ctrl_mbox host;
+	/* message data */
+	uint8_t *data;
+	/* message buffers, BENCH_BATCH_MAX * size of largest message */
+	uint8_t *bufs;
+	struct octep_ctrl_mbox_msg msgs[BENCH_BATCH_MAX];
+	/* batch durations in nsecs */
+	uint64_t *samples;
+	/* cost of reading clock twice in nsecs */
+	uint64_t clock_ns;
+};
+
+/* options */
+static uint32_t barmem_sz = BENCH_BARMEM_SZ_DEF;
+static uint32_t time_ms = BENCH_TIME_MS_DEF;
+static int access_sel = -1;
+
+static inline uint64_t get_time_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static uint64_t calibrate_clock()
+{
+	uint64_t t0, t1, min = UINT64_MAX;
+	int i;
+
+	for (i = 0; i < 10000; i++) {
+		t0 = get_time_ns();
+		t1 = get_time_ns();
+		if (t1 - t0 < min)
+			min = t1 - t0;
+	}
+
+	return min;
+}
+
+static inline volatile uint32_t *q_idx(struct bench *b, uint64_t addr)
+{
+	return (volatile uint32_t *)(b->va + addr);
+}
+
+/* Set producer and consumer index of an empty queue */
+static inline void q_reset(struct bench *b, struct octep_ctrl_mbox_q *q,
+			   uint32_t idx)
+{
+	*q_idx(b, q->hw_prod) = idx;
+	*q_idx(b, q->hw_cons) = idx;
+}
+
+/* Mark all messages in a queue as consumed */
+static inline void q_drain(struct bench *b, struct octep_ctrl_mbox_q *q)
+{
+	*q_idx(b, q->hw_cons) = *q_idx(b, q->hw_prod);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int bench_open(struct bench *b, enum octep_ctrl_mbox_access access)
+{
+	struct octep_ctrl_mbox *fw = &b->fw;
+	int err;
+
+	b->map_sz = BENCH_BARMEM_OFFSET + barmem_sz;
+	b->fd = memfd_create("mbox_bench", 0);
+	if (b->fd < 0)
+		return -errno;
+	if (ftruncate(b->fd, b->map_sz)) {
+		close(b->fd);
+		return -errno;
+	}
+	b->va = mmap(NULL, b->map_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+		     b->fd, 0);
+	if (b->va == MAP_FAILED) {
+		close(b->fd);
+		return -errno;
+	}
+
+	memset(fw, 0, sizeof(*fw));
+	fw->min_version = 1;
+	fw->max_version = 1;
+	fw->barmem = BENCH_BARMEM_OFFSET;
+	fw->barmem_sz = barmem_sz;
+	fw->bar4_fd = b->fd;
+	fw->access = access;
+	fw->barmem_va = b->va + BENCH_BARMEM_OFFSET;
+	err = octep_ctrl_mbox_init(fw);
+	if (err) {
+		munmap(b->va, b->map_sz);
+		close(b->fd);
+		return err;
+	}
+
+	/* host ready */
+	*(volatile uint64_t *)(b->va +
+		OCTEP_CTRL_MBOX_INFO_HOST_VERSION(fw->barmem)) = 1;
+	*(volatile uint64_t *)(b->va +
+		OCTEP_CTRL_MBOX_INFO_HOST_STATUS(fw->barmem)) =
+					OCTEP_CTRL_MBOX_STATUS_READY;
+	octep_ctrl_mbox_check_host(fw);
+
+	/* host sends on fw h2fq and receives on fw f2hq */
+	b->host = *fw;
+	b->host.access = OCTEP_CTRL_MBOX_ACCESS_MMAP;
+	b->host.h2fq = fw->f2hq;
+	b->host.f2hq = fw->h2fq;
+	b->host.h2fq.shadow = NULL;
+	b->host.f2hq.shadow = NULL;
+
+	return 0;
+}
+
+static void bench_close(struct bench *b)
+{
+	octep_ctrl_mbox_uninit(&b->fw);
+	munmap(b->va, b->map_sz);
+	close(b->fd);
+}
+
+/* Describe sz bytes of each message in batch, split over sg_num buffers */
+static void setup_msgs(struct bench *b, uint32_t sz, int sg_num, int batch,
+		       bool tx)
+{
+	struct octep_ctrl_mbox_msg *msg;
+	uint32_t off, seg;
+	int m, s;
+
+	for (m = 0; m < batch; m++) {
+		msg = &b->msgs[m];
+		memset(&msg->hdr, 0, sizeof(msg->hdr));
+		msg->hdr.s.flags = OCTEP_CTRL_MBOX_MSG_HDR_FLAG_REQ;
+		msg->hdr.s.sz = sz;
+		msg->hdr.s.msg_id = m;
+		msg->sg_num = sg_num;
+		for (s = 0, off = 0; s < sg_num; s++) {
+			seg = (s < sg_num - 1) ? sz / sg_num : sz - off;
+			msg->sg_list[s].sz = seg;
+			msg->sg_list[s].msg = (tx) ? (b->data + off) :
+					      (b->bufs + ((size_t)m * sz) + off);
+			off += seg;
+		}
+	}
+}
+
+/* Queue index at which a batch of bytes rolls over the end of queue */
+static inline uint32_t wrap_idx(struct octep_ctrl_mbox_q *q, uint32_t bytes)
+{
+	uint32_t back = (bytes / 2) | 4;
+
+	return (back < q->sz) ? (q->sz - back) : 0;
+}
+
+static int run_case(struct bench *b, enum bench_op op,
+		    enum bench_pattern pattern, uint32_t sz, int sg_num,
+		    int batch)
+{
+	uint64_t t0, t1, end, total = 0, syscalls, p50, p99;
+	struct octep_ctrl_mbox_q *q;
+	uint32_t bytes;
+	double secs;
+	long iter;
+	int n, m;
+
+	bytes = batch * (sz + BENCH_HDR_SZ);
+	q = (op == BENCH_OP_SEND) ? &b->fw.f2hq : &b->fw.h2fq;
+	q_reset(b, q, 0);
+	if (op == BENCH_OP_SEND)
+		setup_msgs(b, sz, sg_num, batch, true);
+	syscalls = b->fw.nsyscalls;
+	end = get_time_ns() + (time_ms * 1000000ULL);
+	for (iter = 0; iter < BENCH_ITER_MAX; iter++) {
+		if (pattern == BENCH_PATTERN_WRAP)
+			q_reset(b, q, wrap_idx(q, bytes));
+
+		if (op == BENCH_OP_SEND) {
+			t0 = get_time_ns();
+			n = octep_ctrl_mbox_send(&b->fw, b->msgs, batch);
+			t1 = get_time_ns();
+			q_drain(b, q);
+		} else {
+			setup_msgs(b, sz, sg_num, batch, true);
+			n = octep_ctrl_mbox_send(&b->host, b->msgs, batch);
+			if (n != batch) {
+				fprintf(stderr, "host send %d of %d\n", n, batch);
+				return -EIO;
+			}
+			setup_msgs(b, sz, sg_num, batch, false);
+			t0 = get_time_ns();
+			n = octep_ctrl_mbox_recv(&b->fw, b->msgs, batch);
+			t1 = get_time_ns();
+			for (m = 0; m < n; m++) {
+				if (b->msgs[m].hdr.s.sz != sz ||
+				    b->msgs[m].hdr.s.msg_id != m) {
+					fprintf(stderr, "corrupt message %d\n", m);
+					return -EIO;
+				}
+			}
+		}
+		if (n != batch) {
+			fprintf(stderr, "%s %d of %d\n", op_names[op], n, batch);
+			return -EIO;
+		}
+
+		t1 -= t0;
+		b->samples[iter] = (t1 > b->clock_ns) ? (t1 - b->clock_ns) : 0;
+		total += b->samples[iter];
+		if (t0 >= end)
+			break;
+	}
+	if (iter < BENCH_ITER_MAX)
+		iter++;
+	syscalls = b->fw.nsyscalls - syscalls;
+
+	qsort(b->samples, iter, sizeof(b->samples[0]), cmp_u64);
+	p50 = b->samples[(iter * 50) / 100];
+	p99 = b->samples[(iter * 99) / 100];
+	n = iter * batch;
+	secs = (total) ? (total / 1e9) : 1e-9;
+	printf("%s,%s,%s,%u,%d,%d,%d,%.0f,%.0f,%.1f,%lu,%lu,%.2f\n",
+	       access_names[b->fw.access], op_names[op],
+	       pattern_names[pattern], sz, sg_num, batch, n,
+	       n / secs, ((double)n * sz) / secs, (double)total / n,
+	       p50, p99, (double)syscalls / n);
+
+	return 0;
+}
+
+/* Run all message sizes, sg_num's and batch sizes of an operation */
+static int run_op(struct bench *b, enum bench_op op,
+		  enum bench_pattern pattern, uint32_t space)
+{
+	uint32_t sz, max_sz;
+	int sg_num, i, err;
+
+	max_sz = space - BENCH_HDR_SZ;
+	for (sz = 16; sz; sz = (sz == max_sz) ? 0 : cp_min(sz * 4, max_sz)) {
+		for (sg_num = 1; sg_num <= OCTEP_CTRL_MBOX_MSG_DESC_MAX; sg_num++) {
+			if (sz > (uint32_t)sg_num * BENCH_SG_SZ_MAX)
+				continue;
+
+			for (i = 0; i < ARRAY_SIZE(batch_sizes); i++) {
+				if (batch_sizes[i] * (sz + BENCH_HDR_SZ) > space)
+					break;
+
+				err = run_case(b, op, pattern, sz, sg_num,
+					       batch_sizes[i]);
+				if (err)
+					return err;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int run_access(enum octep_ctrl_mbox_access access)
+{
+	int op, pattern, i, err;
+	uint32_t space;
+	struct bench b;
+
+	err = bench_open(&b, access);
+	if (err) {
+		fprintf(stderr, "%s mailbox init failed (%d)\n",
+			access_names[access], err);
+		return err;
+	}
+
+	/* queues hold one byte less than their size */
+	space = cp_min(b.fw.h2fq.sz, b.fw.f2hq.sz) - 1;
+	b.data = calloc(1, space);
+	b.bufs = calloc(BENCH_BATCH_MAX, space);
+	b.samples = calloc(BENCH_ITER_MAX, sizeof(uint64_t));
+	if (!b.data || !b.bufs || !b.samples) {
+		err = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < space; i++)
+		b.data[i] = i;
+	b.clock_ns = calibrate_clock();
+
+	for (op = 0; op < BENCH_OP_MAX; op++) {
+		for (pattern = 0; pattern < BENCH_PATTERN_MAX; pattern++) {
+			err = run_op(&b, op, pattern, space);
+			if (err)
+				goto out;
+		}
+	}
+
+out:
+	free(b.samples);
+	free(b.bufs);
+	free(b.data);
+	bench_close(&b);
+
+	return err;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-a fd|fd_vec|mmap] [-s mbox size] [-t msecs]\n"
+	       "  -a access method to run, default all\n"
+	       "  -s mailbox size in bytes, default %u\n"
+	       "  -t time per case in msecs, default %u\n",
+	       prog, BENCH_BARMEM_SZ_DEF, BENCH_TIME_MS_DEF);
+}
+
+int main(int argc, char **argv)
+{
+	int opt, a, err;
+
+	while ((opt = getopt(argc, argv, "a:s:t:h")) != -1) {
+		switch (opt) {
+		case 'a':
+			for (a = 0; a < ARRAY_SIZE(access_names); a++)
+				if (!strcmp(optarg, access_names[a]))
+					access_sel = a;
+			if (access_sel < 0) {
+				usage(argv[0]);
+				return -EINVAL;
+			}
+			break;
+		case 's':
+			barmem_sz = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			time_ms = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return (opt == 'h') ? 0 : -EINVAL;
+		}
+	}
+	if (barmem_sz < 512) {
+		fprintf(stderr, "mailbox size %u below minimum 512\n", barmem_sz);
+		return -EINVAL;
+	}
+
+	printf("access,op,pattern,msg_sz,sg_num,batch,msgs,msgs_per_s,"
+	       "bytes_per_s,ns_per_msg,p50_ns_per_batch,p99_ns_per_batch,"
+	       "syscalls_per_msg\n");
+	for (a = 0; a < ARRAY_SIZE(access_names); a++) {
+		if (access_sel >= 0 && a != access_sel)
+			continue;
+		err = run_access(a);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
@@ -0,0 +1,277 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+
+/* Control mailbox reserve/commit checks.
+ *
+ * Runs octep_ctrl_mbox_send_reserve and octep_ctrl_mbox_send_commit of the
+ * fw side of a mailbox in a memfd with other sends in between, such as a
+ * notification sent from another thread while a response is built in
+ * place. Host side of the mailbox is a second struct octep_ctrl_mbox on the
+ * same memory with queues swapped, which receives what fw published.
+ *
+ * Prints each check and exits with non-zero status if any check fails.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "octep_ctrl_mbox.h"
+#include "cp_compat.h"
+
+/* bar memory offset of mailbox in memfd, barmem 0 is invalid */
+#define CHECK_BARMEM_OFFSET	4096
+#define CHECK_BARMEM_SZ		32768
+/* size of messages */
+#define CHECK_MSG_SZ		64
+#define CHECK_RESP_BYTE		0xa5
+#define CHECK_NOTIFY_BYTE	0x5a
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+
+struct check {
+	/* memfd with bar memory */
+	int fd;
+	/* mapping of memfd */
+	uint8_t *va;
+	size_t map_sz;
+	/* fw side of mailbox */
+	struct octep_ctrl_mbox fw;
+	/* host side of mailbox */
+	struct octep_ctrl_mbox host;
+};
+
+static int failures;
+
+static int check_open(struct check *c, enum octep_ctrl_mbox_access access)
+{
+	struct octep_ctrl_mbox *fw = &c->fw;
+	int err;
+
+	c->map_sz = CHECK_BARMEM_OFFSET + CHECK_BARMEM_SZ;
+	c->fd = memfd_create("mbox_check", 0);
+	if (c->fd < 0)
+		return -errno;
+	if (ftruncate(c->fd, c->map_sz)) {
+		close(c->fd);
+		return -errno;
+	}
+	c->va = mmap(NULL, c->map_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+		     c->fd, 0);
+	if (c->va == MAP_FAILED) {
+		close(c->fd);
+		return -errno;
+	}
+
+	memset(fw, 0, sizeof(*fw));
+	fw->min_version = 1;
+	fw->max_version = 1;
+	fw->barmem = CHECK_BARMEM_OFFSET;
+	fw->barmem_sz = CHECK_BARMEM_SZ;
+	fw->bar4_fd = c->fd;
+	fw->access = access;
+	fw->barmem_va = c->va + CHECK_BARMEM_OFFSET;
+	err = octep_ctrl_mbox_init(fw);
+	if (err) {
+		munmap(c->va, c->map_sz);
+		close(c->fd);
+		return err;
+	}
+
+	/* host ready */
+	*(volatile uint64_t *)(c->va +
+		OCTEP_CTRL_MBOX_INFO_HOST_VERSION(fw->barmem)) = 1;
+	*(volatile uint64_t *)(c->va +
+		OCTEP_CTRL_MBOX_INFO_HOST_STATUS(fw->barmem)) =
+					OCTEP_CTRL_MBOX_STATUS_READY;
+	octep_ctrl_mbox_check_host(fw);
+
+	/* host sends on fw h2fq and receives on fw f2hq */
+	c->host = *fw;
+	c->host.access = OCTEP_CTRL_MBOX_ACCESS_MMAP;
+	c->host.h2fq = fw->f2hq;
+	c->host.f2hq = fw->h2fq;
+	c->host.h2fq.shadow = NULL;
+	c->host.f2hq.shadow = NULL;
+
+	return 0;
+}
+
+static void check_close(struct check *c)
+{
+	octep_ctrl_mbox_uninit(&c->fw);
+	munmap(c->va, c->map_sz);
+	close(c->fd);
+}
+
+static void expect(bool ok, const char *access, const char *what)
+{
+	printf("%-6s %-50s %s\n", access, what, (ok) ? "ok" : "FAILED");
+	if (!ok)
+		failures++;
+}
+
+/* Fill reserved space of msg with byte b */
+static void fill_reserved(struct octep_ctrl_mbox_msg *msg, uint8_t b)
+{
+	int s;
+
+	for (s = 0; s < msg->sg_num; s++)
+		memset(msg->sg_list[s].msg, b, msg->sg_list[s].sz);
+}
+
+/* Send a notification of CHECK_MSG_SZ bytes of CHECK_NOTIFY_BYTE */
+static int send_notify(struct check *c)
+{
+	static uint8_t data[CHECK_MSG_SZ];
+	struct octep_ctrl_mbox_msg msg = { 0 };
+
+	memset(data, CHECK_NOTIFY_BYTE, sizeof(data));
+	msg.hdr.s.flags = OCTEP_CTRL_MBOX_MSG_HDR_FLAG_NOTIFY;
+	msg.hdr.s.sz = sizeof(data);
+	msg.sg_num = 1;
+	msg.sg_list[0].sz = sizeof(data);
+	msg.sg_list[0].msg = data;
+
+	return octep_ctrl_mbox_send(&c->fw, &msg, 1);
+}
+
+/* Receive messages published to host and check their flags and data.
+ *
+ * @param flags: expected header flags of each message.
+ * @param num: number of expected messages.
+ */
+static bool host_recv(struct check *c, const uint16_t *flags, int num)
+{
+	uint8_t bufs[4][CHECK_MSG_SZ], b;
+	struct octep_ctrl_mbox_msg msgs[4];
+	int m, n, i;
+
+	memset(msgs, 0, sizeof(msgs));
+	for (m = 0; m < ARRAY_SIZE(msgs); m++) {
+		msgs[m].sg_num = 1;
+		msgs[m].sg_list[0].sz = CHECK_MSG_SZ;
+		msgs[m].sg_list[0].msg = bufs[m];
+	}
+	n = octep_ctrl_mbox_recv(&c->host, msgs, ARRAY_SIZE(msgs));
+	if (n < 0)
+		n = 0;
+	if (n != num)
+		return false;
+
+	for (m = 0; m < n; m++) {
+		if (msgs[m].hdr.s.flags != flags[m] ||
+		    msgs[m].hdr.s.sz != CHECK_MSG_SZ)
+			return false;
+
+		b = (flags[m] == OCTEP_CTRL_MBOX_MSG_HDR_FLAG_RESP) ?
+		    CHECK_RESP_BYTE : CHECK_NOTIFY_BYTE;
+		for (i = 0; i < CHECK_MSG_SZ; i++)
+			if (bufs[m][i] != b)
+				return false;
+	}
+
+	return true;
+}
+
+static void init_resp(struct octep_ctrl_mbox_msg *msg)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->hdr.s.flags = OCTEP_CTRL_MBOX_MSG_HDR_FLAG_RESP;
+	msg->hdr.s.sz = CHECK_MSG_SZ;
+}
+
+static int run_access(enum octep_ctrl_mbox_access access, const char *name)
+{
+	static const uint16_t resp[] = { OCTEP_CTRL_MBOX_MSG_HDR_FLAG_RESP };
+	static const uint16_t notify[] = { OCTEP_CTRL_MBOX_MSG_HDR_FLAG_NOTIFY };
+	struct octep_ctrl_mbox_msg msg, msg2;
+	struct check c;
+	int err, ret;
+
+	err = check_open(&c, access);
+	if (err) {
+		fprintf(stderr, "%s mailbox init failed (%d)\n", name, err);
+		return err;
+	}
+
+	/* response built in place is published */
+	init_resp(&msg);
+	ret = octep_ctrl_mbox_send_reserve(&c.fw, &msg);
+	expect(!ret, name, "reserve");
+	if (!ret)
+		fill_reserved(&msg, CHECK_RESP_BYTE);
+	ret = octep_ctrl_mbox_send_commit(&c.fw, &msg);
+	expect(!ret, name, "commit");
+	expect(host_recv(&c, resp, 1), name, "host receives response");
+
+	/* notification lands between reserve and commit */
+	init_resp(&msg);
+	ret = octep_ctrl_mbox_send_reserve(&c.fw, &msg);
+	expect(!ret, name, "reserve before notification");
+	if (!ret)
+		fill_reserved(&msg, CHECK_RESP_BYTE);
+	expect(send_notify(&c) == 1, name, "notification after reserve");
+	ret = octep_ctrl_mbox_send_commit(&c.fw, &msg);
+	expect(ret == -ESTALE, name, "commit after notification is stale");
+	expect(host_recv(&c, notify, 1), name,
+	       "host receives notification only");
+
+	/* second reserve drops first */
+	init_resp(&msg);
+	init_resp(&msg2);
+	ret = octep_ctrl_mbox_send_reserve(&c.fw, &msg);
+	expect(!ret, name, "first reserve");
+	ret = octep_ctrl_mbox_send_reserve(&c.fw, &msg2);
+	expect(!ret, name, "second reserve");
+	if (!ret)
+		fill_reserved(&msg2, CHECK_RESP_BYTE);
+	ret = octep_ctrl_mbox_send_commit(&c.fw, &msg2);
+	expect(!ret, name, "commit of second reserve");
+	ret = octep_ctrl_mbox_send_commit(&c.fw, &msg);
+	expect(ret == -ESTALE, name, "commit of first reserve is stale");
+	expect(host_recv(&c, resp, 1), name, "host receives one response");
+
+	/* commit without reserve */
+	init_resp(&msg);
+	ret = octep_ctrl_mbox_send_commit(&c.fw, &msg);
+	expect(ret == -ESTALE, name, "commit without reserve is stale");
+
+	/* commit larger than reserve */
+	init_resp(&msg);
+	msg.hdr.s.sz = CHECK_MSG_SZ / 2;
+	ret = octep_ctrl_mbox_send_reserve(&c.fw, &msg);
+	expect(!ret, name, "reserve of half size");
+	msg.hdr.s.sz = CHECK_MSG_SZ;
+	ret = octep_ctrl_mbox_send_commit(&c.fw, &msg);
+	expect(ret == -EINVAL, name, "commit larger than reserve fails");
+	expect(host_recv(&c, resp, 0), name, "host receives nothing");
+
+	check_close(&c);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int err;
+
+	/* reserve is not supported for OCTEP_CTRL_MBOX_ACCESS_FD */
+	err = run_access(OCTEP_CTRL_MBOX_ACCESS_MMAP, "mmap");
+	if (!err)
+		err = run_access(OCTEP_CTRL_MBOX_ACCESS_FD_VEC, "fd_vec");
+	if (err)
+		return err;
+
+	printf("%d checks failed\n", failures);
+
+	return (failures) ? 1 : 0;
+}
@@ -6,6 +6,8 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
 
 #define CP_ETHER_ADDR_LEN		6 /**< Length of Ethernet address. */
 #define CP_ETHER_GROUP_ADDR		0x01 /**< Mcast or bcast Eth. addr. */
@@ -94,6 +96,52 @@ cp_write64(uint64_t value, volatile void *addr)
 	cp_write64_relaxed(value, addr);
 }
 
+/* Copy from io memory, using aligned 64 bit accesses where possible */
+static inline void
+cp_memcpy_fromio(void *dst, const volatile void *src, size_t count)
+{
+	const volatile uint8_t *s = src;
+	uint8_t *d = dst;
+	uint64_t val;
+
+	while (count && ((uintptr_t)s & 0x7)) {
+		*d++ = *s++;
+		count--;
+	}
+	while (count >= 8) {
+		val = cp_read64_relaxed(s);
+		memcpy(d, &val, 8);
+		s += 8;
+		d += 8;
+		count -= 8;
+	}
+	while (count--)
+		*d++ = *s++;
+}
+
+/* Copy to io memory, using aligned 64 bit accesses where possible */
+static inline void
+cp_memcpy_toio(volatile void *dst, const void *src, size_t count)
+{
+	volatile uint8_t *d = dst;
+	const uint8_t *s = src;
+	uint64_t val;
+
+	while (count && ((uintptr_t)d & 0x7)) {
+		*d++ = *s++;
+		count--;
+	}
+	while (count >= 8) {
+		memcpy(&val, s, 8);
+		cp_write64_relaxed(val, d);
+		s += 8;
+		d += 8;
+		count -= 8;
+	}
+	while (count--)
+		*d++ = *s++;
+}
+
 static inline void
 cp_eth_random_addr(uint8_t *addr)
 {
@@ -110,8 +158,7 @@ cp_read32_fd(uint64_t addr, int fd)
 {
 	uint32_t val;
 
-	lseek(fd, addr, SEEK_SET);
-	read(fd, &val, 4);
+	pread(fd, &val, 4, addr);
 
 	return val;
 }
@@ -121,8 +168,7 @@ cp_read64_fd(uint64_t addr, int fd)
 {
 	uint64_t val;
 
-	lseek(fd, addr, SEEK_SET);
-	read(fd, &val, 8);
+	pread(fd, &val, 8, addr);
 
 	return val;
 }
@@ -130,30 +176,31 @@ cp_read64_fd(uint64_t addr, int fd)
 static __cp_always_inline size_t
 cp_read_fd(void* buf, size_t count, uint64_t addr, int fd)
 {
-	lseek(fd, addr, SEEK_SET);
-
-	return read(fd, buf, count);
+	return pread(fd, buf, count, addr);
 }
 
 static __cp_always_inline void
 cp_write32_fd(uint32_t value, uint64_t addr, int fd)
 {
-	lseek(fd, addr, SEEK_SET);
-	write(fd, &value, 4);
+	pwrite(fd, &value, 4, addr);
 }
 
 static __cp_always_inline void
 cp_write64_fd(uint64_t value, uint64_t addr, int fd)
 {
-	lseek(fd, addr, 0);
-	write(fd, &value, 8);
+	pwrite(fd, &value, 8, addr);
 }
 
 static __cp_always_inline void
 cp_write_fd(void* buf, size_t count, uint64_t addr, int fd)
 {
-	lseek(fd, addr, SEEK_SET);
-	write(fd, buf, count);
+	pwrite(fd, buf, count, addr);
+}
+
+static __cp_always_inline void
+cp_writev_fd(const struct iovec *iov, int iovcnt, uint64_t addr, int fd)
+{
+	pwritev(fd, iov, iovcnt, addr);
 }
 
 #endif /* __CP_COMPAT_H__ */
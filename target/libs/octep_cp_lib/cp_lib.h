@@ -14,6 +14,7 @@
 enum cp_lib_soc {
         CP_LIB_SOC_OTX2,
         CP_LIB_SOC_CNXK,
+        CP_LIB_SOC_SIM,
         CP_LIB_SOC_MAX
 };
 
@@ -67,13 +68,37 @@ struct cp_lib_soc_ops {
 	/* send notification to host */
 	int (*send_notification)(union octep_cp_msg_info *ctx,
 				 struct octep_cp_msg* msg);
+	/* send notification to a set of pf functions */
+	int (*send_notification_fanout)(union octep_cp_msg_info *ctx,
+					struct octep_cp_msg *msg,
+					const struct octep_cp_fn_set *fns);
 	/* receive messages from host*/
 	int (*recv_msg)(union octep_cp_msg_info *ctx,
 			struct octep_cp_msg *msg, int num);
+	/* peek at messages from host without copying */
+	int (*recv_msg_peek)(union octep_cp_msg_info *ctx,
+			     struct octep_cp_msg *msg, int num);
+	/* consume peeked messages */
+	int (*recv_msg_commit)(union octep_cp_msg_info *ctx,
+			       struct octep_cp_msg *msg, int num);
+	/* reserve space for message response to host */
+	int (*send_msg_resp_reserve)(union octep_cp_msg_info *ctx,
+				     struct octep_cp_msg *msg);
+	/* send message response built in reserved space */
+	int (*send_msg_resp_commit)(union octep_cp_msg_info *ctx,
+				    struct octep_cp_msg *msg);
 	/* send event to host */
 	int (*send_event)(struct octep_cp_event_info *info);
+	/* send batch of events to host */
+	int (*send_events)(struct octep_cp_event_info *info, int num);
 	/* receive soc events */
 	int (*recv_event)(struct octep_cp_event_info *info, int num);
+	/* get fds which signal pending soc events */
+	int (*get_event_fds)(int *fds, int num);
+	/* get pf's with a ready host */
+	int (*get_active_pfs)(struct octep_cp_active_pf *pfs, int num);
+	/* raise deferred interrupts, send held notifications */
+	int (*flush_intrs)(int force);
 	/* uninitialize pem */
 	int (*uninit_pem)(int dom_idx);
 	/* uninitialize */
@@ -86,12 +111,15 @@ extern enum cp_lib_soc soc;
 
 /* Get soc ops.
  *
- * @param mode: mode to be used.
+ * soc is selected by OCTEP_CP_SOC_ENV in environment or cfg->soc, and
+ * detected if neither is set.
+ *
+ * @param cfg: non-null pointer to library configuration.
  * @param ops: non-null pointer to struct soc_ops* to be filled by soc impl.
  *
  * return value: 0 on success, -errno on failure.
  */
-int soc_get_ops(struct cp_lib_soc_ops **ops);
+int soc_get_ops(struct octep_cp_lib_cfg *cfg, struct cp_lib_soc_ops **ops);
 
 /* Get soc model.
  *
@@ -0,0 +1,777 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "octep_cp_log.h"
+
+#define NSEC_PER_MSEC		1000000ULL
+#define NSEC_PER_SEC		1000000000ULL
+
+#define CP_LOG_CACHE_LINE_SZ	128
+#define CP_LOG_SPEC_MAX		32
+
+/* Argument type of a conversion specification */
+enum cp_log_arg {
+	CP_LOG_ARG_INT,
+	CP_LOG_ARG_LONG,
+	CP_LOG_ARG_LLONG,
+	CP_LOG_ARG_SIZE,
+	CP_LOG_ARG_INTMAX,
+	CP_LOG_ARG_PTRDIFF,
+	CP_LOG_ARG_DOUBLE,
+	CP_LOG_ARG_STR,
+	CP_LOG_ARG_PTR,
+	/* "%%", consumes no argument */
+	CP_LOG_ARG_PCT,
+	/* unsupported, record is truncated here */
+	CP_LOG_ARG_BAD
+};
+
+/* Binary log record, format pointer identifies the log */
+struct cp_log_rec {
+	uint64_t ts_ns;
+	const char *fmt;
+	uint16_t nargs;
+	uint16_t slen;
+	bool truncated;
+	/* integers, doubles, pointers and offsets of strings in str */
+	uint64_t args[OCTEP_CP_LOG_ARGS_MAX];
+	char str[OCTEP_CP_LOG_STR_MAX];
+};
+
+/* Single producer single consumer ring of a logging thread, freed only by
+ * its owner thread
+ */
+struct cp_log_ring {
+	struct cp_log_ring *next;
+	/* ring is on list of flushed rings, protected by flush_lock */
+	bool listed;
+	uint32_t mask;
+	struct cp_log_rec *recs;
+	/* written by owner thread */
+	uint32_t head __attribute__((aligned(CP_LOG_CACHE_LINE_SZ)));
+	uint64_t drops;
+	/* written by flusher */
+	uint32_t tail __attribute__((aligned(CP_LOG_CACHE_LINE_SZ)));
+};
+
+__attribute__((visibility("default")))
+volatile uint32_t octep_cp_log_levels[OCTEP_CP_LOGTYPE_MAX] = {
+	[0 ... OCTEP_CP_LOGTYPE_MAX - 1] = OCTEP_CP_LOG_LEVEL_DEFAULT
+};
+
+static const char *level_names[] = {
+	[OCTEP_CP_LOG_EMERG] = "emerg",
+	[OCTEP_CP_LOG_ALERT] = "alert",
+	[OCTEP_CP_LOG_CRIT] = "crit",
+	[OCTEP_CP_LOG_ERR] = "err",
+	[OCTEP_CP_LOG_WARNING] = "warning",
+	[OCTEP_CP_LOG_NOTICE] = "notice",
+	[OCTEP_CP_LOG_INFO] = "info",
+	[OCTEP_CP_LOG_DEBUG] = "debug"
+};
+
+static const char *type_names[OCTEP_CP_LOGTYPE_MAX] = {
+	[OCTEP_CP_LOGTYPE_LIB] = "lib",
+	[OCTEP_CP_LOGTYPE_CONFIG] = "config",
+	[OCTEP_CP_LOGTYPE_LOOP] = "loop",
+	[OCTEP_CP_LOGTYPE_NIC] = "nic",
+	[OCTEP_CP_LOGTYPE_SOC] = "soc",
+	[OCTEP_CP_LOGTYPE_CNXK] = "cnxk",
+	[OCTEP_CP_LOGTYPE_PLUGIN_SERVER] = "plugin_server",
+	[OCTEP_CP_LOGTYPE_PLUGIN_CLIENT] = "plugin_client",
+	[OCTEP_CP_LOGTYPE_APP] = "app"
+};
+
+static struct octep_cp_log_cfg log_cfg;
+/* buffered logging is active, writers check it before using their ring */
+static int log_started = 0;
+/* bumped on every init, invalidates rings cached by threads */
+static uint32_t log_gen = 0;
+/* list of rings flushed while logging is active */
+static struct cp_log_ring *rings = NULL;
+/* frees ring of an exiting thread, never deleted as rings of live threads
+ * outlive octep_cp_log_uninit
+ */
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static int ring_key_err;
+
+/* serializes flushes and changes to list of rings */
+static pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t reported_drops = 0;
+/* drops of rings removed from list */
+static uint64_t unlisted_drops = 0;
+
+/* flusher thread */
+static pthread_t flusher;
+static pthread_mutex_t flusher_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flusher_cond;
+static bool flusher_quit;
+
+static __thread struct cp_log_ring *tls_ring = NULL;
+static __thread uint32_t tls_gen = 0;
+
+static inline uint64_t get_time_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+/* Parse conversion specification after '%', return end of specification */
+static const char *parse_spec(const char *p, enum cp_log_arg *type,
+			      int *stars)
+{
+	int len = 0;
+
+	*stars = 0;
+	while (*p && strchr("-+ #0'", *p))
+		p++;
+	if (*p == '*') {
+		(*stars)++;
+		p++;
+	}
+	while (*p >= '0' && *p <= '9')
+		p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			(*stars)++;
+			p++;
+		}
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+
+	switch (*p) {
+	case 'h':
+		p += (p[1] == 'h') ? 2 : 1;
+		break;
+	case 'l':
+		len = (p[1] == 'l') ? 'q' : 'l';
+		p += (p[1] == 'l') ? 2 : 1;
+		break;
+	case 'q':
+	case 'L':
+	case 'j':
+	case 'z':
+	case 't':
+		len = *p++;
+		break;
+	default:
+		break;
+	}
+
+	switch (*p) {
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'c':
+		if (len == 'l')
+			*type = CP_LOG_ARG_LONG;
+		else if (len == 'q' || len == 'L')
+			*type = CP_LOG_ARG_LLONG;
+		else if (len == 'z')
+			*type = CP_LOG_ARG_SIZE;
+		else if (len == 'j')
+			*type = CP_LOG_ARG_INTMAX;
+		else if (len == 't')
+			*type = CP_LOG_ARG_PTRDIFF;
+		else
+			*type = CP_LOG_ARG_INT;
+		break;
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		*type = (len == 'L') ? CP_LOG_ARG_BAD : CP_LOG_ARG_DOUBLE;
+		break;
+	case 's':
+		*type = (len) ? CP_LOG_ARG_BAD : CP_LOG_ARG_STR;
+		break;
+	case 'p':
+		*type = CP_LOG_ARG_PTR;
+		break;
+	case '%':
+		*type = CP_LOG_ARG_PCT;
+		break;
+	default:
+		*type = CP_LOG_ARG_BAD;
+		return p;
+	}
+
+	return p + 1;
+}
+
+/* Copy arguments as per format into record */
+static void encode_rec(struct cp_log_rec *rec, const char *format, va_list ap)
+{
+	enum cp_log_arg type;
+	const char *p, *s;
+	int stars;
+	size_t len;
+	uint64_t v;
+	double d;
+
+	rec->fmt = format;
+	rec->nargs = 0;
+	rec->slen = 0;
+	rec->truncated = false;
+	for (p = format; *p; ) {
+		if (*p++ != '%')
+			continue;
+
+		p = parse_spec(p, &type, &stars);
+		if (type == CP_LOG_ARG_PCT)
+			continue;
+		if (type == CP_LOG_ARG_BAD ||
+		    (rec->nargs + stars + 1) > OCTEP_CP_LOG_ARGS_MAX) {
+			rec->truncated = true;
+			break;
+		}
+
+		while (stars--)
+			rec->args[rec->nargs++] = (int64_t)va_arg(ap, int);
+
+		switch (type) {
+		case CP_LOG_ARG_INT:
+			v = (int64_t)va_arg(ap, int);
+			break;
+		case CP_LOG_ARG_LONG:
+			v = (int64_t)va_arg(ap, long);
+			break;
+		case CP_LOG_ARG_LLONG:
+			v = (int64_t)va_arg(ap, long long);
+			break;
+		case CP_LOG_ARG_SIZE:
+			v = va_arg(ap, size_t);
+			break;
+		case CP_LOG_ARG_INTMAX:
+			v = (int64_t)va_arg(ap, intmax_t);
+			break;
+		case CP_LOG_ARG_PTRDIFF:
+			v = (int64_t)va_arg(ap, ptrdiff_t);
+			break;
+		case CP_LOG_ARG_DOUBLE:
+			d = va_arg(ap, double);
+			memcpy(&v, &d, sizeof(v));
+			break;
+		case CP_LOG_ARG_STR:
+			s = va_arg(ap, const char *);
+			if (!s)
+				s = "(null)";
+			/* out of space strings point at end of buffer */
+			v = OCTEP_CP_LOG_STR_MAX;
+			if (rec->slen < OCTEP_CP_LOG_STR_MAX) {
+				len = strnlen(s, OCTEP_CP_LOG_STR_MAX -
+					      rec->slen - 1);
+				memcpy(&rec->str[rec->slen], s, len);
+				rec->str[rec->slen + len] = '\0';
+				v = rec->slen;
+				rec->slen += len + 1;
+			}
+			break;
+		default:
+			v = (uintptr_t)va_arg(ap, void *);
+			break;
+		}
+		rec->args[rec->nargs++] = v;
+	}
+	rec->ts_ns = get_time_ns();
+}
+
+/* Print record as per its format */
+static void decode_rec(struct cp_log_rec *rec, FILE *out)
+{
+	char spec[CP_LOG_SPEC_MAX];
+	enum cp_log_arg type;
+	const char *p, *q, *end;
+	int i = 0, n, stars;
+	uint64_t v;
+	double d;
+
+	p = rec->fmt;
+	while (*p) {
+		q = strchr(p, '%');
+		if (!q) {
+			fputs(p, out);
+			break;
+		}
+		fwrite(p, 1, q - p, out);
+
+		end = parse_spec(q + 1, &type, &stars);
+		p = end;
+		if (type == CP_LOG_ARG_PCT) {
+			fputc('%', out);
+			continue;
+		}
+		if (type == CP_LOG_ARG_BAD || (i + stars + 1) > rec->nargs)
+			break;
+
+		/* replace '*' width and precision with recorded values */
+		n = 0;
+		for (; q < end && n < (CP_LOG_SPEC_MAX - 12); q++) {
+			if (*q == '*')
+				n += sprintf(&spec[n], "%d", (int)rec->args[i++]);
+			else
+				spec[n++] = *q;
+		}
+		spec[n] = '\0';
+
+		v = rec->args[i++];
+		switch (type) {
+		case CP_LOG_ARG_INT:
+			fprintf(out, spec, (int)v);
+			break;
+		case CP_LOG_ARG_LONG:
+			fprintf(out, spec, (long)v);
+			break;
+		case CP_LOG_ARG_LLONG:
+			fprintf(out, spec, (long long)v);
+			break;
+		case CP_LOG_ARG_SIZE:
+			fprintf(out, spec, (size_t)v);
+			break;
+		case CP_LOG_ARG_INTMAX:
+			fprintf(out, spec, (intmax_t)v);
+			break;
+		case CP_LOG_ARG_PTRDIFF:
+			fprintf(out, spec, (ptrdiff_t)v);
+			break;
+		case CP_LOG_ARG_DOUBLE:
+			memcpy(&d, &v, sizeof(d));
+			fprintf(out, spec, d);
+			break;
+		case CP_LOG_ARG_STR:
+			fprintf(out, spec, (v < rec->slen) ? &rec->str[v] : "");
+			break;
+		default:
+			fprintf(out, spec, (void *)(uintptr_t)v);
+			break;
+		}
+	}
+	if (rec->truncated)
+		fputs("...\n", out);
+}
+
+/* Remove ring from list, called with flush_lock held */
+static void unlist_ring(struct cp_log_ring *ring)
+{
+	struct cp_log_ring **prev;
+
+	for (prev = &rings; *prev; prev = &(*prev)->next) {
+		if (*prev == ring) {
+			*prev = ring->next;
+			break;
+		}
+	}
+	unlisted_drops += __atomic_load_n(&ring->drops, __ATOMIC_RELAXED);
+	ring->listed = false;
+}
+
+static void free_ring(struct cp_log_ring *ring)
+{
+	free(ring->recs);
+	free(ring);
+}
+
+static int flush_rings(FILE *out);
+
+/* Flush and free ring of an exiting thread */
+static void release_ring(void *arg)
+{
+	struct cp_log_ring *ring = (struct cp_log_ring *)arg;
+	FILE *out;
+
+	pthread_mutex_lock(&flush_lock);
+	if (ring->listed) {
+		out = (log_cfg.out) ? log_cfg.out : stderr;
+		while (ring->tail != ring->head && flush_rings(out) > 0)
+			;
+		unlist_ring(ring);
+	}
+	pthread_mutex_unlock(&flush_lock);
+	free_ring(ring);
+}
+
+static void create_ring_key()
+{
+	ring_key_err = -pthread_key_create(&ring_key, release_ring);
+}
+
+/* Get ring of calling thread, allocate it on first log after init.
+ *
+ * return value: ring, NULL if logging was stopped or on allocation
+ *               failure.
+ */
+static struct cp_log_ring *get_ring()
+{
+	struct cp_log_ring *ring = NULL;
+	uint32_t gen;
+
+	gen = __atomic_load_n(&log_gen, __ATOMIC_ACQUIRE);
+	if (tls_ring && tls_gen == gen)
+		return tls_ring;
+
+	/* ring is listed under flush_lock, so that octep_cp_log_uninit
+	 * either sees it on list or this sees logging stopped
+	 */
+	pthread_mutex_lock(&flush_lock);
+	if (tls_ring && !tls_ring->listed) {
+		/* ring of an earlier init, unlisted by octep_cp_log_uninit */
+		free_ring(tls_ring);
+		pthread_setspecific(ring_key, NULL);
+		tls_ring = NULL;
+	}
+	if (!log_started)
+		goto out;
+
+	ring = tls_ring;
+	if (!ring) {
+		ring = calloc(1, sizeof(*ring));
+		if (!ring)
+			goto out;
+		ring->recs = calloc(log_cfg.ring_sz, sizeof(*ring->recs));
+		if (!ring->recs) {
+			free(ring);
+			ring = NULL;
+			goto out;
+		}
+		ring->mask = log_cfg.ring_sz - 1;
+		ring->listed = true;
+		ring->next = rings;
+		rings = ring;
+		pthread_setspecific(ring_key, ring);
+	}
+	tls_ring = ring;
+	tls_gen = log_gen;
+out:
+	pthread_mutex_unlock(&flush_lock);
+
+	return ring;
+}
+
+__attribute__((visibility("default")))
+int octep_cp_log_write(uint32_t level, uint32_t logtype,
+		       const char *format, ...)
+{
+	struct cp_log_ring *ring;
+	uint32_t head, tail;
+	va_list ap;
+	int ret = 0;
+
+	va_start(ap, format);
+	ring = (__atomic_load_n(&log_started, __ATOMIC_ACQUIRE)) ?
+	       get_ring() : NULL;
+	if (!ring) {
+		ret = vfprintf(stderr, format, ap);
+		va_end(ap);
+		return (ret < 0) ? -EIO : 0;
+	}
+
+	head = ring->head;
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if ((head - tail) > ring->mask) {
+		__atomic_store_n(&ring->drops, ring->drops + 1,
+				 __ATOMIC_RELAXED);
+		ret = -ENOSPC;
+	} else {
+		encode_rec(&ring->recs[head & ring->mask], format, ap);
+		__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	}
+	va_end(ap);
+
+	return ret;
+}
+
+/* Get drops of all rings, called with flush_lock held */
+static uint64_t get_drops()
+{
+	struct cp_log_ring *ring;
+	uint64_t drops = unlisted_drops;
+
+	for (ring = rings; ring; ring = ring->next)
+		drops += __atomic_load_n(&ring->drops, __ATOMIC_RELAXED);
+
+	return drops;
+}
+
+/* Decode and write out records of listed rings, called with flush_lock
+ * held.
+ *
+ * return value: number of logs written.
+ */
+static int flush_rings(FILE *out)
+{
+	struct cp_log_ring *ring, *min;
+	struct cp_log_rec *rec, *min_rec;
+	int n = 0;
+
+	/* merge rings in time order, upto records present now */
+	while (1) {
+		min = NULL;
+		min_rec = NULL;
+		for (ring = rings; ring; ring = ring->next) {
+			if (ring->tail ==
+			    __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+				continue;
+
+			rec = &ring->recs[ring->tail & ring->mask];
+			if (!min_rec || rec->ts_ns < min_rec->ts_ns) {
+				min = ring;
+				min_rec = rec;
+			}
+		}
+		if (!min)
+			break;
+
+		decode_rec(min_rec, out);
+		__atomic_store_n(&min->tail, min->tail + 1, __ATOMIC_RELEASE);
+		n++;
+		/* bound a flush when producers keep up with it */
+		if (n >= (int)log_cfg.ring_sz * 4)
+			break;
+	}
+
+	return n;
+}
+
+__attribute__((visibility("default")))
+int octep_cp_log_flush()
+{
+	uint64_t drops;
+	FILE *out;
+	int n;
+
+	pthread_mutex_lock(&flush_lock);
+	out = (log_cfg.out) ? log_cfg.out : stderr;
+	n = flush_rings(out);
+	drops = get_drops();
+	if (drops > reported_drops) {
+		fprintf(out, "LIB: %lu logs dropped\n", drops - reported_drops);
+		reported_drops = drops;
+	}
+	fflush(out);
+	pthread_mutex_unlock(&flush_lock);
+
+	return n;
+}
+
+__attribute__((visibility("default")))
+uint64_t octep_cp_log_get_drops()
+{
+	uint64_t drops;
+
+	pthread_mutex_lock(&flush_lock);
+	drops = get_drops();
+	pthread_mutex_unlock(&flush_lock);
+
+	return drops;
+}
+
+static void *flusher_main(void *arg)
+{
+	struct timespec ts;
+	uint64_t ns;
+
+	pthread_mutex_lock(&flusher_lock);
+	while (!flusher_quit) {
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ns = ts.tv_nsec + (log_cfg.flush_ms * NSEC_PER_MSEC);
+		ts.tv_sec += ns / NSEC_PER_SEC;
+		ts.tv_nsec = ns % NSEC_PER_SEC;
+		pthread_cond_timedwait(&flusher_cond, &flusher_lock, &ts);
+		pthread_mutex_unlock(&flusher_lock);
+		octep_cp_log_flush();
+		pthread_mutex_lock(&flusher_lock);
+	}
+	pthread_mutex_unlock(&flusher_lock);
+
+	return NULL;
+}
+
+__attribute__((visibility("default")))
+int octep_cp_log_init(struct octep_cp_log_cfg *cfg)
+{
+	pthread_condattr_t attr;
+	int err;
+
+	if (log_started)
+		return 0;
+
+	memset(&log_cfg, 0, sizeof(log_cfg));
+	if (cfg)
+		log_cfg = *cfg;
+	if (!log_cfg.ring_sz)
+		log_cfg.ring_sz = OCTEP_CP_LOG_RING_SZ;
+	if (!log_cfg.flush_ms)
+		log_cfg.flush_ms = OCTEP_CP_LOG_FLUSH_MS;
+	if (log_cfg.ring_sz & (log_cfg.ring_sz - 1))
+		return -EINVAL;
+
+	pthread_once(&ring_key_once, create_ring_key);
+	if (ring_key_err)
+		return ring_key_err;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&flusher_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	flusher_quit = false;
+	pthread_mutex_lock(&flush_lock);
+	reported_drops = 0;
+	unlisted_drops = 0;
+	__atomic_add_fetch(&log_gen, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&log_started, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&flush_lock);
+	err = -pthread_create(&flusher, NULL, flusher_main, NULL);
+	if (err) {
+		__atomic_store_n(&log_started, 0, __ATOMIC_RELEASE);
+		pthread_cond_destroy(&flusher_cond);
+		return err;
+	}
+
+	return 0;
+}
+
+__attribute__((visibility("default")))
+int octep_cp_log_set_level(int logtype, uint32_t level)
+{
+	int i;
+
+	if (logtype < -1 || logtype >= OCTEP_CP_LOGTYPE_MAX ||
+	    level < OCTEP_CP_LOG_EMERG || level > OCTEP_CP_LOG_MAX)
+		return -EINVAL;
+
+	for (i = 0; i < OCTEP_CP_LOGTYPE_MAX; i++) {
+		if (logtype < 0 || logtype == i)
+			octep_cp_log_levels[i] = level;
+	}
+
+	return 0;
+}
+
+static int parse_level(const char *str)
+{
+	char *end;
+	long level;
+	int i;
+
+	level = strtol(str, &end, 10);
+	if (end != str && !*end)
+		return (level >= OCTEP_CP_LOG_EMERG &&
+			level <= OCTEP_CP_LOG_MAX) ? level : -EINVAL;
+
+	for (i = OCTEP_CP_LOG_EMERG; i <= OCTEP_CP_LOG_MAX; i++) {
+		if (!strcmp(str, level_names[i]))
+			return i;
+	}
+
+	return -EINVAL;
+}
+
+static int parse_type(const char *str)
+{
+	int i;
+
+	for (i = 0; i < OCTEP_CP_LOGTYPE_MAX; i++) {
+		if (!strcmp(str, type_names[i]))
+			return i;
+	}
+
+	return -EINVAL;
+}
+
+__attribute__((visibility("default")))
+int octep_cp_log_set_levels(const char *str)
+{
+	char *buf, *tok, *save, *sep;
+	int level, type, err = 0;
+
+	if (!str)
+		return -EINVAL;
+
+	buf = strdup(str);
+	if (!buf)
+		return -ENOMEM;
+
+	for (tok = strtok_r(buf, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		type = -1;
+		sep = strchr(tok, ':');
+		if (sep) {
+			*sep = '\0';
+			type = parse_type(tok);
+			tok = sep + 1;
+		}
+		level = parse_level(tok);
+		if ((sep && type < 0) || level < 0) {
+			err = -EINVAL;
+			break;
+		}
+		octep_cp_log_set_level(type, level);
+	}
+	free(buf);
+
+	return err;
+}
+
+__attribute__((visibility("default")))
+int octep_cp_log_uninit()
+{
+	struct cp_log_ring *ring, *next;
+	FILE *out;
+
+	if (!log_started)
+		return 0;
+
+	pthread_mutex_lock(&flusher_lock);
+	flusher_quit = true;
+	pthread_cond_signal(&flusher_cond);
+	pthread_mutex_unlock(&flusher_lock);
+	pthread_join(flusher, NULL);
+
+	/* further logs are written directly, threads which are still logging
+	 * keep their ring till they exit or log after next init
+	 */
+	pthread_mutex_lock(&flush_lock);
+	__atomic_store_n(&log_started, 0, __ATOMIC_RELEASE);
+	out = (log_cfg.out) ? log_cfg.out : stderr;
+	while (flush_rings(out) > 0)
+		;
+	for (ring = rings; ring; ring = next) {
+		next = ring->next;
+		unlist_ring(ring);
+	}
+	pthread_mutex_unlock(&flush_lock);
+	octep_cp_log_flush();
+
+	if (tls_ring) {
+		free_ring(tls_ring);
+		pthread_setspecific(ring_key, NULL);
+		tls_ring = NULL;
+	}
+	pthread_cond_destroy(&flusher_cond);
+
+	return 0;
+}
@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "octep_cp_lib.h"
+#include "cp_log.h"
+#include "cp_stats.h"
+
+#define NSEC_PER_SEC		1000000000ULL
+
+/* entries per pf, pf entry followed by vf entries */
+#define CP_STATS_PF_ENTRIES	(1 + OCTEP_CP_STATS_VF_MAX)
+
+/* segment, shared or private */
+static struct octep_cp_stats_hdr *hdr = NULL;
+static size_t seg_sz = 0;
+static bool seg_shared = false;
+static struct octep_cp_stats *entries = NULL;
+/* entry index of pem's and pf's, -1 if not configured */
+static int pem_entry[OCTEP_CP_DOM_MAX];
+static int pf_entry[OCTEP_CP_DOM_MAX][OCTEP_CP_PF_PER_DOM_MAX];
+
+/* Get pid of live process which owns existing segment, 0 if there is none */
+static pid_t seg_owner()
+{
+	struct octep_cp_stats_hdr *old;
+	struct stat st;
+	pid_t pid = 0;
+	int fd;
+
+	fd = shm_open(OCTEP_CP_STATS_SHM, O_RDONLY, 0);
+	if (fd < 0)
+		return 0;
+
+	if (!fstat(fd, &st) && st.st_size >= sizeof(*old)) {
+		old = mmap(NULL, sizeof(*old), PROT_READ, MAP_SHARED, fd, 0);
+		if (old != MAP_FAILED) {
+			if (__atomic_load_n(&old->magic, __ATOMIC_ACQUIRE) ==
+			    OCTEP_CP_STATS_MAGIC)
+				pid = old->pid;
+			munmap(old, sizeof(*old));
+		}
+	}
+	close(fd);
+
+	/* owner of segment left behind by an earlier run is gone */
+	if (pid && (pid == getpid() || (kill(pid, 0) && errno == ESRCH)))
+		pid = 0;
+
+	return pid;
+}
+
+static void *create_seg(size_t sz)
+{
+	void *seg;
+	pid_t pid;
+	int fd;
+
+	pid = seg_owner();
+	if (pid) {
+		CP_LIB_LOG(ERR, LIB, "stats shm %s in use by pid %d\n",
+			   OCTEP_CP_STATS_SHM, pid);
+		errno = EBUSY;
+		return NULL;
+	}
+
+	/* drop segment left behind by an earlier run */
+	shm_unlink(OCTEP_CP_STATS_SHM);
+	fd = shm_open(OCTEP_CP_STATS_SHM, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, sz)) {
+		close(fd);
+		shm_unlink(OCTEP_CP_STATS_SHM);
+		return NULL;
+	}
+
+	seg = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (seg == MAP_FAILED) {
+		shm_unlink(OCTEP_CP_STATS_SHM);
+		return NULL;
+	}
+
+	return seg;
+}
+
+static void init_entry(struct octep_cp_stats *s, int dom_idx, int pf_idx,
+		       int vf_idx)
+{
+	s->dom_idx = dom_idx;
+	s->pf_idx = (pf_idx < 0) ? OCTEP_CP_STATS_IDX_NONE : pf_idx;
+	s->vf_idx = (vf_idx < 0) ? OCTEP_CP_STATS_IDX_NONE : vf_idx;
+}
+
+int cp_stats_init(struct octep_cp_lib_cfg *cfg)
+{
+	struct octep_cp_dom_cfg *dom_cfg;
+	int i, j, v, n, num = 0;
+	struct timespec ts;
+
+	if (hdr)
+		return 0;
+
+	for (i = 0; i < OCTEP_CP_DOM_MAX; i++) {
+		pem_entry[i] = -1;
+		for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX; j++)
+			pf_entry[i][j] = -1;
+	}
+
+	for (i = 0; i < cfg->ndoms; i++)
+		num += 1 + (cfg->doms[i].npfs * CP_STATS_PF_ENTRIES);
+
+	seg_sz = sizeof(struct octep_cp_stats_hdr) +
+		 (num * sizeof(struct octep_cp_stats));
+	hdr = create_seg(seg_sz);
+	seg_shared = (hdr != NULL);
+	if (!hdr) {
+		CP_LIB_LOG(ERR, LIB, "stats shm %s unavailable, err %d\n",
+			   OCTEP_CP_STATS_SHM, errno);
+		hdr = aligned_alloc(__alignof__(struct octep_cp_stats_hdr),
+				    seg_sz);
+		if (!hdr)
+			return -ENOMEM;
+		memset(hdr, 0, seg_sz);
+	}
+
+	entries = (struct octep_cp_stats *)(hdr + 1);
+	n = 0;
+	for (i = 0; i < cfg->ndoms; i++) {
+		dom_cfg = &cfg->doms[i];
+		if (dom_cfg->idx < OCTEP_CP_DOM_MAX)
+			pem_entry[dom_cfg->idx] = n;
+		init_entry(&entries[n++], dom_cfg->idx, -1, -1);
+		for (j = 0; j < dom_cfg->npfs; j++) {
+			if (dom_cfg->idx < OCTEP_CP_DOM_MAX &&
+			    dom_cfg->pfs[j].idx < OCTEP_CP_PF_PER_DOM_MAX)
+				pf_entry[dom_cfg->idx][dom_cfg->pfs[j].idx] = n;
+			init_entry(&entries[n++], dom_cfg->idx,
+				   dom_cfg->pfs[j].idx, -1);
+			for (v = 0; v < OCTEP_CP_STATS_VF_MAX; v++)
+				init_entry(&entries[n++], dom_cfg->idx,
+					   dom_cfg->pfs[j].idx, v);
+		}
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	hdr->version = OCTEP_CP_STATS_VERSION;
+	hdr->hdr_sz = sizeof(struct octep_cp_stats_hdr);
+	hdr->entry_sz = sizeof(struct octep_cp_stats);
+	hdr->num_entries = num;
+	hdr->pid = getpid();
+	hdr->create_ns = (ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+	/* readers check magic before anything else */
+	__atomic_store_n(&hdr->magic, OCTEP_CP_STATS_MAGIC, __ATOMIC_RELEASE);
+	CP_LIB_LOG(INFO, LIB, "stats %s entries %d sz %lu\n",
+		   (seg_shared) ? OCTEP_CP_STATS_SHM : "private", num, seg_sz);
+
+	return 0;
+}
+
+struct octep_cp_stats *cp_stats_get(int dom_idx, int pf_idx, int vf_idx)
+{
+	int n;
+
+	if (!hdr || dom_idx < 0 || dom_idx >= OCTEP_CP_DOM_MAX ||
+	    pf_idx >= OCTEP_CP_PF_PER_DOM_MAX ||
+	    vf_idx >= OCTEP_CP_STATS_VF_MAX)
+		return NULL;
+
+	if (pf_idx < 0)
+		n = pem_entry[dom_idx];
+	else
+		n = pf_entry[dom_idx][pf_idx];
+	if (n < 0)
+		return NULL;
+
+	if (pf_idx >= 0 && vf_idx >= 0)
+		n += 1 + vf_idx;
+
+	return &entries[n];
+}
+
+__attribute__((visibility("default")))
+struct octep_cp_stats *octep_cp_lib_get_stats(int dom_idx, int pf_idx,
+					      int vf_idx)
+{
+	return cp_stats_get(dom_idx, pf_idx, vf_idx);
+}
+
+int cp_stats_uninit()
+{
+	if (!hdr)
+		return 0;
+
+	if (seg_shared) {
+		munmap(hdr, seg_sz);
+		shm_unlink(OCTEP_CP_STATS_SHM);
+	} else {
+		free(hdr);
+	}
+	hdr = NULL;
+	entries = NULL;
+	seg_sz = 0;
+
+	return 0;
+}
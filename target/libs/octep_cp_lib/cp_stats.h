@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/* Copyright (c) 2022 Marvell.
+ */
+#ifndef __CP_STATS_H__
+#define __CP_STATS_H__
+
+#include "octep_cp_stats.h"
+
+#define CP_STATS_ADD(s, ctr, val)	OCTEP_CP_STATS_ADD(s, ctr, val)
+#define CP_STATS_INC(s, ctr)		OCTEP_CP_STATS_INC(s, ctr)
+#define CP_STATS_SET(s, ctr, val)	__atomic_store_n(&(s)->ctr, (val), \
+							 __ATOMIC_RELAXED)
+
+/* Create stats segment with entries for pem's and pf's in configuration.
+ *
+ * Falls back to private memory if shared memory is unavailable.
+ *
+ * @param cfg: non-null pointer to struct octep_cp_lib_cfg.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int cp_stats_init(struct octep_cp_lib_cfg *cfg);
+
+/* Get entry of a pem, pf or vf, see octep_cp_lib_get_stats.
+ *
+ * return value: pointer to entry on success, NULL if not configured.
+ */
+struct octep_cp_stats *cp_stats_get(int dom_idx, int pf_idx, int vf_idx);
+
+/* Get entry of sender of a message from entry of its pf.
+ *
+ * @param pf_stats: non-null pointer to pf entry.
+ * @param is_vf: message is from a vf.
+ * @param vf_idx: index of vf.
+ *
+ * return value: pointer to vf entry, pf entry if vf has no entry.
+ */
+static inline struct octep_cp_stats *
+cp_stats_fn(struct octep_cp_stats *pf_stats, int is_vf, int vf_idx)
+{
+	if (is_vf && vf_idx < OCTEP_CP_STATS_VF_MAX)
+		return pf_stats + 1 + vf_idx;
+
+	return pf_stats;
+}
+
+/* Remove stats segment.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int cp_stats_uninit();
+
+#endif /* __CP_STATS_H__ */
@@ -14,7 +14,20 @@
 
 #define OCTEP_CP_DOM_MAX			8
 #define OCTEP_CP_PF_PER_DOM_MAX			128
+#define OCTEP_CP_VF_PER_PF_MAX			128
 #define OCTEP_CP_MSG_DESC_MAX			4
+/* Interval in msecs at which host status of pf's is rechecked */
+#define OCTEP_CP_HOST_CHECK_MS			100
+/* Default max responses queued per pf while fw-to-host queue is full */
+#define OCTEP_CP_TX_BACKLOG_DEF			64
+/* Environment variable with path of a file to cache uio and pci device
+ * discovery across restarts, no cache if not set
+ */
+#define OCTEP_CP_DISCOVER_CACHE_ENV		"OCTEP_CP_DISCOVER_CACHE"
+/* Environment variable with boot id which validates discovery cache,
+ * overrides /proc/sys/kernel/random/boot_id, eg: in containers
+ */
+#define OCTEP_CP_DISCOVER_BOOT_ID_ENV		"OCTEP_CP_DISCOVER_BOOT_ID"
 
 #define OCTEP_CP_SOC_MODEL_CN96xx_A0		BIT_ULL(0)
 #define OCTEP_CP_SOC_MODEL_CN96xx_B0		BIT_ULL(1)
@@ -74,6 +87,7 @@
 						 OCTEP_CP_SOC_MODEL_CNF105xxN)
 
 #define OCTEP_CP_SOC_MODEL_STR_LEN_MAX		128
+#define OCTEP_CP_SOC_NAME_LEN_MAX		16
 
 /* SoC model information */
 struct octep_cp_soc_model {
@@ -88,6 +102,9 @@ enum octep_cp_event_type {
 	OCTEP_CP_EVENT_TYPE_FLR,	/* from host */
 	OCTEP_CP_EVENT_TYPE_FW_READY,	/* from app */
 	OCTEP_CP_EVENT_TYPE_HEARTBEAT,	/* from app */
+	OCTEP_CP_EVENT_TYPE_HOST_READY,	/* from host */
+	OCTEP_CP_EVENT_TYPE_HOST_GONE,	/* from host */
+	OCTEP_CP_EVENT_TYPE_PEM_UP,	/* from host */
 	OCTEP_CP_EVENT_TYPE_MAX
 };
 
@@ -121,6 +138,23 @@ struct octep_cp_event_info_heartbeat {
 	int pf_idx;
 };
 
+struct octep_cp_event_info_host {
+	/* index of pcie mac domain */
+	int dom_idx;
+	/* index of pf in pcie mac domain */
+	int pf_idx;
+	/* host version, 0 for host gone */
+	uint32_t host_version;
+};
+
+/* Link of a pem left uninitialized by octep_cp_lib_init came up, pem
+ * should be initialized with octep_cp_lib_init_pem.
+ */
+struct octep_cp_event_info_pem_up {
+	/* index of pcie mac domain */
+	int dom_idx;
+};
+
 /* library configuration */
 struct octep_cp_event_info {
 	enum octep_cp_event_type e;
@@ -129,6 +163,8 @@ struct octep_cp_event_info {
 		struct octep_cp_event_info_flr flr;
 		struct octep_cp_event_info_fw_ready fw_ready;
 		struct octep_cp_event_info_heartbeat hbeat;
+		struct octep_cp_event_info_host host;
+		struct octep_cp_event_info_pem_up pem_up;
 	} u;
 };
 
@@ -170,12 +206,50 @@ struct octep_cp_msg {
 	struct octep_cp_msg_buf sg_list[OCTEP_CP_MSG_DESC_MAX];
 };
 
+/* Action when a response does not fit in fw-to-host queue and pf
+ * transmit backlog is full.
+ */
+enum octep_cp_tx_backlog_policy {
+	/* fail send of new responses */
+	OCTEP_CP_TX_BACKLOG_DROP_NEW,
+	/* drop oldest queued response to queue new one */
+	OCTEP_CP_TX_BACKLOG_DROP_OLD,
+	OCTEP_CP_TX_BACKLOG_POLICY_MAX
+};
+
 /* pcie mac domain pf configuration */
 struct octep_cp_pf_cfg {
 	/* pcie mac domain pf index */
 	int idx;
 	/* Maximum supported message size to be filled by library */
 	uint16_t max_msg_sz;
+	/* Percentage of mailbox queue memory used for host to firmware
+	 * messages, 0 for default (50)
+	 */
+	uint8_t mbox_h2fq_pct;
+	/* Mailbox size in bytes, 0 for all memory available to pf.
+	 * Updated by library with the size in use.
+	 */
+	uint32_t mbox_sz;
+	/* Max responses queued by library while fw-to-host queue is full,
+	 * 0 for default (OCTEP_CP_TX_BACKLOG_DEF)
+	 */
+	uint16_t tx_backlog;
+	/* enum octep_cp_tx_backlog_policy */
+	uint8_t tx_backlog_policy;
+	/* Interrupt moderation, max messages sent to host before an
+	 * interrupt is raised, 0 for no limit
+	 */
+	uint16_t oei_coalesce_msgs;
+	/* Interrupt moderation, max usecs an interrupt is deferred after a
+	 * message is sent to host, 0 to interrupt host on every send
+	 */
+	uint32_t oei_coalesce_usecs;
+	/* Max usecs a notification sent with
+	 * octep_cp_lib_send_notification_fanout is held for a newer one to
+	 * the same functions, 0 to send immediately
+	 */
+	uint32_t notify_debounce_usecs;
 };
 
 /* pcie mac domain configuration */
@@ -203,6 +277,26 @@ struct octep_cp_lib_cfg {
 	uint16_t ndoms;
 	/* configuration for pcie mac domains */
 	struct octep_cp_dom_cfg doms[OCTEP_CP_DOM_MAX];
+	/* soc implementation, OCTEP_CP_SIM_NAME for simulated soc,
+	 * empty to detect soc
+	 */
+	char soc[OCTEP_CP_SOC_NAME_LEN_MAX];
+	/* non zero to set fw ready of each pf as soon as its mailbox is
+	 * initialized by octep_cp_lib_init or octep_cp_lib_init_pem, instead
+	 * of on OCTEP_CP_EVENT_TYPE_FW_READY from the application
+	 */
+	uint8_t fw_ready_on_init;
+	/* non zero for octep_cp_lib_init and octep_cp_lib_init_pem to fail
+	 * with -EAGAIN right away if pem link is down, instead of waiting up
+	 * to 10 secs for it to come up
+	 */
+	uint8_t pem_nowait;
+	/* non zero for octep_cp_lib_init to succeed while some pem links are
+	 * down, such pem's and pem's failing octep_cp_lib_init_pem with
+	 * -EAGAIN are reported with OCTEP_CP_EVENT_TYPE_PEM_UP once their
+	 * link comes up
+	 */
+	uint8_t pem_late_join;
 };
 
 /* pcie mac domain pf information */
@@ -225,6 +319,16 @@ struct octep_cp_dom_info {
 	struct octep_cp_pf_info pfs[OCTEP_CP_PF_PER_DOM_MAX];
 };
 
+/* pf with a ready host */
+struct octep_cp_active_pf {
+	/* index of pcie mac domain */
+	uint16_t dom_idx;
+	/* index of pf in pcie mac domain */
+	uint16_t pf_idx;
+	/* host version */
+	uint32_t host_version;
+};
+
 /* library information */
 struct octep_cp_lib_info {
 	/* Detected soc */
@@ -238,6 +342,13 @@ struct octep_cp_lib_info {
 /* Initialize octep_cp library.
  *
  * Library will fill in information after initialization.
+ * Message and event api's can be called from multiple threads once the
+ * library is initialized, calls on different pem/pf's run concurrently
+ * and calls on the same pem/pf are serialized. peek/commit and
+ * reserve/commit sequences on a pem/pf should be issued by one thread
+ * without other sends or receives on that pem/pf in between.
+ * octep_cp_lib_init and octep_cp_lib_uninit should not run concurrently
+ * with other api's.
  *
  * @param cfg: [IN/OUT] non-null pointer to struct octep_cp_lib_cfg.
  *
@@ -250,8 +361,10 @@ int octep_cp_lib_init(struct octep_cp_lib_cfg *cfg);
  * Library will fill in information of pem after initialization.
  *
  * @param cfg: [IN/OUT] non-null pointer to struct octep_cp_lib_cfg.
+ * @param dom_idx: [IN] index of pem in cfg->doms, not the pem index.
  *
- * return value: 0 on success, -errno on failure.
+ * return value: 0 on success, -EAGAIN if pem link is down and pem_nowait
+ *               is set in @cfg, -errno on other failures.
  */
 int octep_cp_lib_init_pem(struct octep_cp_lib_cfg *cfg, int dom_idx);
 
@@ -272,6 +385,11 @@ int octep_cp_lib_get_info(struct octep_cp_lib_info *info);
 /* Send response to received message.
  *
  * Total buffer size cannot exceed max_msg_sz in library configuration.
+ * All messages are sent with one update of the mailbox producer index and
+ * one host interrupt, prefer sending responses to a batch of received
+ * messages in one call. Messages which do not fit in the mailbox are
+ * copied to the pf transmit backlog and sent in order on later receives
+ * or sends on the pf, see tx_backlog in struct octep_cp_pf_cfg.
  *
  * @param ctx: [IN] non-null pointer to union octep_cp_msg_info. This will
  *             provide the pem, pf indices on which the message should be
@@ -279,7 +397,8 @@ int octep_cp_lib_get_info(struct octep_cp_lib_info *info);
  * @param msg: [IN] Array of non-null pointer to message.
  * @param num: [IN] Number of elements in @msg.
  *
- * return value: number of messages sent on success, -errno on failure.
+ * return value: number of messages sent or queued on success, -errno on
+ *               failure.
  */
 int octep_cp_lib_send_msg_resp(union octep_cp_msg_info *ctx,
 			       struct octep_cp_msg *msg,
@@ -289,6 +408,9 @@ int octep_cp_lib_send_msg_resp(union octep_cp_msg_info *ctx,
  *
  * Reply is not expected for this message.
  * Buffer size cannot exceed max_msg_sz in library configuration.
+ * Notification is sent after responses in the pf transmit backlog and is
+ * queued there if it does not fit, see tx_backlog in struct
+ * octep_cp_pf_cfg.
  *
  * @param ctx: [IN] non-null pointer to union octep_cp_msg_info. This will
  *             provide the pem, pf indices on which the message should be
@@ -300,6 +422,41 @@ int octep_cp_lib_send_msg_resp(union octep_cp_msg_info *ctx,
 int octep_cp_lib_send_notification(union octep_cp_msg_info *ctx,
 				   struct octep_cp_msg* msg);
 
+/* Functions of a pf addressed by a fan-out notification */
+struct octep_cp_fn_set {
+	/* non zero to include pf */
+	int pf;
+	/* 1 bit per vf index */
+	uint64_t vf_mask[2];
+};
+
+/* Send a notification to a set of functions of a pf.
+ *
+ * A copy of the notification is sent to the pf and each vf in @fns, with
+ * is_vf and vf_idx set accordingly. All copies are written to the mailbox
+ * with one producer index update and one host interrupt, copies which do
+ * not fit are queued in the pf transmit backlog.
+ *
+ * With notify_debounce_usecs set in struct octep_cp_pf_cfg, the
+ * notification is held for up to that time and replaced by a newer
+ * notification to the same functions, so that eg: a link flapping
+ * up/down/up is reported once with its final state. A notification to
+ * different functions sends the held one first. Expired notifications are
+ * sent on later receives on the pf and by octep_cp_lib_flush_intrs.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info. This will
+ *             provide the pem, pf indices on which the message should be
+ *             sent.
+ * @param msg: [IN] Message buffer.
+ * @param fns: [IN] Non-null pointer to functions to notify.
+ *
+ * return value: number of notifications sent, queued or held on success,
+ *               -errno on failure.
+ */
+int octep_cp_lib_send_notification_fanout(union octep_cp_msg_info *ctx,
+					  struct octep_cp_msg *msg,
+					  const struct octep_cp_fn_set *fns);
+
 /* Receive a new message on given pem/pf.
  *
  * ctx received with the message should be used to send a response.
@@ -317,6 +474,71 @@ int octep_cp_lib_recv_msg(union octep_cp_msg_info *ctx,
 			  struct octep_cp_msg *msg,
 			  int num);
 
+/* Peek at new messages on given pem/pf without copying them.
+ *
+ * sg_list of each message points at message data in mailbox memory, data is
+ * split over 2 buffers if it rolls over the end of mailbox queue. Messages
+ * stay in mailbox until octep_cp_lib_recv_msg_commit is called, buffers are
+ * valid until then. Returns -ENOTSUP if mailbox memory cannot be accessed
+ * directly, use octep_cp_lib_recv_msg in that case.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info. This will
+ *             provide the pem, pf indices on which the message should be
+ *             received.
+ * @param msg: [OUT] Array of messages to be filled by library.
+ * @param num: Number of elements in @msg.
+ *
+ * return value: number of messages available on success, -errno on failure.
+ */
+int octep_cp_lib_recv_msg_peek(union octep_cp_msg_info *ctx,
+			       struct octep_cp_msg *msg,
+			       int num);
+
+/* Consume messages returned by octep_cp_lib_recv_msg_peek.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info.
+ * @param msg: [IN] First @num messages returned by peek.
+ * @param num: Number of messages to consume.
+ *
+ * return value: number of messages consumed on success, -errno on failure.
+ */
+int octep_cp_lib_recv_msg_commit(union octep_cp_msg_info *ctx,
+				 struct octep_cp_msg *msg,
+				 int num);
+
+/* Reserve mailbox space to build a response in place.
+ *
+ * Caller should provide msg.info.s.sz, library fills msg.sg_list with at
+ * most 2 buffers in mailbox memory. Response is not visible to host until
+ * octep_cp_lib_send_msg_resp_commit is called. A reservation that is not
+ * committed is dropped by the next send or reserve on the pem/pf, such as a
+ * notification sent from another thread.
+ * Returns -ENOTSUP if mailbox memory cannot be accessed directly, use
+ * octep_cp_lib_send_msg_resp in that case.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info. This will
+ *             provide the pem, pf indices on which the message should be
+ *             sent.
+ * @param msg: [IN/OUT] Response message.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_cp_lib_send_msg_resp_reserve(union octep_cp_msg_info *ctx,
+				       struct octep_cp_msg *msg);
+
+/* Send response built in space from octep_cp_lib_send_msg_resp_reserve.
+ *
+ * msg.info.s.sz can be smaller than the reserved size.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info.
+ * @param msg: [IN] Message passed to octep_cp_lib_send_msg_resp_reserve.
+ *
+ * return value: 0 on success, -ESTALE if reservation was dropped, response
+ *               should then be sent again, -errno on other failures.
+ */
+int octep_cp_lib_send_msg_resp_commit(union octep_cp_msg_info *ctx,
+				      struct octep_cp_msg *msg);
+
 /* Send event to host.
  *
  * Send a new event to host.
@@ -327,9 +549,24 @@ int octep_cp_lib_recv_msg(union octep_cp_msg_info *ctx,
  */
 int octep_cp_lib_send_event(struct octep_cp_event_info *info);
 
+/* Send a batch of events to host.
+ *
+ * Events due at the same time, such as heartbeats of several pf's, should
+ * be sent in one call so that library can combine their register writes.
+ *
+ * @param info: [IN] Non-Null pointer to event info array.
+ * @param num: [IN] Number of events in @info.
+ *
+ * return value: number of events sent on success, -errno on failure.
+ */
+int octep_cp_lib_send_events(struct octep_cp_event_info *info, int num);
+
 /* Receive events.
  *
  * Receive events such as flr, perst etc.
+ * Host status of pf's is rechecked every OCTEP_CP_HOST_CHECK_MS in this
+ * api and host ready/gone transitions are reported as events, so it
+ * should be called at least that often.
  *
  * @param info: [OUT] Non-Null pointer to event info array.
  * @param num: [IN] Number of event info buffers.
@@ -338,7 +575,53 @@ int octep_cp_lib_send_event(struct octep_cp_event_info *info);
  */
 int octep_cp_lib_recv_event(struct octep_cp_event_info *info, int num);
 
+/* Get file descriptors for event notification.
+ *
+ * Returned fds become readable when events are pending, so
+ * octep_cp_lib_recv_event needs to be called only when one of them is
+ * readable. fds can change after octep_cp_lib_init_pem, so they should be
+ * retrieved again after that.
+ *
+ * @param fds: [OUT] Non-Null pointer to fd array.
+ * @param num: [IN] Number of elements in @fds.
+ *
+ * return value: number of fds on success, -errno on failure.
+ */
+int octep_cp_lib_get_event_fds(int *fds, int num);
+
+/* Get pf's with a ready host.
+ *
+ * Messages can be received only on these pf's. List changes when host
+ * ready/gone events are received and after octep_cp_lib_init_pem.
+ *
+ * @param pfs: [OUT] Non-Null pointer to array of active pf's.
+ * @param num: [IN] Number of elements in @pfs.
+ *
+ * return value: number of active pf's on success, -errno on failure.
+ */
+int octep_cp_lib_get_active_pfs(struct octep_cp_active_pf *pfs, int num);
+
+/* Raise host interrupts deferred by interrupt moderation and send
+ * notifications held for debounce.
+ *
+ * With oei_coalesce_usecs set in struct octep_cp_pf_cfg, the interrupt for
+ * messages sent to a host is deferred until oei_coalesce_msgs messages
+ * are sent or oei_coalesce_usecs expire. Expired interrupts are raised on
+ * later sends and receives on the pf, the application should call this
+ * api while it returns non zero to raise interrupts of idle pf's in time.
+ * Held notifications are sent when their debounce time expires.
+ *
+ * @param force: [IN] non zero to raise all deferred interrupts, else only
+ *               those whose delay expired.
+ *
+ * return value: number of deferred interrupts and held notifications on
+ *               success, -errno on failure.
+ */
+int octep_cp_lib_flush_intrs(int force);
+
 /* Uninitialize lib values for a pem
+ *
+ * @param dom_idx: [IN] index of pem in cfg->doms of octep_cp_lib_init.
  *
  * return value: 0 on success, -errno on failure.
  */
@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __OCTEP_CP_LOG_H__
+#define __OCTEP_CP_LOG_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Can't use 0, as it gives compiler warnings */
+#define OCTEP_CP_LOG_EMERG		1U  /**< System is unusable.               */
+#define OCTEP_CP_LOG_ALERT		2U  /**< Action must be taken immediately. */
+#define OCTEP_CP_LOG_CRIT		3U  /**< Critical conditions.              */
+#define OCTEP_CP_LOG_ERR		4U  /**< Error conditions.                 */
+#define OCTEP_CP_LOG_WARNING		5U  /**< Warning conditions.               */
+#define OCTEP_CP_LOG_NOTICE		6U  /**< Normal but significant condition. */
+#define OCTEP_CP_LOG_INFO		7U  /**< Informational.                    */
+#define OCTEP_CP_LOG_DEBUG		8U  /**< Debug-level messages.             */
+#define OCTEP_CP_LOG_MAX		OCTEP_CP_LOG_DEBUG /**< Most detailed log level.*/
+
+/* Logs above this level are compiled out, override with
+ * -DOCTEP_CP_LOG_LEVEL_MAX=<level> to remove debug logs from fast paths.
+ */
+#ifndef OCTEP_CP_LOG_LEVEL_MAX
+#define OCTEP_CP_LOG_LEVEL_MAX		OCTEP_CP_LOG_MAX
+#endif
+
+/* Default runtime level of all log types */
+#define OCTEP_CP_LOG_LEVEL_DEFAULT	OCTEP_CP_LOG_INFO
+
+/* Max arguments and total string argument bytes kept per log record,
+ * arguments beyond these are truncated.
+ */
+#define OCTEP_CP_LOG_ARGS_MAX		12
+#define OCTEP_CP_LOG_STR_MAX		64
+
+/* Default number of records in per thread log ring */
+#define OCTEP_CP_LOG_RING_SZ		1024
+/* Default interval in msecs at which log rings are flushed */
+#define OCTEP_CP_LOG_FLUSH_MS		100
+
+enum {
+	OCTEP_CP_LOGTYPE_LIB,		/**< Log related to library. */
+	OCTEP_CP_LOGTYPE_CONFIG,	/**< Log related to library config. */
+	OCTEP_CP_LOGTYPE_LOOP,		/**< Log related to loop mode. */
+	OCTEP_CP_LOGTYPE_NIC,		/**< Log related to nic mode. */
+	OCTEP_CP_LOGTYPE_SOC,		/**< Log related to soc abstraction. */
+	OCTEP_CP_LOGTYPE_CNXK,		/**< Log related to cnxk soc's. */
+	OCTEP_CP_LOGTYPE_PLUGIN_SERVER,	/**< Log related to plugin server. */
+	OCTEP_CP_LOGTYPE_PLUGIN_CLIENT,	/**< Log related to plugin client. */
+	OCTEP_CP_LOGTYPE_APP,		/**< Log related to application. */
+	OCTEP_CP_LOGTYPE_MAX
+};
+
+/* Logger configuration */
+struct octep_cp_log_cfg {
+	/* Number of records in per thread ring, power of 2,
+	 * 0 for OCTEP_CP_LOG_RING_SZ.
+	 */
+	uint32_t ring_sz;
+	/* Flush interval in msecs, 0 for OCTEP_CP_LOG_FLUSH_MS */
+	uint32_t flush_ms;
+	/* Output stream for decoded logs, NULL for stderr */
+	FILE *out;
+};
+
+/* Runtime log level of each log type, use octep_cp_log_set_level */
+extern volatile uint32_t octep_cp_log_levels[OCTEP_CP_LOGTYPE_MAX];
+
+/* Start buffered logging.
+ *
+ * Till this is called, logs are written synchronously to stderr.
+ * After this, each logging thread writes binary records of format and
+ * arguments to its own lock-free ring, a background thread decodes and
+ * writes them to output stream. Logs are dropped and counted when a ring
+ * is full. Format of a log must be a string literal as it is decoded after
+ * the call returns, string arguments are copied into the record.
+ *
+ * @param cfg: pointer to struct octep_cp_log_cfg, NULL for defaults.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_cp_log_init(struct octep_cp_log_cfg *cfg);
+
+/* Set runtime log level.
+ *
+ * @param logtype: log type, -1 for all.
+ * @param level: log level, OCTEP_CP_LOG_EMERG to OCTEP_CP_LOG_MAX.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_cp_log_set_level(int logtype, uint32_t level);
+
+/* Set runtime log levels from a string.
+ *
+ * @param str: comma separated <level> or <logtype>:<level>, level is a
+ *             number or name such as err, info, debug and logtype is a
+ *             name such as lib, cnxk, app, eg: info,cnxk:debug
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_cp_log_set_levels(const char *str);
+
+/* Write a log record, use OCTEP_CP_LOG instead.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_cp_log_write(uint32_t level, uint32_t logtype,
+		       const char *format, ...)
+	__attribute__((format(printf, 3, 4)));
+
+/* Decode and write out all buffered logs.
+ *
+ * return value: number of logs written on success, -errno on failure.
+ */
+int octep_cp_log_flush();
+
+/* Get number of logs dropped due to full rings.
+ *
+ * return value: number of logs dropped.
+ */
+uint64_t octep_cp_log_get_drops();
+
+/* Flush buffered logs and stop buffered logging.
+ *
+ * Logs written after this by any thread go to stderr synchronously.
+ * Threads may still be logging during the call: a thread's ring is freed
+ * only when the thread exits or logs after the next octep_cp_log_init, so
+ * it is never freed under a writer. Logs which such a thread writes to its
+ * ring while the call runs may be lost, so join logging threads before
+ * calling it to get all their logs out.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_cp_log_uninit();
+
+#define OCTEP_CP_LOG(l, t, ...)						\
+	do {								\
+		if (OCTEP_CP_LOG_ ## l <= OCTEP_CP_LOG_LEVEL_MAX &&	\
+		    OCTEP_CP_LOG_ ## l <=				\
+		    octep_cp_log_levels[OCTEP_CP_LOGTYPE_ ## t])	\
+			octep_cp_log_write(OCTEP_CP_LOG_ ## l,		\
+					   OCTEP_CP_LOGTYPE_ ## t,	\
+					   # t ": " __VA_ARGS__);	\
+	} while (0)
+
+#endif /* __OCTEP_CP_LOG_H__ */
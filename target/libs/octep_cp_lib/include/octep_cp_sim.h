@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __OCTEP_CP_SIM_H__
+#define __OCTEP_CP_SIM_H__
+
+/* Simulated soc.
+ *
+ * Selected by setting OCTEP_CP_SOC_ENV to OCTEP_CP_SIM_NAME in environment
+ * or soc in struct octep_cp_lib_cfg, environment has precedence. Library
+ * then runs without pem hardware, all files are created in directory
+ * OCTEP_CP_SIM_DIR_ENV, or OCTEP_CP_SIM_DIR_DEF if not set.
+ *
+ * pem bar4 is backed by file OCTEP_CP_SIM_BAR4_FMT, pf mailboxes are at
+ * OCTEP_CP_SIM_MBOX_OFFSET(pf_idx) in this file, same as in hardware bar4.
+ *
+ * For each initialized pf, library writes file OCTEP_CP_SIM_PF_FMT with one
+ * line "<bar4 file> <mbox offset> <mbox size> <pid> <oei fifo> <fw ready>".
+ * pid is of the process using the library. Every oei interrupt of the pf
+ * writes 8 bytes to oei fifo OCTEP_CP_SIM_OEI_FMT, interrupts are not
+ * written while the fifo is full.
+ *
+ * Host events are injected by writing lines to fifo OCTEP_CP_SIM_CTRL:
+ *   perst <pem>
+ *   flr <pem> <pf> [<vf mask bits 0-63> [<vf mask bits 64-127>]]
+ *   link <pem> <up|down>
+ * pem with link down fails initialization until link is up again.
+ */
+
+/* environment variable which selects soc implementation */
+#define OCTEP_CP_SOC_ENV		"OCTEP_CP_SOC"
+/* name of simulated soc */
+#define OCTEP_CP_SIM_NAME		"sim"
+/* environment variable with directory of simulated soc files */
+#define OCTEP_CP_SIM_DIR_ENV		"OCTEP_CP_SIM_DIR"
+#define OCTEP_CP_SIM_DIR_DEF		"/dev/shm/octep_cp_sim"
+/* control fifo */
+#define OCTEP_CP_SIM_CTRL		"ctrl"
+/* pem bar4 memory, argument is pem index */
+#define OCTEP_CP_SIM_BAR4_FMT		"pem%d_bar4"
+/* pf information, arguments are pem and pf index */
+#define OCTEP_CP_SIM_PF_FMT		"pem%d_pf%d"
+/* pf oei interrupt fifo, arguments are pem and pf index */
+#define OCTEP_CP_SIM_OEI_FMT		"pem%d_pf%d_oei"
+/* size of pem bar4 memory file */
+#define OCTEP_CP_SIM_BAR4_SZ		(8 * 0x400000ULL)
+/* offset of pf mailbox in pem bar4 memory file */
+#define OCTEP_CP_SIM_MBOX_OFFSET(pf)	((7 * 0x400000ULL) + \
+					 ((pf) * (0x400000ULL / 128)))
+
+#endif /* __OCTEP_CP_SIM_H__ */
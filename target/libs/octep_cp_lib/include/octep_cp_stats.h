@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __OCTEP_CP_STATS_H__
+#define __OCTEP_CP_STATS_H__
+
+#include <stdint.h>
+
+/*          shared memory stats segment
+ * |===========================================|
+ * |struct octep_cp_stats_hdr (hdr_sz bytes)   |
+ * |===========================================|
+ * |pem entry (entry_sz bytes)                 |
+ * |-------------------------------------------|
+ * |pf entry                                   |
+ * |vf entries x OCTEP_CP_STATS_VF_MAX         |
+ * |-------------------------------------------|
+ * |next pf of pem ...                         |
+ * |===========================================|
+ * |next pem ...                               |
+ * |===========================================|
+ *
+ * Segment is created by octep_cp_lib_init at /dev/shm/<OCTEP_CP_STATS_SHM>
+ * and removed by octep_cp_lib_uninit. If the segment belongs to another
+ * process which is alive, it is left alone and counters are kept private
+ * to the process. Readers should check magic and version, and step entries
+ * by entry_sz as new counters are appended to struct octep_cp_stats. Each
+ * counter has one writer at a time, readers load counters without locks and
+ * may see counters of an entry at slightly different points in time.
+ */
+
+/* Name of shared memory object */
+#define OCTEP_CP_STATS_SHM		"/octep_cp_stats"
+#define OCTEP_CP_STATS_MAGIC		0x4f4354455053544dULL
+#define OCTEP_CP_STATS_VERSION		1
+/* Max vf's per pf with counters */
+#define OCTEP_CP_STATS_VF_MAX		64
+/* pf_idx of pem entry and vf_idx of pem and pf entries */
+#define OCTEP_CP_STATS_IDX_NONE		0xffff
+
+/* Segment header */
+struct octep_cp_stats_hdr {
+	/* OCTEP_CP_STATS_MAGIC, written after segment is initialized */
+	uint64_t magic;
+	/* OCTEP_CP_STATS_VERSION */
+	uint32_t version;
+	/* size of header, entries start at this offset */
+	uint32_t hdr_sz;
+	/* size of one entry */
+	uint32_t entry_sz;
+	/* number of entries */
+	uint32_t num_entries;
+	/* pid of writer */
+	uint32_t pid;
+	uint32_t reserved;
+	/* CLOCK_REALTIME of segment creation in nsecs */
+	uint64_t create_ns;
+} __attribute__((aligned(128)));
+
+/* Counters of a pem, pf or vf */
+struct octep_cp_stats {
+	/* index of pem */
+	uint16_t dom_idx;
+	/* index of pf, OCTEP_CP_STATS_IDX_NONE for pem entry */
+	uint16_t pf_idx;
+	/* index of vf, OCTEP_CP_STATS_IDX_NONE for pem and pf entries */
+	uint16_t vf_idx;
+	uint16_t reserved;
+	/* messages received from host */
+	uint64_t rx_msgs;
+	/* bytes received from host, message headers included */
+	uint64_t rx_bytes;
+	/* messages sent to host */
+	uint64_t tx_msgs;
+	/* bytes sent to host, message headers included */
+	uint64_t tx_bytes;
+	/* sends that found fw-to-host queue full, pf entry */
+	uint64_t ring_full;
+	/* host-to-fw queue depth in bytes at last receive, pf entry */
+	uint64_t h2fq_depth;
+	/* highest host-to-fw queue depth in bytes, pf entry */
+	uint64_t h2fq_depth_max;
+	/* oei interrupts raised to host, pf entry */
+	uint64_t oei_ints;
+	/* heartbeats sent to host, pf entry */
+	uint64_t heartbeats;
+	/* perst events, pem entry */
+	uint64_t perst;
+	/* messages the application failed to handle */
+	uint64_t handler_errors;
+	/* responses queued in backlog because fw-to-host queue was full,
+	 * pf entry
+	 */
+	uint64_t tx_backlog_queued;
+	/* responses dropped from or refused by a full backlog, or dropped
+	 * when host went away, pf entry
+	 */
+	uint64_t tx_backlog_drops;
+	/* responses in backlog, pf entry */
+	uint64_t tx_backlog;
+	/* highest number of responses in backlog, pf entry */
+	uint64_t tx_backlog_max;
+	/* messages sent without interrupt due to interrupt moderation,
+	 * compare oei_ints with tx_msgs for messages per interrupt, pf entry
+	 */
+	uint64_t oei_deferred;
+	/* fan-out notifications replaced by a newer one while held for
+	 * debounce, pf entry
+	 */
+	uint64_t notify_debounced;
+} __attribute__((aligned(128)));
+
+/* Add to a counter, caller should be the only writer of the counter */
+#define OCTEP_CP_STATS_ADD(s, ctr, val)					\
+	__atomic_store_n(&(s)->ctr,					\
+			 __atomic_load_n(&(s)->ctr, __ATOMIC_RELAXED) +	\
+			 (val), __ATOMIC_RELAXED)
+
+#define OCTEP_CP_STATS_INC(s, ctr)	OCTEP_CP_STATS_ADD(s, ctr, 1)
+
+/* Get counters of a pem, pf or vf.
+ *
+ * Entries are valid from octep_cp_lib_init to octep_cp_lib_uninit, and are
+ * kept across octep_cp_lib_init_pem. Library updates all counters other
+ * than handler_errors, which is left to the application.
+ *
+ * @param dom_idx: index of pem.
+ * @param pf_idx: index of pf, -1 for pem entry.
+ * @param vf_idx: index of vf, -1 for pf or pem entry.
+ *
+ * return value: pointer to entry on success, NULL if not configured.
+ */
+struct octep_cp_stats *octep_cp_lib_get_stats(int dom_idx, int pf_idx,
+					      int vf_idx);
+
+#endif /* __OCTEP_CP_STATS_H__ */
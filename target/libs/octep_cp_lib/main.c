@@ -11,6 +11,7 @@
 #include "octep_cp_lib.h"
 #include "cp_log.h"
 #include "cp_lib.h"
+#include "cp_stats.h"
 
 /* operating state */
 volatile enum cp_lib_state state = CP_LIB_STATE_INVALID;
@@ -28,14 +29,19 @@ int octep_cp_lib_init(struct octep_cp_lib_cfg *cfg)
 	if (state >= CP_LIB_STATE_INIT)
 		return 0;
 
-	err = soc_get_ops(&sops);
+	err = soc_get_ops(cfg, &sops);
 	if (err || !sops)
 		return -ENAVAIL;
 
+	err = cp_stats_init(cfg);
+	if (err)
+		return err;
+
 	memset(&user_cfg, 0, sizeof(struct octep_cp_lib_cfg));
 	state = CP_LIB_STATE_INIT;
 	err = sops->init(cfg);
 	if (err) {
+		cp_stats_uninit();
 		state = CP_LIB_STATE_INVALID;
 		return err;
 	}
@@ -120,6 +126,20 @@ int octep_cp_lib_send_notification(union octep_cp_msg_info *ctx,
 	return sops->send_notification(ctx, msg);
 }
 
+__attribute__((visibility("default")))
+int octep_cp_lib_send_notification_fanout(union octep_cp_msg_info *ctx,
+					  struct octep_cp_msg *msg,
+					  const struct octep_cp_fn_set *fns)
+{
+	if (state != CP_LIB_STATE_READY)
+		return -EAGAIN;
+
+	if (!ctx || !msg || !fns)
+		return -EINVAL;
+
+	return sops->send_notification_fanout(ctx, msg, fns);
+}
+
 __attribute__((visibility("default")))
 int octep_cp_lib_recv_msg(union octep_cp_msg_info *ctx,
 			  struct octep_cp_msg *msgs,
@@ -136,6 +156,60 @@ int octep_cp_lib_recv_msg(union octep_cp_msg_info *ctx,
 	return sops->recv_msg(ctx, msgs, num);
 }
 
+__attribute__((visibility("default")))
+int octep_cp_lib_recv_msg_peek(union octep_cp_msg_info *ctx,
+			       struct octep_cp_msg *msgs,
+			       int num)
+{
+	if (state != CP_LIB_STATE_READY)
+		return -EAGAIN;
+
+	if (!ctx || !msgs || num <= 0)
+		return -EINVAL;
+
+	return sops->recv_msg_peek(ctx, msgs, num);
+}
+
+__attribute__((visibility("default")))
+int octep_cp_lib_recv_msg_commit(union octep_cp_msg_info *ctx,
+				 struct octep_cp_msg *msgs,
+				 int num)
+{
+	if (state != CP_LIB_STATE_READY)
+		return -EAGAIN;
+
+	if (!ctx || !msgs || num <= 0)
+		return -EINVAL;
+
+	return sops->recv_msg_commit(ctx, msgs, num);
+}
+
+__attribute__((visibility("default")))
+int octep_cp_lib_send_msg_resp_reserve(union octep_cp_msg_info *ctx,
+				       struct octep_cp_msg *msg)
+{
+	if (state != CP_LIB_STATE_READY)
+		return -EAGAIN;
+
+	if (!ctx || !msg)
+		return -EINVAL;
+
+	return sops->send_msg_resp_reserve(ctx, msg);
+}
+
+__attribute__((visibility("default")))
+int octep_cp_lib_send_msg_resp_commit(union octep_cp_msg_info *ctx,
+				      struct octep_cp_msg *msg)
+{
+	if (state != CP_LIB_STATE_READY)
+		return -EAGAIN;
+
+	if (!ctx || !msg)
+		return -EINVAL;
+
+	return sops->send_msg_resp_commit(ctx, msg);
+}
+
 __attribute__((visibility("default")))
 int octep_cp_lib_send_event(struct octep_cp_event_info *info)
 {
@@ -150,6 +224,18 @@ int octep_cp_lib_send_event(struct octep_cp_event_info *info)
 	return sops->send_event(info);
 }
 
+__attribute__((visibility("default")))
+int octep_cp_lib_send_events(struct octep_cp_event_info *info, int num)
+{
+	if (state != CP_LIB_STATE_READY)
+		return -EAGAIN;
+
+	if (!info || num <= 0)
+		return -EINVAL;
+
+	return sops->send_events(info, num);
+}
+
 __attribute__((visibility("default")))
 int octep_cp_lib_recv_event(struct octep_cp_event_info *info, int num)
 {
@@ -164,6 +250,39 @@ int octep_cp_lib_recv_event(struct octep_cp_event_info *info, int num)
 	return sops->recv_event(info, num);
 }
 
+__attribute__((visibility("default")))
+int octep_cp_lib_get_event_fds(int *fds, int num)
+{
+	if (state != CP_LIB_STATE_READY)
+		return -EAGAIN;
+
+	if (!fds || num <= 0)
+		return -EINVAL;
+
+	return sops->get_event_fds(fds, num);
+}
+
+__attribute__((visibility("default")))
+int octep_cp_lib_get_active_pfs(struct octep_cp_active_pf *pfs, int num)
+{
+	if (state != CP_LIB_STATE_READY)
+		return -EAGAIN;
+
+	if (!pfs || num <= 0)
+		return -EINVAL;
+
+	return sops->get_active_pfs(pfs, num);
+}
+
+__attribute__((visibility("default")))
+int octep_cp_lib_flush_intrs(int force)
+{
+	if (state != CP_LIB_STATE_READY)
+		return -EAGAIN;
+
+	return sops->flush_intrs(force);
+}
+
 __attribute__((visibility("default")))
 int octep_cp_lib_uninit()
 {
@@ -174,6 +293,7 @@ int octep_cp_lib_uninit()
 
 	state = CP_LIB_STATE_UNINIT;
 	sops->uninit();
+	cp_stats_uninit();
 	memset(&user_cfg, 0, sizeof(struct octep_cp_lib_cfg));
 	sops = NULL;
 	state = CP_LIB_STATE_INVALID;
@@ -15,6 +15,7 @@
 #include "octep_cp_lib.h"
 #include "octep_ctrl_net.h"
 #include "octep_plugin_client.h"
+#include "cp_log.h"
 
 #define PLUGIN_VERSION_MAJOR		1
 #define PLUGIN_VERSION_MINOR		1
@@ -86,7 +87,7 @@ static int octep_plugin_client_send_msg(int cmd, int data, struct octep_plugin_d
 	tv_ref.tv_sec = 5;
 	ret = send(plugin_client.client_sockfd, &msg, msg_sz, 0);
 	if (ret != msg_sz) {
-		printf("PLUGIN_CLIENT: Cmd to server send unsuccessful!\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Cmd to server send unsuccessful!\n");
 		return -EIO;
 	}
 
@@ -94,8 +95,8 @@ static int octep_plugin_client_send_msg(int cmd, int data, struct octep_plugin_d
 	while (true) {
 		gettimeofday(&tv_a, NULL);
 		if ((tv_a.tv_sec - tv_b.tv_sec) >= tv_ref.tv_sec) {
-			printf("PLUGIN_CLIENT: Cmd to server %d timed out after %ld\n",
-			       cmd, tv_a.tv_sec);
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Cmd to server %d timed out after %ld\n",
+				   cmd, tv_a.tv_sec);
 			return -EIO;
 		}
 
@@ -104,21 +105,21 @@ static int octep_plugin_client_send_msg(int cmd, int data, struct octep_plugin_d
 
 		ret = read(plugin_client.client_sockfd, &reply.hdr, sizeof(reply.hdr));
 		if (ret == 0) {
-			printf("PLUGIN_CLIENT: Server connection closed unexpectedly\n");
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Server connection closed unexpectedly\n");
 			return -EIO;
 		}
 
 		ret = read(plugin_client.client_sockfd, &reply.data, reply.hdr.sz);
 		if (ret != reply.hdr.sz) {
-			printf("PLUGIN_CLIENT: Unexpected response size %d of %d expected\n",
-					ret, reply.hdr.sz);
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Unexpected response size %d of %d expected\n",
+				   ret, reply.hdr.sz);
 			return -EIO;
 		}
 
 		if (reply.hdr.id == OCTEP_PLUGIN_S2C_MSG_PLUGIN_RESP)
 			break;
 
-		printf("PLUGIN_CLIENT: Cmd to server failed, obtained invalid response from server\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Cmd to server failed, obtained invalid response from server\n");
 		return -EIO;
 	}
 
@@ -136,21 +137,21 @@ static int octep_plugin_client_host_version_get(void)
 	while (true) {
 		gettimeofday(&tv_a, NULL);
 		if ((tv_a.tv_sec - tv_b.tv_sec) >= tv_ref.tv_sec) {
-			printf("PLUGIN_CLIENT: Host version get timed out after %ld\n",
-			       tv_a.tv_sec);
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Host version get timed out after %ld\n",
+				   tv_a.tv_sec);
 			return -EIO;
 		}
 
 		ret = read(plugin_client.client_sockfd, &reply.hdr, sizeof(reply.hdr));
 		if (ret == 0) {
-			printf("PLUGIN_CLIENT: Server connection closed unexpectedly\n");
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Server connection closed unexpectedly\n");
 			return -EIO;
 		}
 
 		ret = read(plugin_client.client_sockfd, &reply.data, reply.hdr.sz);
 		if (ret != reply.hdr.sz) {
-			printf("PLUGIN_CLIENT: Unexpected response size %d of %d expected\n",
-					ret, reply.hdr.sz);
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Unexpected response size %d of %d expected\n",
+				   ret, reply.hdr.sz);
 			return -EIO;
 		}
 
@@ -158,9 +159,9 @@ static int octep_plugin_client_host_version_get(void)
 			break;
 
 		if (reply.hdr.id != OCTEP_PLUGIN_S2C_MSG_HOST_VERSION) {
-			printf("PLUGIN_CLIENT: Obtained invalid message from server %d."
-			       "Expecting host version\n",
-			       reply.hdr.id);
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Obtained invalid message from server %d."
+				   "Expecting host version\n",
+				   reply.hdr.id);
 			return -EIO;
 		}
 
@@ -183,7 +184,7 @@ int octep_plugin_client_start(void)
 	int ret;
 
 	if (plugin_client.state != OCTEP_PLUGIN_CLIENT_STATE_INIT) {
-		printf("PLUGIN_CLIENT: Cannot start already started or uninitialised client\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Cannot start already started or uninitialised client\n");
 		return -EINVAL;
 	}
 
@@ -195,24 +196,24 @@ int octep_plugin_client_start(void)
 	}
 
 	plugin_client.state = OCTEP_PLUGIN_CLIENT_STATE_CONNECTED;
-	printf("PLUGIN_CLIENT: Connected to PLUGIN SERVER successfully at port %d\n",
-		OCTEP_PLUGIN_SERVER_PORT);
+	CP_LIB_LOG(INFO, PLUGIN_CLIENT, "Connected to PLUGIN SERVER successfully at port %d\n",
+		   OCTEP_PLUGIN_SERVER_PORT);
 
 	ret = octep_plugin_client_send_msg(OCTEP_PLUGIN_C2S_MSG_INIT, OCTEP_PLUGIN_CLIENT_VERSION,
 				       NULL);
 	if (ret < 0) {
-		printf("PLUGIN_CLIENT: Plugin client start failed\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Plugin client start failed\n");
 		errno = -ret;
 		goto error;
 	}
 
-	printf("PLUGIN_CLIENT: Successfully exchanged version between plugin client and server: v%d\n",
-	       OCTEP_PLUGIN_CLIENT_VERSION);
+	CP_LIB_LOG(INFO, PLUGIN_CLIENT, "Successfully exchanged version between plugin client and server: v%d\n",
+		   OCTEP_PLUGIN_CLIENT_VERSION);
 
 	ret = octep_plugin_client_host_version_get();
 	if (ret < 0) {
-		printf("PLUGIN_CLIENT: Host version get failed with err %d. Uninitialising...\n",
-		       ret);
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Host version get failed with err %d. Uninitialising...\n",
+			   ret);
 		goto error;
 	}
 
@@ -233,12 +234,12 @@ int octep_plugin_client_dev_register(struct octep_plugin_dev_id *id)
 	int i, ret;
 
 	if (plugin_client.state != OCTEP_PLUGIN_CLIENT_STATE_CONNECTED) {
-		printf("PLUGIN_CLIENT: Client not connected to server yet to register\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Client not connected to server yet to register\n");
 		return -EINVAL;
 	}
 
 	if (!id || id->pem == OCTEP_PLUGIN_MAX_PEM || id->pf == OCTEP_PLUGIN_MAX_PF_PER_PEM) {
-		printf("PLUGIN_CLIENT: Invalid device id\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Invalid device id\n");
 		return -EINVAL;
 	}
 
@@ -246,32 +247,35 @@ int octep_plugin_client_dev_register(struct octep_plugin_dev_id *id)
 		if (plugin_client.dev_list[i].pem == id->pem &&
 		    plugin_client.dev_list[i].pf == id->pf &&
 		    plugin_client.dev_list[i].vf == id->vf) {
-			printf("PLUGIN_CLIENT: Device pem%d:pf%d",
-			       id->pem, id->pf);
 			if (id->vf != OCTEP_PLUGIN_INVALID_VF_IDX)
-				printf(":vf%d ", id->vf);
-			printf("already registered\n");
+				CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Device pem%d:pf%d:vf%d already registered\n",
+					   id->pem, id->pf, id->vf);
+			else
+				CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Device pem%d:pf%d already registered\n",
+					   id->pem, id->pf);
 			return -EINVAL;
 		}
 	}
 
 	if (plugin_client.num_devs == OCTEP_PLUGIN_CLIENT_MAX_DEVICES) {
-		printf("PLUGIN_CLIENT: Device registration failed, no more free entries\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Device registration failed, no more free entries\n");
 		return -ENOMEM;
 	}
 
 	ret = octep_plugin_client_send_msg(OCTEP_PLUGIN_C2S_MSG_DEV_REGISTER, 0, id);
 	if (ret < 0) {
-		printf("PLUGIN_CLIENT: Device register send cmd failed\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Device register send cmd failed\n");
 		return ret;
 	}
 
 	memcpy(&plugin_client.dev_list[plugin_client.num_devs], id, sizeof(*id));
 	plugin_client.num_devs++;
-	printf("PLUGIN_CLIENT: Device pem%d::pf%d", id->pem, id->pf);
 	if (id->vf != OCTEP_PLUGIN_INVALID_VF_IDX)
-		printf("::vf%d ", id->vf);
-	printf("registered successfully\n");
+		CP_LIB_LOG(INFO, PLUGIN_CLIENT, "Device pem%d::pf%d::vf%d registered successfully\n",
+			   id->pem, id->pf, id->vf);
+	else
+		CP_LIB_LOG(INFO, PLUGIN_CLIENT, "Device pem%d::pf%d registered successfully\n",
+			   id->pem, id->pf);
 
 	return 0;
 }
@@ -281,14 +285,14 @@ int octep_plugin_client_dev_unregister(struct octep_plugin_dev_id *id)
 	int i, ret, err = 0, num_devs = plugin_client.num_devs;
 
 	if (plugin_client.state != OCTEP_PLUGIN_CLIENT_STATE_CONNECTED) {
-		printf("PLUGIN_CLIENT: Client not connected to server yet to unregister anything\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Client not connected to server yet to unregister anything\n");
 		return -EINVAL;
 	}
 
 	if (id) {
 		ret = octep_plugin_client_send_msg(OCTEP_PLUGIN_C2S_MSG_DEV_UNREGISTER, 0, id);
 		if (ret < 0)
-			printf("PLUGIN_CLIENT: Device unregistration send cmd failed\n");
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Device unregistration send cmd failed\n");
 		else
 			plugin_client.num_devs--;
 
@@ -300,7 +304,7 @@ int octep_plugin_client_dev_unregister(struct octep_plugin_dev_id *id)
 					       &plugin_client.dev_list[i]);
 		if (ret < 0) {
 			err = ret;
-			printf("PLUGIN_CLIENT: Device unregistration send cmd failed\n");
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Device unregistration send cmd failed\n");
 			continue;
 		}
 		plugin_client.num_devs--;
@@ -330,7 +334,7 @@ int octep_plugin_client_stop(void)
 	}
 
 	if (err)
-		printf("PLUGIN_CLIENT: Client stop failed\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Client stop failed\n");
 
 	return err;
 }
@@ -342,12 +346,12 @@ int octep_plugin_client_poll(struct octep_plugin_msg *msg)
 	uint8_t *buf;
 
 	if (plugin_client.state != OCTEP_PLUGIN_CLIENT_STATE_CONNECTED) {
-		printf("PLUGIN_CLIENT: Poll error, client is not in connected state\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Poll error, client is not in connected state\n");
 		return -EINVAL;
 	}
 
 	if (!msg) {
-		printf("PLUGIN_CLIENT: Null msg pointer provided\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Null msg pointer provided\n");
 		return -EINVAL;
 	}
 
@@ -370,20 +374,20 @@ int octep_plugin_client_poll(struct octep_plugin_msg *msg)
 	ret = read(plugin_client.client_sockfd, &msg->hdr,
 		   sizeof(msg->hdr));
 	if (ret == 0) {
-		printf("PLUGIN_CLIENT: Server connection closed unexpectedly\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Server connection closed unexpectedly\n");
 		return -EIO;
 	} else if (ret > 0) {
 		if (msg->hdr.id != OCTEP_PLUGIN_S2C_MSG_CTRL_NET &&
 		    msg->hdr.id != OCTEP_PLUGIN_S2C_MSG_HOST_VERSION) {
-			printf("PLUGIN_CLIENT: Unexpected msg id %d\n", msg->hdr.id);
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Unexpected msg id %d\n", msg->hdr.id);
 			return -EIO;
 		}
 
 		ret = read(plugin_client.client_sockfd, &msg->data,
 			   msg->hdr.sz);
 		if (ret != msg->hdr.sz) {
-			printf("PLUGIN_CLIENT: Unexpected msg size read, %d of %d specified\n",
-			       ret, msg->hdr.sz);
+			CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Unexpected msg size read, %d of %d specified\n",
+				   ret, msg->hdr.sz);
 			return -EIO;
 		}
 
@@ -396,8 +400,8 @@ int octep_plugin_client_poll(struct octep_plugin_msg *msg)
 			ret = read(plugin_client.client_sockfd, buf,
 			     cp_msg->sg_list[i].sz);
 			if (ret != cp_msg->sg_list[i].sz) {
-				printf("PLUGIN_CLIENT: Unexpected sg_list[%d] size read, %d of %d specified\n",
-				       i, ret, cp_msg->sg_list[i].sz);
+				CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Unexpected sg_list[%d] size read, %d of %d specified\n",
+					   i, ret, cp_msg->sg_list[i].sz);
 				return -EIO;
 			}
 			cp_msg->sg_list[i].msg = buf;
@@ -406,7 +410,7 @@ int octep_plugin_client_poll(struct octep_plugin_msg *msg)
 
 		return msg->hdr.sz;
 	} else if ((errno != EAGAIN) || (errno != EWOULDBLOCK)) {
-		printf("PLUGIN_CLIENT: Read error on socket\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Read error on socket\n");
 		return -errno;
 	}
 
@@ -420,12 +424,12 @@ int octep_plugin_client_send_notification(struct octep_plugin_msg *msg)
 	uint8_t *buf;
 
 	if (plugin_client.state != OCTEP_PLUGIN_CLIENT_STATE_CONNECTED) {
-		printf("PLUGIN_CLIENT: Send notif error, client is not in connected state\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Send notif error, client is not in connected state\n");
 		return -EINVAL;
 	}
 
 	if (!msg) {
-		printf("PLUGIN_CLIENT: Invalid plugin msg\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Invalid plugin msg\n");
 		return -EINVAL;
 	}
 
@@ -446,15 +450,15 @@ int octep_plugin_client_send_notification(struct octep_plugin_msg *msg)
 			ret = send(plugin_client.client_sockfd, msg,
 				   msg_sz, 0);
 			if (ret != msg_sz) {
-				printf("PLUGIN_CLIENT: Send notif/response failed, socket send unsuccessful\n");
+				CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Send notif/response failed, socket send unsuccessful\n");
 				return -EIO;
 			}
-			printf("PLUGIN_CLIENT: Notif/Response sent successfully\n");
+			CP_LIB_LOG(DEBUG, PLUGIN_CLIENT, "Notif/Response sent successfully\n");
 			return 0;
 		}
 	}
 
-	printf("PLUGIN_CLIENT: Send notif failed, target dev does not belong to app\n");
+	CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Send notif failed, target dev does not belong to app\n");
 	return -EINVAL;
 }
 
@@ -470,7 +474,7 @@ int octep_plugin_client_get_state(uint32_t *state)
 int octep_plugin_client_uninit(void)
 {
 	if (plugin_client.state != OCTEP_PLUGIN_CLIENT_STATE_INVALID) {
-		printf("PLUGIN_CLIENT: Error, client needs to stop before uninitialising\n");
+		CP_LIB_LOG(ERR, PLUGIN_CLIENT, "Error, client needs to stop before uninitialising\n");
 		return -EINVAL;
 	}
 
@@ -13,6 +13,7 @@
 #include "octep_ctrl_net.h"
 #include "octep_plugin_server.h"
 #include "octep_plugin_server_config.h"
+#include "cp_log.h"
 
 #define PLUGIN_VERSION_MAJOR		1
 #define PLUGIN_VERSION_MINOR		1
@@ -91,8 +92,8 @@ static int plugin_fwd_to_app(int sockfd, struct octep_plugin_msg *msg)
 sock_send:
 	ret = send(sockfd, msg, msg->hdr.sz + sizeof(msg->hdr) + total_sz, 0);
 	if (ret != (msg->hdr.sz + sizeof(msg->hdr) + total_sz)) {
-		printf("PLUGIN_SERVER: Send error: Could only send %d bytes out of %ld total bytes to app\n",
-		       ret, sizeof(*msg));
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Send error: Could only send %d bytes out of %ld total bytes to app\n",
+			   ret, sizeof(*msg));
 		return -EIO;
 	}
 
@@ -226,8 +227,8 @@ static void plugin_handle_client_msg(struct plugin_client_app *client, struct oc
 		break;
 	case OCTEP_PLUGIN_C2S_MSG_DEV_REGISTER:
 		if (client->state < OCTEP_PLUGIN_CLIENT_STATE_INIT) {
-			printf("PLUGIN_SERVER: Client %d has not initialised yet to register\n",
-			       client->client_id);
+			CP_LIB_LOG(ERR, PLUGIN_SERVER, "Client %d has not initialised yet to register\n",
+				   client->client_id);
 			plugin_send_response(client->sockfd, msg, false);
 			break;
 		}
@@ -244,23 +245,23 @@ static void plugin_handle_client_msg(struct plugin_client_app *client, struct oc
 			client->num_devs++;
 			plugin_send_response(client->sockfd, msg, true);
 		} else {
-			printf("PLUGIN_SERVER: Invalid interface requested by client\n");
+			CP_LIB_LOG(ERR, PLUGIN_SERVER, "Invalid interface requested by client\n");
 			plugin_send_response(client->sockfd, msg, false);
 		}
 
 		break;
 	case OCTEP_PLUGIN_C2S_MSG_DEV_UNREGISTER:
 		if (client->state < OCTEP_PLUGIN_CLIENT_STATE_REGD) {
-			printf("PLUGIN_SERVER: Client %d has not registered any device yet\n",
-			       client->client_id);
+			CP_LIB_LOG(ERR, PLUGIN_SERVER, "Client %d has not registered any device yet\n",
+				   client->client_id);
 			return;
 		}
 
 		plugin_context_prep(&ctx, &msg->hdr.dev_id);
 		fn = plugin_app_config_get_fn(&cfg, &ctx);
 		if (!fn->plugin_controlled || fn->client_id != client->client_id) {
-			printf("PLUGIN_SERVER: Client %d sent unregister for invalid interface\n",
-			       client->client_id);
+			CP_LIB_LOG(ERR, PLUGIN_SERVER, "Client %d sent unregister for invalid interface\n",
+				   client->client_id);
 			return;
 		}
 		fn->client_id = OCTEP_PLUGIN_INVALID_CLIENT_ID;
@@ -270,8 +271,8 @@ static void plugin_handle_client_msg(struct plugin_client_app *client, struct oc
 			client->state = OCTEP_PLUGIN_CLIENT_STATE_INIT;
 		break;
 	default:
-		printf("PLUGIN_SERVER: Invalid request to plugin server from client %d\n",
-		       client->client_id);
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Invalid request to plugin server from client %d\n",
+			   client->client_id);
 		plugin_send_response(client->sockfd, msg, false);
 		break;
 	};
@@ -296,12 +297,12 @@ static void plugin_fwd_to_host(struct plugin_client_app *client, struct octep_pl
 	fn = plugin_app_config_get_fn(&cfg, &ctx);
 
 	if (client->state != OCTEP_PLUGIN_CLIENT_STATE_REGD) {
-		printf("PLUGIN_SERVER: Client %d has not registered to any valid interface yet\n",
-				client->client_id);
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Client %d has not registered to any valid interface yet\n",
+			   client->client_id);
 		return;
 	} else if (fn->client_id != client->client_id) {
-		printf("PLUGIN_SERVER: Client %d trying to send ctrl_net to unregistered interface\n",
-				client->client_id);
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Client %d trying to send ctrl_net to unregistered interface\n",
+			   client->client_id);
 		return;
 	}
 
@@ -310,8 +311,8 @@ static void plugin_fwd_to_host(struct plugin_client_app *client, struct octep_pl
 	for (i = 0; i < cp_msg->sg_num; i++) {
 		ret = read(client->sockfd, buf, cp_msg->sg_list[i].sz);
 		if (ret != cp_msg->sg_list[i].sz) {
-			printf("PLUGIN_SERVER: Incomplete "
-					"sg received\n");
+			CP_LIB_LOG(ERR, PLUGIN_SERVER, "Incomplete "
+				   "sg received\n");
 			continue;
 		}
 		cp_msg->sg_list[i].msg = buf;
@@ -323,20 +324,20 @@ static void plugin_fwd_to_host(struct plugin_client_app *client, struct octep_pl
 		octep_plugin_server_ctrl_net_lock();
 		ret = octep_cp_lib_send_notification(&ctx, (struct octep_cp_msg *) &msg->data);
 		if (ret < 0)
-			printf("PLUGIN_SERVER: Notification fwd to host failed with err %d\n",
-			       ret);
+			CP_LIB_LOG(ERR, PLUGIN_SERVER, "Notification fwd to host failed with err %d\n",
+				   ret);
 		octep_plugin_server_ctrl_net_unlock();
 		break;
 	case OCTEP_PLUGIN_C2S_MSG_CTRL_NET_RESP:
 		octep_plugin_server_ctrl_net_lock();
 		ret = octep_cp_lib_send_msg_resp(&ctx, (struct octep_cp_msg *) &msg->data, 1);
 		if (ret < 0)
-			printf("PLUGIN_SERVER: Response fwd to host failed with err %d\n",
-			       ret);
+			CP_LIB_LOG(ERR, PLUGIN_SERVER, "Response fwd to host failed with err %d\n",
+				   ret);
 		octep_plugin_server_ctrl_net_unlock();
 		break;
 	default:
-		printf("PLUGIN_SERVER: Unsupported ctrl net msg from client\n");
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Unsupported ctrl net msg from client\n");
 	}
 
 }
@@ -387,8 +388,8 @@ static void *octep_plugin_server_loop(void *arg)
 		 */
 		ret = select(max_sockfd + 1, &plugin_client_fdset, NULL, NULL, &tm);
 		if ((ret < 0) && (errno != EINTR)) {
-			printf("PLUGIN_SERVER: Select return %d on error: %s",
-			       ret, strerror(errno));
+			CP_LIB_LOG(ERR, PLUGIN_SERVER, "Select return %d on error: %s",
+				   ret, strerror(errno));
 			return NULL;
 		}
 
@@ -413,11 +414,11 @@ static void *octep_plugin_server_loop(void *arg)
 			}
 
 			if (i == OCTEP_PLUGIN_MAX_CLIENTS) {
-				printf("PLUGIN_SERVER: Unable to connect %s as number of clients saturated",
-				       s);
+				CP_LIB_LOG(ERR, PLUGIN_SERVER, "Unable to connect %s as number of clients saturated",
+					   s);
 				close(client_sockfd);
 			}
-			printf("PLUGIN_SERVER: New connection from client: %s\n", s);
+			CP_LIB_LOG(INFO, PLUGIN_SERVER, "New connection from client: %s\n", s);
 		}
 
 		for (i = 0; i < OCTEP_PLUGIN_MAX_CLIENTS; i++) {
@@ -432,7 +433,7 @@ static void *octep_plugin_server_loop(void *arg)
 						    (socklen_t *) &peer_sz);
 					in_addr = get_in_addr((struct sockaddr *)&peer_addr);
 					inet_ntop(peer_addr.sin_family, in_addr, s, sizeof(s));
-					printf("PLUGIN_SERVER: Client %s disconnected", s);
+					CP_LIB_LOG(INFO, PLUGIN_SERVER, "Client %s disconnected", s);
 					close(client_sockfd);
 					plugin_client[i].sockfd =
 					OCTEP_PLUGIN_INVALID_CLIENT_SOCKFD;
@@ -442,7 +443,7 @@ static void *octep_plugin_server_loop(void *arg)
 					octep_plugin_client_msg_hdr_dump(&msg);
 					ret = read(client_sockfd, &msg.data, msg.hdr.sz);
 					if (ret < msg.hdr.sz) {
-						printf("PLUGIN_SERVER: Incomplete msg received!\n");
+						CP_LIB_LOG(ERR, PLUGIN_SERVER, "Incomplete msg received!\n");
 						continue;
 					}
 
@@ -504,7 +505,7 @@ int octep_plugin_server_init(struct plugin_app_cfg *app_cfg)
 	socklen_t len;
 
 	if (!app_cfg) {
-		printf("PLUGIN_SERVER: Init failed due to null cfg!");
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Init failed due to null cfg!");
 		return -EINVAL;
 	}
 
@@ -516,7 +517,7 @@ int octep_plugin_server_init(struct plugin_app_cfg *app_cfg)
 
 	err = setsockopt(server_sockfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int));
 	if (err < 0) {
-		printf("PLUGIN_SERVER: Error in setsockopt: %s\n", strerror(errno));
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Error in setsockopt: %s\n", strerror(errno));
 		close(server_sockfd);
 		return -errno;
 	}
@@ -524,40 +525,40 @@ int octep_plugin_server_init(struct plugin_app_cfg *app_cfg)
 	len = sizeof(struct sockaddr_in);
 	err = bind(server_sockfd, (struct sockaddr *)&server_addr, len);
 	if (err < 0) {
-		printf("PLUGIN_SERVER: Error in bind: %s\n", strerror(errno));
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Error in bind: %s\n", strerror(errno));
 		close(server_sockfd);
 		return -errno;
 	}
 
 	err = getsockname(server_sockfd, (struct sockaddr *)&sockaddr, &len);
 	if (err < 0) {
-		printf("PLUGIN_SERVER: Error in getsockname: %s\n", strerror(errno));
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Error in getsockname: %s\n", strerror(errno));
 		close(server_sockfd);
 		return -errno;
 	}
 
 	err = listen(server_sockfd, 1);
 	if (err < 0) {
-		printf("PLUGIN_SERVER: Error in listen: %s\n", strerror(errno));
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Error in listen: %s\n", strerror(errno));
 		close(server_sockfd);
 		return -errno;
 	}
 
 	err = pthread_mutex_init(&plugin_server.ctrl_net_lock, NULL);
 	if (err) {
-		printf("PLUGIN_SERVER: Error on ctrl net lock init, err %d\n", err);
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Error on ctrl net lock init, err %d\n", err);
 		return err;
 	}
 
 	err = pthread_create(&process_thread, NULL, octep_plugin_server_loop, NULL);
 	if (err) {
-		printf("PLUGIN_SERVER: Error while starting server thread: %s\n",
-				strerror(errno));
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Error while starting server thread: %s\n",
+			   strerror(errno));
 		return err;
 	}
 
-	printf("Listening on %s:%d\n",
-			inet_ntoa(sockaddr.sin_addr), sockaddr.sin_port);
+	CP_LIB_LOG(INFO, PLUGIN_SERVER, "Listening on %s:%d\n",
+		   inet_ntoa(sockaddr.sin_addr), sockaddr.sin_port);
 
 	memcpy(&cfg, app_cfg, sizeof(*app_cfg));
 
@@ -598,10 +599,10 @@ int octep_plugin_server_process_msg(struct octep_cp_msg *msg)
 
 	sockfd = find_plugin_client_connection(fn->client_id);
 	if (sockfd == OCTEP_PLUGIN_INVALID_CLIENT_SOCKFD) {
-		printf("PLUGIN_SERVER: Request from unregistered client controlled interface "
-		       "pem[%d]pf[%d]vf[%d] or interface points to stale client sockfd (client_id: %d)\n",
-		       msg->info.s.pem_idx, msg->info.s.pf_idx,
-		       msg->info.s.vf_idx, fn->client_id);
+		CP_LIB_LOG(ERR, PLUGIN_SERVER, "Request from unregistered client controlled interface "
+			   "pem[%d]pf[%d]vf[%d] or interface points to stale client sockfd (client_id: %d)\n",
+			   msg->info.s.pem_idx, msg->info.s.pf_idx,
+			   msg->info.s.vf_idx, fn->client_id);
 		return -EINVAL;
 	}
 
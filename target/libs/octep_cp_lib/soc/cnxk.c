@@ -4,13 +4,14 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <dirent.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "octep_ctrl_mbox.h"
 #include "octep_ctrl_net.h"
@@ -18,20 +19,32 @@
 #include "octep_cp_lib.h"
 #include "cp_compat.h"
 #include "cp_log.h"
+#include "cp_stats.h"
 #include "cp_lib.h"
 #include "cnxk.h"
 #include "cnxk_hw.h"
+#include "discover.h"
 
 /* library defines OCTEP_CP_PF_PER_DOM_MAX pf's per pem,
  * there are 16 4mb slots in bar4, we assign 1 slot per pem,
- * so each pf will get 4mb/OCTEP_CP_PF_PER_DOM_MAX = 32768 bytes for mbox.
+ * host finds pf mbox at pf_idx * (4mb/OCTEP_CP_PF_PER_DOM_MAX = 32768 bytes)
+ * in the slot. A pf mbox can extend over slots of pf's that are not
+ * configured, see alloc_mbox().
  */
 #define MBOX_SZ		(size_t)(PEMX_BAR4_INDEX_SIZE / OCTEP_CP_PF_PER_DOM_MAX)
+/* minimum mbox size, info + 2 queues with 2 minimal elements each */
+#define MBOX_MIN_SZ	(size_t)(512)
 
 #define PEM_BAR4_INDEX 8
 #define PEM_BAR4_INDEX_SIZE 0x400000ULL
 #define PEM_BAR4_INDEX_ADDR (PEM_BAR4_INDEX * PEM_BAR4_INDEX_SIZE)
 #define PEM_STATUS_WAIT_TIMEOUT	10
+/* pem status poll interval, doubled from min to max while pem is off so
+ * that a pem coming back from perst is seen within microseconds
+ */
+#define PEM_STATUS_POLL_MIN_NS	10000ULL
+#define PEM_STATUS_POLL_MAX_NS	10000000ULL
+#define HOST_CHECK_INTERVAL_NS	(OCTEP_CP_HOST_CHECK_MS * 1000000ULL)
 
 struct cnxk_pf {
 	/* pf is valid */
@@ -40,12 +53,48 @@ struct cnxk_pf {
 	unsigned long long idx;
 	/* mapped bar4 memory slot address */
 	uint64_t bar4_addr;
+	/* size of mbox memory at bar4_addr */
+	size_t mbox_sz;
 	/* address of oei_trig register for interrupts */
 	void* oei_trig_addr;
-	/* offset from mapped address where actual data starts */
-	off_t oei_trig_offset;
+	/* fd written on interrupts of simulated soc, used instead of oei_trig */
+	int oei_fd;
 	/* pf mbox */
 	struct octep_ctrl_mbox mbox;
+	/* host ready state reported in last host event */
+	bool host_reported;
+	/* time of last host status check */
+	uint64_t host_check_ns;
+	/* index in active_pfs if host is ready, protected by active_lock */
+	int active_idx;
+	/* counters of pf, followed by counters of its vf's */
+	struct octep_cp_stats *stats;
+	/* ring of responses waiting for space in fw-to-host queue, each
+	 * with a single buffer owned by the ring
+	 */
+	struct octep_cp_msg *tx_q;
+	/* ring size, head and count */
+	uint16_t tx_q_sz;
+	uint16_t tx_q_head;
+	uint16_t tx_q_cnt;
+	/* enum octep_cp_tx_backlog_policy */
+	uint8_t tx_q_policy;
+	/* interrupt moderation, messages and nsecs before interrupt is
+	 * raised, disabled if oei_max_ns is 0
+	 */
+	uint16_t oei_max_msgs;
+	uint64_t oei_max_ns;
+	/* messages sent without interrupt and time of first of them */
+	uint32_t oei_pending;
+	uint64_t oei_pending_ns;
+	/* fan-out notification held for debounce since notify_ns, with a
+	 * single buffer owned by pf, disabled if notify_max_ns is 0
+	 */
+	bool notify_held;
+	struct octep_cp_msg notify_msg;
+	struct octep_cp_fn_set notify_fns;
+	uint64_t notify_ns;
+	uint64_t notify_max_ns;
 };
 
 struct cnxk_pem {
@@ -53,47 +102,334 @@ struct cnxk_pem {
 	bool valid;
 	/* index of pem */
 	unsigned long long idx;
-	/* file descriptor for uio interrupt */
+	/* file descriptor for uio interrupt, 0 if perst is not signalled
+	 * on a fd
+	 */
 	int uio_fd;
+	/* bar4 memory shared by mailboxes of all pf's, bar4_va maps the
+	 * whole pem bar4 slot, NULL if mailboxes use fd access
+	 */
+	int bar4_fd;
+	void *bar4_va;
+	/* configured pem left uninitialized by cnxk_init as its link was
+	 * down, link is rechecked with its csr's kept mapped until it is
+	 * reported up
+	 */
+	bool late;
+	/* counters of pem */
+	struct octep_cp_stats *stats;
+	/* pem csr's mapped by map_pem_csrs(), NULL for simulated soc */
+	void *on_csr;
+	void *dis_port_csr;
+	void *fw_ready_csr;
 	/* array of pf's */
 	struct cnxk_pf pfs[OCTEP_CP_PF_PER_DOM_MAX];
 };
 
 static struct cnxk_pem pems[OCTEP_CP_DOM_MAX] = { 0 };
+/* pem index of each domain in configuration, -1 if not configured,
+ * pems[] is indexed by pem
+ */
+static int dom_pems[OCTEP_CP_DOM_MAX];
+
+static int check_pem_status(int pem_idx, int wait);
+static int open_pem_uiodev(int pem_idx);
+static int open_pem_bar4(int pem_idx);
+static int set_fw_ready(int pem_idx, int pf_idx, int status);
+static void drop_tx_q(struct cnxk_pf *pf, int n, bool count);
+static void drop_oei(struct cnxk_pf *pf);
+static void drop_notify(struct cnxk_pf *pf);
+static int map_pem_csrs(int pem_idx);
+static void unmap_pem_csrs(int pem_idx);
+
+static const struct cnxk_hw_ops cnxk_hw_ops = {
+	.check_pem = check_pem_status,
+	.open_perst_fd = open_pem_uiodev,
+	.open_bar4 = open_pem_bar4,
+	.open_oei_fd = NULL,
+	.set_fw_ready = set_fw_ready,
+	.map_csrs = map_pem_csrs,
+	.unmap_csrs = unmap_pem_csrs,
+};
+
+/* hardware access, replaced by simulated soc */
+static const struct cnxk_hw_ops *hw = &cnxk_hw_ops;
+
+/* largest cache line of supported soc's */
+#define CNXK_CACHE_LINE_SZ	128
+
+/* Locks are kept outside pems[] as pem data is cleared on reinit.
+ * pf lock serializes access to mailbox and registers of a pf, so that
+ * different pf's can be serviced from different threads concurrently.
+ * pem lock serializes pem state, pem init and uninit hold pem lock and
+ * all pf locks of the pem.
+ */
+struct cnxk_lock {
+	pthread_mutex_t m;
+} __attribute__((aligned(CNXK_CACHE_LINE_SZ)));
+
+/* pf's with a ready host, kept dense so that polling cost scales with
+ * loaded host drivers. Lock order is pem lock, pf lock, active_lock.
+ */
+static struct octep_cp_active_pf active_pfs[OCTEP_CP_DOM_MAX *
+					    OCTEP_CP_PF_PER_DOM_MAX]
+	__attribute__((aligned(CNXK_CACHE_LINE_SZ)));
+static int num_active_pfs = 0;
+/* time of last host status check of all pf's */
+static uint64_t host_scan_ns = 0;
+/* host ready/gone transitions are pending to be reported */
+static bool host_events_pending = false;
+/* number of pf's with an interrupt deferred by moderation */
+static int oei_deferred_pfs = 0;
+/* number of pf's with a notification held for debounce */
+static int notify_held_pfs = 0;
+static pthread_mutex_t active_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* csr page mapped from /dev/mem, shared by all csr's in the page so that
+ * csr's are mapped once at init instead of on every access.
+ */
+struct cnxk_csr_page {
+	/* physical address of page, valid if ref is not 0 */
+	off_t pg_addr;
+	/* mapped address of page */
+	void *va;
+	/* number of mapped csr's in page */
+	int ref;
+};
+
+/* pem csr pages of all pem's and oei_trig pages of all pf's of 2 sdp's */
+#define CSR_PAGES_MAX	((2 * OCTEP_CP_DOM_MAX) + (2 * OCTEP_CP_PF_PER_DOM_MAX))
+
+static struct cnxk_csr_page csr_pages[CSR_PAGES_MAX];
+/* /dev/mem, opened with first csr mapping and kept open until uninit */
+static int mem_fd = -1;
+static long csr_pg_sz = 0;
+static pthread_mutex_t csr_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct cnxk_lock pem_locks[OCTEP_CP_DOM_MAX];
+static struct cnxk_lock pf_locks[OCTEP_CP_DOM_MAX][OCTEP_CP_PF_PER_DOM_MAX];
+static bool locks_ready = false;
 
-static inline void* map_reg(unsigned long long addr, size_t len, int prot,
-			    off_t *offset)
+static void init_locks()
 {
-	off_t pg_addr, pg_offset;
-	long pg_sz;
-	void* map;
-	int fd;
+	int i, j;
 
-	fd = open("/dev/mem", O_RDWR | O_SYNC);
-	if(fd <= 0)
-		return NULL;
+	if (locks_ready)
+		return;
+
+	for (i = 0; i < OCTEP_CP_DOM_MAX; i++) {
+		pthread_mutex_init(&pem_locks[i].m, NULL);
+		for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX; j++)
+			pthread_mutex_init(&pf_locks[i][j].m, NULL);
+	}
+	locks_ready = true;
+}
+
+static void lock_pem(int pem_idx)
+{
+	int j;
+
+	pthread_mutex_lock(&pem_locks[pem_idx].m);
+	for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX; j++)
+		pthread_mutex_lock(&pf_locks[pem_idx][j].m);
+}
+
+static void unlock_pem(int pem_idx)
+{
+	int j;
 
-	pg_sz = sysconf(_SC_PAGESIZE);
-	pg_addr = ((addr / pg_sz) * pg_sz);
-	pg_offset = addr % pg_sz;
-	map = mmap(0, (pg_offset + len), prot, MAP_SHARED, fd, pg_addr);
-	if (map == (void *)MAP_FAILED) {
+	for (j = OCTEP_CP_PF_PER_DOM_MAX - 1; j >= 0; j--)
+		pthread_mutex_unlock(&pf_locks[pem_idx][j].m);
+	pthread_mutex_unlock(&pem_locks[pem_idx].m);
+}
+
+static inline uint64_t get_time_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/* Remove pf from active_pfs, called with active_lock held */
+static void remove_active_pf(struct cnxk_pf *pf)
+{
+	struct octep_cp_active_pf *last;
+
+	last = &active_pfs[--num_active_pfs];
+	if (pf->active_idx != num_active_pfs) {
+		active_pfs[pf->active_idx] = *last;
+		pems[last->dom_idx].pfs[last->pf_idx].active_idx = pf->active_idx;
+	}
+	pf->active_idx = -1;
+}
+
+/* Recheck host status of pf, called with pf lock held */
+static void update_host(struct cnxk_pem *pem, struct cnxk_pf *pf,
+			uint64_t now)
+{
+	struct octep_cp_active_pf *apf;
+	bool ready = pf->mbox.host_ready;
+
+	pf->host_check_ns = now;
+	if ((octep_ctrl_mbox_check_host(&pf->mbox) > 0) == ready)
+		return;
+
+	pthread_mutex_lock(&active_lock);
+	if (pf->mbox.host_ready) {
+		pf->active_idx = num_active_pfs++;
+		apf = &active_pfs[pf->active_idx];
+		apf->dom_idx = pem->idx;
+		apf->pf_idx = pf->idx;
+		apf->host_version = (uint32_t)pf->mbox.host_version;
+	} else {
+		remove_active_pf(pf);
+	}
+	host_events_pending = true;
+	pthread_mutex_unlock(&active_lock);
+	/* responses to a host that is gone are stale */
+	if (!pf->mbox.host_ready) {
+		drop_tx_q(pf, pf->tx_q_cnt, true);
+		drop_oei(pf);
+		drop_notify(pf);
+	}
+	CP_LIB_LOG(INFO, CNXK, "pem[%llu] pf[%llu] host %s version %lx\n",
+		   pem->idx, pf->idx, (pf->mbox.host_ready) ? "ready" : "gone",
+		   pf->mbox.host_version);
+}
+
+/* Map csr at physical address addr, sharing the mapping of its page with
+ * other csr's in the page.
+ *
+ * return value: address of csr on success, NULL on failure.
+ */
+static void *get_csr(unsigned long long addr)
+{
+	struct cnxk_csr_page *pg, *free_pg = NULL;
+	void *va = NULL;
+	off_t pg_addr;
+	int i;
+
+	pthread_mutex_lock(&csr_lock);
+	if (mem_fd < 0) {
+		mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
+		if (mem_fd < 0) {
+			CP_LIB_LOG(ERR, CNXK, "Error opening /dev/mem (%d)\n",
+				   errno);
+			goto out;
+		}
+		csr_pg_sz = sysconf(_SC_PAGESIZE);
+	}
+
+	pg_addr = ((addr / csr_pg_sz) * csr_pg_sz);
+	for (i = 0; i < CSR_PAGES_MAX; i++) {
+		pg = &csr_pages[i];
+		if (!pg->ref) {
+			if (!free_pg)
+				free_pg = pg;
+			continue;
+		}
+		if (pg->pg_addr == pg_addr)
+			goto found;
+	}
+	if (!free_pg) {
+		CP_LIB_LOG(ERR, CNXK, "No free csr page for [%llx]\n", addr);
+		goto out;
+	}
+
+	pg = free_pg;
+	pg->va = mmap(0, csr_pg_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+		      mem_fd, pg_addr);
+	if (pg->va == (void *)MAP_FAILED) {
 		CP_LIB_LOG(INFO, CNXK, "mmap[%llx] error (%d)\n",
 			   addr, errno);
-		close(fd);
-		return NULL;
+		pg->va = NULL;
+		goto out;
+	}
+	pg->pg_addr = pg_addr;
+found:
+	pg->ref++;
+	va = (uint8_t *)pg->va + (addr - pg_addr);
+out:
+	pthread_mutex_unlock(&csr_lock);
+
+	return va;
+}
+
+/* Release csr mapped by get_csr, its page is unmapped with last csr */
+static void put_csr(void *csr)
+{
+	struct cnxk_csr_page *pg;
+	int i;
+
+	pthread_mutex_lock(&csr_lock);
+	for (i = 0; i < CSR_PAGES_MAX; i++) {
+		pg = &csr_pages[i];
+		if (!pg->ref || (uint8_t *)csr < (uint8_t *)pg->va ||
+		    (uint8_t *)csr >= (uint8_t *)pg->va + csr_pg_sz)
+			continue;
+
+		if (--pg->ref == 0) {
+			munmap(pg->va, csr_pg_sz);
+			pg->va = NULL;
+		}
+		break;
 	}
-	close(fd);
+	pthread_mutex_unlock(&csr_lock);
+}
 
-	if (offset)
-		*offset = pg_offset;
+/* Close /dev/mem if no csr is mapped */
+static void close_csrs()
+{
+	int i;
+
+	pthread_mutex_lock(&csr_lock);
+	for (i = 0; i < CSR_PAGES_MAX; i++) {
+		if (csr_pages[i].ref)
+			break;
+	}
+	if (i == CSR_PAGES_MAX && mem_fd >= 0) {
+		close(mem_fd);
+		mem_fd = -1;
+	}
+	pthread_mutex_unlock(&csr_lock);
+}
 
-	return (map + pg_offset);
+static void unmap_pem_csrs(int pem_idx)
+{
+	struct cnxk_pem *pem = &pems[pem_idx];
+
+	if (pem->on_csr)
+		put_csr(pem->on_csr);
+	if (pem->dis_port_csr)
+		put_csr(pem->dis_port_csr);
+	if (pem->fw_ready_csr)
+		put_csr(pem->fw_ready_csr);
+	pem->on_csr = NULL;
+	pem->dis_port_csr = NULL;
+	pem->fw_ready_csr = NULL;
 }
 
-static inline int unmap_reg(void* addr, off_t offset, size_t len)
+static int map_pem_csrs(int pem_idx)
 {
-	return munmap((addr - offset), (len + offset));
+	struct cnxk_pem *pem = &pems[pem_idx];
+	unsigned long long base;
+
+	base = PEMX_BASE((unsigned long long)pem_idx);
+	pem->on_csr = get_csr(base + PEMX_ON_OFFSET);
+	pem->dis_port_csr = get_csr(base + PEMX_DIS_PORT_OFFSET);
+	/* for cn10k fw ready is written to pf0 VSECST_CTL directly */
+	pem->fw_ready_csr = get_csr(base + ((IS_SOC_CN10K) ?
+					    (0x8000 | CN10K_PCIEEP_VSECST_CTL) :
+					    PEMX_CFG_WR_OFFSET));
+	if (!pem->on_csr || !pem->dis_port_csr || !pem->fw_ready_csr) {
+		CP_LIB_LOG(ERR, CNXK, "Error mapping pem[%d] csr's\n",
+			   pem_idx);
+		unmap_pem_csrs(pem_idx);
+		return -EIO;
+	}
+
+	return 0;
 }
 
 static int open_oei_trig_csr(struct cnxk_pem *pem, struct cnxk_pf *pf)
@@ -103,66 +439,151 @@ static int open_oei_trig_csr(struct cnxk_pem *pem, struct cnxk_pf *pf)
 	 * PEM idx is > 1 ->  SDP1
 	 */
 	pf->oei_trig_addr =
-		map_reg(SDP0_EPFX_OEI_TRIG(((pem->idx > 1) ? 1L : 0), pf->idx),
-				    8,
-				    PROT_READ | PROT_WRITE,
-				    &pf->oei_trig_offset);
+		get_csr(SDP0_EPFX_OEI_TRIG(((pem->idx > 1) ? 1L : 0), pf->idx));
 	if (!pf->oei_trig_addr) {
 		CP_LIB_LOG(INFO, CNXK,
-			   "Error mapping pem[%d] pf[%d] oei_trig_addr(%p)\n",
+			   "Error mapping pem[%llu] pf[%llu] oei_trig_addr(%llx)\n",
 			   pem->idx, pf->idx,
 			   SDP0_EPFX_OEI_TRIG(((pem->idx > 1) ? 1L : 0), pf->idx));
 		return -EIO;
 	}
-	CP_LIB_LOG(INFO, CNXK, "pem[%d] pf[%d] oei_trig_addr %p\n",
+	CP_LIB_LOG(INFO, CNXK, "pem[%llu] pf[%llu] oei_trig_addr %p\n",
 		   pem->idx, pf->idx, pf->oei_trig_addr);
 
 	return 0;
 }
 
+/* Open and map bar4 slot of pem once for mailboxes of all pf's */
+static int open_bar4(struct cnxk_pem *pem)
+{
+	pem->bar4_fd = hw->open_bar4(pem->idx);
+	if (pem->bar4_fd <= 0) {
+		CP_LIB_LOG(ERR, CNXK, "Error opening pem[%llu] bar4 file.\n",
+			   pem->idx);
+		pem->bar4_fd = 0;
+		return -ENOMEM;
+	}
+
+	/* Prefer direct load/store on mapped bar memory, fall back to
+	 * batched pread/pwritev on the file descriptor if mapping is not
+	 * supported.
+	 */
+	pem->bar4_va = mmap(0, PEMX_BAR4_INDEX_SIZE, PROT_READ | PROT_WRITE,
+			    MAP_SHARED, pem->bar4_fd, PEMX_BAR4_INDEX_ADDR);
+	if (pem->bar4_va == (void *)MAP_FAILED) {
+		CP_LIB_LOG(INFO, CNXK,
+			   "pem[%llu] bar4 mmap error (%d), using fd access\n",
+			   pem->idx, errno);
+		pem->bar4_va = NULL;
+	}
+
+	return 0;
+}
+
+static void close_bar4(struct cnxk_pem *pem)
+{
+	if (pem->bar4_va)
+		munmap(pem->bar4_va, PEMX_BAR4_INDEX_SIZE);
+	if (pem->bar4_fd > 0)
+		close(pem->bar4_fd);
+	pem->bar4_va = NULL;
+	pem->bar4_fd = 0;
+}
+
+/* Assign bar4 memory for a pf mbox.
+ *
+ * Host drivers expect pf mbox at pf_idx * MBOX_SZ in the pem bar4 slot, so
+ * the base address is fixed. A pf mbox can use all memory up to the next
+ * configured pf in the pem or the end of the slot. The configured size
+ * must fit in this span, 0 selects the full span.
+ */
+static int alloc_mbox(struct octep_cp_dom_cfg *dom_cfg,
+		      struct octep_cp_pf_cfg *pf_cfg, struct cnxk_pf *pf)
+{
+	int j, next_idx;
+	size_t span;
+
+	next_idx = OCTEP_CP_PF_PER_DOM_MAX;
+	for (j = 0; j < dom_cfg->npfs; j++) {
+		if (dom_cfg->pfs[j].idx > pf_cfg->idx &&
+		    dom_cfg->pfs[j].idx < next_idx)
+			next_idx = dom_cfg->pfs[j].idx;
+	}
+	span = (next_idx - pf_cfg->idx) * MBOX_SZ;
+
+	if (pf_cfg->mbox_sz > span) {
+		CP_LIB_LOG(ERR, CNXK,
+			   "pem[%d] pf[%d] mbox size %u exceeds available %lu\n",
+			   dom_cfg->idx, pf_cfg->idx, pf_cfg->mbox_sz, span);
+		return -ENOSPC;
+	}
+	if (pf_cfg->mbox_sz && pf_cfg->mbox_sz < MBOX_MIN_SZ) {
+		CP_LIB_LOG(ERR, CNXK,
+			   "pem[%d] pf[%d] mbox size %u below minimum %lu\n",
+			   dom_cfg->idx, pf_cfg->idx, pf_cfg->mbox_sz,
+			   MBOX_MIN_SZ);
+		return -EINVAL;
+	}
+
+	pf->bar4_addr = PEMX_BAR4_INDEX_ADDR + (pf_cfg->idx * MBOX_SZ);
+	pf->mbox_sz = (pf_cfg->mbox_sz) ? pf_cfg->mbox_sz : span;
+	pf->mbox.h2fq_pct = pf_cfg->mbox_h2fq_pct;
+	pf_cfg->mbox_sz = pf->mbox_sz;
+
+	return 0;
+}
+
 static int init_mbox(struct octep_cp_lib_cfg *cfg, struct cnxk_pem *pem,
 		     struct cnxk_pf *pf)
 {
 	struct octep_ctrl_mbox *mbox;
-	char memdev_name[32];
 	int err;
 
 	mbox = &pf->mbox;
-	snprintf(memdev_name, 32, "/dev/pem%lld_ep_bar4_mem", pem->idx);
-	mbox->bar4_fd = open(memdev_name, O_RDWR | O_SYNC);
-	if(mbox->bar4_fd <= 0) {
-		CP_LIB_LOG(ERR, CNXK,
-			   "Error opening pem[%d] pf[%d] mbox file.\n",
-			   pem->idx, pf->idx);
-		return -ENOMEM;
+	mbox->bar4_fd = pem->bar4_fd;
+	if (pem->bar4_va) {
+		mbox->access = OCTEP_CTRL_MBOX_ACCESS_MMAP;
+		mbox->barmem_va = (uint8_t *)pem->bar4_va +
+				  (pf->bar4_addr - PEMX_BAR4_INDEX_ADDR);
+	} else {
+		mbox->access = OCTEP_CTRL_MBOX_ACCESS_FD_VEC;
+		mbox->barmem_va = NULL;
 	}
-
 	mbox->min_version = cfg->min_version;
 	mbox->max_version = cfg->max_version;
 	mbox->barmem = pf->bar4_addr;
-	mbox->barmem_sz = MBOX_SZ;
+	mbox->barmem_sz = pf->mbox_sz;
 	err = octep_ctrl_mbox_init(mbox);
 	if (err) {
-		CP_LIB_LOG(INFO, CNXK, "pem[%d] pf[%d] mbox init failed.\n",
+		CP_LIB_LOG(INFO, CNXK, "pem[%llu] pf[%llu] mbox init failed.\n",
 			   pem->idx, pf->idx);
-		close(mbox->bar4_fd);
+		mbox->barmem_va = NULL;
 	}
-	CP_LIB_LOG(INFO, CNXK, "pem[%d] pf[%d] control plane versions %x:%x\n",
+	CP_LIB_LOG(INFO, CNXK, "pem[%llu] pf[%llu] control plane versions %x:%x\n",
 		   pem->idx, pf->idx, cfg->min_version, cfg->max_version);
-	CP_LIB_LOG(INFO, CNXK, "pem[%d] pf[%d] mbox h2fq sz %u addr %p\n",
+	CP_LIB_LOG(INFO, CNXK, "pem[%llu] pf[%llu] mbox access %s sz %u\n",
+		   pem->idx, pf->idx,
+		   (mbox->access == OCTEP_CTRL_MBOX_ACCESS_MMAP) ? "mmap" : "fd",
+		   mbox->barmem_sz);
+	CP_LIB_LOG(INFO, CNXK, "pem[%llu] pf[%llu] mbox h2fq sz %u addr %lx\n",
 		   pem->idx, pf->idx, mbox->h2fq.sz, mbox->h2fq.hw_q);
-	CP_LIB_LOG(INFO, CNXK, "pem[%d] pf[%d] mbox f2hq sz %u addr %p\n",
+	CP_LIB_LOG(INFO, CNXK, "pem[%llu] pf[%llu] mbox f2hq sz %u addr %lx\n",
 		   pem->idx, pf->idx, mbox->f2hq.sz, mbox->f2hq.hw_q);
 
 	return err;
 }
 
-static int set_fw_ready(struct cnxk_pem *pem, struct cnxk_pf *pf,
-			unsigned long long status)
+static int set_fw_ready(int pem_idx, int pf_idx, int status)
 {
-	off_t offset = 0;
+	void* addr = pems[pem_idx].fw_ready_csr;
 	uint64_t val;
-	void* addr;
+
+	if (!addr) {
+		CP_LIB_LOG(INFO, CNXK,
+			   "Error setting pem[%d] pf[%d] fw ready(%d).\n",
+			   pem_idx, pf_idx, status);
+		return -EIO;
+	}
 
 	if (IS_SOC_CN10K) {
 		/* for cn10k we map into pf0 only
@@ -173,58 +594,98 @@ static int set_fw_ready(struct cnxk_pem *pem, struct cnxk_pf *pf,
 		 * of 8 addresses.  It has not been tested for multiple of 4 addresses,
 		 * nor for addresses with bit 16 set.
 		 */
-		addr = map_reg((PEMX_BASE(pem->idx) +
-				(0x8000 | CN10K_PCIEEP_VSECST_CTL)),
-			       8,
-			       PROT_READ | PROT_WRITE,
-			       &offset);
-		if (!addr) {
-			CP_LIB_LOG(INFO, CNXK,
-				   "Error setting pem[%d] pf[%d] fw ready(%d).\n",
-				   pem->idx, pf->idx, status);
-			return -EIO;
-		}
 		cp_write32(status, addr);
 		CP_LIB_LOG(INFO, CNXK,
-			   "pem[%d] pf[%d] fw ready %lx addr %p\n",
-			   pem->idx, pf->idx,
+			   "pem[%d] pf[%d] fw ready %x addr %p\n",
+			   pem_idx, pf_idx,
 			   status, addr);
 	} else {
-		addr = map_reg((PEMX_BASE(pem->idx) + PEMX_CFG_WR_OFFSET),
-			       8,
-			       PROT_READ | PROT_WRITE,
-			       &offset);
-		if (!addr) {
-			CP_LIB_LOG(INFO, CNXK,
-				   "Error setting pem[%d] pf[%d] fw ready(%d).\n",
-				   pem->idx, pf->idx, status);
-			return -EIO;
-		}
-		val = ((status << PEMX_CFG_WR_DATA) |
+		val = (((uint64_t)status << PEMX_CFG_WR_DATA) |
 		       (1 << 15) |
 		       (PCIEEP_VSECST_CTL << PEMX_CFG_WR_REG) |
-		       (pf->idx << PEMX_CFG_WR_PF));
+		       ((uint64_t)pf_idx << PEMX_CFG_WR_PF));
 		cp_write64(val, addr);
 		cp_read64(addr);
 		CP_LIB_LOG(INFO, CNXK,
 			   "pem[%d] pf[%d] fw ready %lx addr %p\n",
-			   pem->idx, pf->idx,
+			   pem_idx, pf_idx,
 			   val, addr);
 	}
-	unmap_reg(addr, offset, 8);
 
 	return 0;
 }
 
+/* Allocate transmit backlog ring of pf */
+static int init_tx_q(struct cnxk_pem *pem, struct octep_cp_pf_cfg *pf_cfg,
+		     struct cnxk_pf *pf)
+{
+	if (pf_cfg->tx_backlog_policy >= OCTEP_CP_TX_BACKLOG_POLICY_MAX) {
+		CP_LIB_LOG(ERR, CNXK,
+			   "pem[%llu] pf[%llu] invalid tx backlog policy %u\n",
+			   pem->idx, pf->idx, pf_cfg->tx_backlog_policy);
+		return -EINVAL;
+	}
+
+	pf->tx_q_sz = (pf_cfg->tx_backlog) ? pf_cfg->tx_backlog :
+					     OCTEP_CP_TX_BACKLOG_DEF;
+	pf->tx_q_policy = pf_cfg->tx_backlog_policy;
+	pf->tx_q_head = 0;
+	pf->tx_q_cnt = 0;
+	pf->tx_q = calloc(pf->tx_q_sz, sizeof(struct octep_cp_msg));
+	if (!pf->tx_q)
+		return -ENOMEM;
+
+	pf->oei_max_msgs = pf_cfg->oei_coalesce_msgs;
+	pf->oei_max_ns = pf_cfg->oei_coalesce_usecs * 1000ULL;
+	pf->oei_pending = 0;
+	pf->notify_max_ns = pf_cfg->notify_debounce_usecs * 1000ULL;
+	pf->notify_held = false;
+
+	return 0;
+}
+
+/* Drop n oldest responses in transmit backlog */
+static void drop_tx_q(struct cnxk_pf *pf, int n, bool count)
+{
+	struct octep_cp_msg *msg;
+
+	while (n-- > 0 && pf->tx_q_cnt) {
+		msg = &pf->tx_q[pf->tx_q_head];
+		free(msg->sg_list[0].msg);
+		msg->sg_list[0].msg = NULL;
+		pf->tx_q_head = (pf->tx_q_head + 1) % pf->tx_q_sz;
+		pf->tx_q_cnt--;
+		if (count && pf->stats)
+			CP_STATS_INC(pf->stats, tx_backlog_drops);
+	}
+	if (pf->stats)
+		CP_STATS_SET(pf->stats, tx_backlog, pf->tx_q_cnt);
+}
+
+static void uninit_tx_q(struct cnxk_pf *pf)
+{
+	if (!pf->tx_q)
+		return;
+
+	drop_tx_q(pf, pf->tx_q_cnt, true);
+	free(pf->tx_q);
+	pf->tx_q = NULL;
+	pf->tx_q_sz = 0;
+}
+
 static int init_pf(struct octep_cp_lib_cfg *cfg, struct cnxk_pem *pem,
 		   struct cnxk_pf *pf)
 {
 	int err;
 
-	pf->bar4_addr = PEMX_BAR4_INDEX_ADDR + (pf->idx * MBOX_SZ);
 	err = init_mbox(cfg, pem, pf);
 	if (err)
 		return err;
+
+	if (hw->open_oei_fd) {
+		pf->oei_fd = hw->open_oei_fd(pem->idx, pf->idx);
+		return (pf->oei_fd > 0) ? 0 : -EIO;
+	}
 	err = open_oei_trig_csr(pem, pf);
 	if (err)
 		return err;
@@ -234,20 +695,37 @@ static int init_pf(struct octep_cp_lib_cfg *cfg, struct cnxk_pem *pem,
 
 static int uninit_pf(struct cnxk_pem *pem, struct cnxk_pf *pf)
 {
+	/* bar4 is unmapped and closed with pem */
 	if (pf->mbox.barmem) {
 		octep_ctrl_mbox_uninit(&pf->mbox);
-		close(pf->mbox.bar4_fd);
+		pf->mbox.barmem_va = NULL;
 	}
 
 	if (pf->oei_trig_addr)
-		unmap_reg(pf->oei_trig_addr, pf->oei_trig_offset, 8);
+		put_csr(pf->oei_trig_addr);
+	if (pf->oei_fd > 0)
+		close(pf->oei_fd);
+	uninit_tx_q(pf);
+	drop_oei(pf);
+	drop_notify(pf);
 
 	return 0;
 }
 
-static int raise_oei_trig_int(struct cnxk_pf *pf, enum sdp_epf_oei_trig_bit bit)
+/* Raise oei interrupt without ordering it after earlier writes */
+static int raise_oei_trig_int_relaxed(struct cnxk_pf *pf,
+				      enum sdp_epf_oei_trig_bit bit)
 {
 	union sdp_epf_oei_trig trig = { 0 };
+	uint64_t val = 1;
+
+	if (pf->oei_fd > 0) {
+		/* fd which is full has an interrupt pending already */
+		if (write(pf->oei_fd, &val, sizeof(val)) != sizeof(val) &&
+		    errno != EAGAIN)
+			return -EIO;
+		goto count;
+	}
 
 	if (!pf->oei_trig_addr)
 		return -EIO;;
@@ -256,62 +734,135 @@ static int raise_oei_trig_int(struct cnxk_pf *pf, enum sdp_epf_oei_trig_bit bit)
 	trig.u64 = 0;
 	trig.s.set = 1;
 	trig.s.bit_num = bit;
-	cp_write64(trig.u64, pf->oei_trig_addr);
+	cp_write64_relaxed(trig.u64, pf->oei_trig_addr);
+count:
+	if (pf->stats)
+		CP_STATS_INC(pf->stats, oei_ints);
 
 	return 0;
 }
 
-static int check_pem_status(struct cnxk_pem *pem)
+static int raise_oei_trig_int(struct cnxk_pf *pf, enum sdp_epf_oei_trig_bit bit)
 {
-	int wait, ret = -EAGAIN;
-	off_t offset = 0;
-	uint64_t val;
-	void* addr;
+	cp_io_wmb();
+	return raise_oei_trig_int_relaxed(pf, bit);
+}
 
-	addr = map_reg((PEMX_BASE(pem->idx) + PEMX_ON_OFFSET),
-		       8,
-		       PROT_READ,
-		       &offset);
-	if (!addr) {
-		CP_LIB_LOG(ERR, CNXK, "Error mapping pem[%d] status\n",
-			   pem->idx);
+/* Raise deferred mailbox interrupt of pf, called with pf lock held */
+static void flush_oei(struct cnxk_pf *pf)
+{
+	if (!pf->oei_pending)
+		return;
+
+	pf->oei_pending = 0;
+	__atomic_sub_fetch(&oei_deferred_pfs, 1, __ATOMIC_RELAXED);
+	raise_oei_trig_int(pf, SDP_EPF_OEI_TRIG_BIT_MBOX);
+}
+
+/* Drop deferred mailbox interrupt of pf whose host is gone */
+static void drop_oei(struct cnxk_pf *pf)
+{
+	if (!pf->oei_pending)
+		return;
+
+	pf->oei_pending = 0;
+	__atomic_sub_fetch(&oei_deferred_pfs, 1, __ATOMIC_RELAXED);
+}
+
+/* Drop notification of pf held for debounce */
+static void drop_notify(struct cnxk_pf *pf)
+{
+	if (!pf->notify_held)
+		return;
+
+	free(pf->notify_msg.sg_list[0].msg);
+	pf->notify_held = false;
+	__atomic_sub_fetch(&notify_held_pfs, 1, __ATOMIC_RELAXED);
+}
+
+/* Interrupt host for n messages sent on pf, subject to interrupt
+ * moderation. Called with pf lock held.
+ */
+static void notify_host(struct cnxk_pf *pf, int n)
+{
+	uint64_t now;
+
+	if (n <= 0)
+		return;
+
+	if (!pf->oei_max_ns) {
+		raise_oei_trig_int(pf, SDP_EPF_OEI_TRIG_BIT_MBOX);
+		return;
+	}
+
+	now = get_time_ns();
+	if (!pf->oei_pending) {
+		pf->oei_pending_ns = now;
+		__atomic_add_fetch(&oei_deferred_pfs, 1, __ATOMIC_RELAXED);
+	}
+	pf->oei_pending += n;
+	if ((pf->oei_max_msgs && pf->oei_pending >= pf->oei_max_msgs) ||
+	    (now - pf->oei_pending_ns) >= pf->oei_max_ns) {
+		flush_oei(pf);
+		return;
+	}
+	if (pf->stats)
+		CP_STATS_ADD(pf->stats, oei_deferred, n);
+}
+
+/* Raise deferred interrupt of pf if its delay expired, called with pf lock
+ * held.
+ */
+static inline void poll_oei(struct cnxk_pf *pf, uint64_t now)
+{
+	if (pf->oei_pending && (now - pf->oei_pending_ns) >= pf->oei_max_ns)
+		flush_oei(pf);
+}
+
+static int check_pem_status(int pem_idx, int wait)
+{
+	struct cnxk_pem *pem = &pems[pem_idx];
+	uint64_t val, start, wait_ns;
+	int ret = -EAGAIN;
+	struct timespec ts;
+
+	if (!pem->on_csr || !pem->dis_port_csr) {
+		CP_LIB_LOG(ERR, CNXK, "pem[%d] csr's not mapped\n", pem_idx);
 		return -EIO;
 	}
-	wait = 0;
-	do {
-		val = cp_read64(addr);
+	start = get_time_ns();
+	wait_ns = PEM_STATUS_POLL_MIN_NS;
+	while (1) {
+		val = cp_read64(pem->on_csr);
 		if (val & PEMX_ON_PEMOOR) {
 			ret = 0;
 			break;
 		}
+		if (!wait || (get_time_ns() - start) >=
+			     (PEM_STATUS_WAIT_TIMEOUT * 1000000000ULL))
+			break;
 
-		sleep(1);
-		wait++;
-	} while (wait < PEM_STATUS_WAIT_TIMEOUT);
-
-	unmap_reg(addr, offset, 8);
+		ts.tv_sec = 0;
+		ts.tv_nsec = wait_ns;
+		nanosleep(&ts, NULL);
+		wait_ns = cp_min(wait_ns * 2, PEM_STATUS_POLL_MAX_NS);
+	}
 
 	if (ret < 0) {
-		CP_LIB_LOG(ERR, CNXK, "pem[%d] unavailable\n", pem->idx);
+		/* caller polls link without waiting */
+		if (wait)
+			CP_LIB_LOG(ERR, CNXK, "pem[%d] unavailable\n", pem_idx);
 		return ret;
 	}
 
-	addr = map_reg((PEMX_BASE(pem->idx) + PEMX_DIS_PORT_OFFSET),
-		       8, PROT_READ | PROT_WRITE, &offset);
-	if (!addr) {
-		CP_LIB_LOG(ERR, CNXK, "Error mapping pem[%d] disable port register\n",
-			   pem->idx);
-		return -EIO;
-	}
-	val = cp_read64(addr);
-	cp_write64(val, addr);
-	val = cp_read64(addr);
+	val = cp_read64(pem->dis_port_csr);
+	cp_write64(val, pem->dis_port_csr);
+	val = cp_read64(pem->dis_port_csr);
 	if (val) {
 		CP_LIB_LOG(ERR, CNXK, "pem[%d] disable port not cleared\n",
-			   pem->idx);
+			   pem_idx);
 		return -EIO;
 	}
-	unmap_reg(addr, offset, 8);
 
 	return ret;
 }
@@ -320,63 +871,59 @@ static int uninit_pem(struct cnxk_pem *pem)
 {
 	int j;
 
-	if (pem->uio_fd)
+	if (pem->uio_fd > 0)
 		close(pem->uio_fd);
 
 	for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX; j++) {
-		if (pem->pfs[j].valid)
-			uninit_pf(pem, &(pem->pfs[j]));
+		if (!pem->pfs[j].valid)
+			continue;
+
+		if (pem->pfs[j].mbox.host_ready) {
+			pthread_mutex_lock(&active_lock);
+			remove_active_pf(&pem->pfs[j]);
+			pthread_mutex_unlock(&active_lock);
+			pem->pfs[j].mbox.host_ready = false;
+		}
+		uninit_pf(pem, &(pem->pfs[j]));
 	}
+	close_bar4(pem);
+	if (hw->unmap_csrs)
+		hw->unmap_csrs(pem->idx);
 	pem->valid = false;
 
 	return 0;
 }
 
-static int find_pem_uiodev(char *name)
+/* Open uio device which signals perst of a pem */
+static int open_pem_uiodev(int pem_idx)
 {
-	struct dirent *files;
-	char uiod_name[512];
-	FILE *fd;
-	char namea[16];
-	int i, uio_num, ret;
-	DIR *dir = opendir("/sys/class/uio");
+	char uio_path[256];
+	char uio_file[16];
+	int uio_num, fd;
 
-	if (dir == NULL) {
-		printf("/sys/class/uio directory cannot be opened!");
-		return -1;
+	snprintf(uio_file, sizeof(uio_file), "PEM%d", pem_idx);
+	uio_num = discover_uio(uio_file);
+	if (uio_num < 0) {
+		CP_LIB_LOG(ERR, CNXK, "Get uio dev failed for pem%d\n", pem_idx);
+		return -EINVAL;
 	}
 
-	while ((files = readdir(dir))) {
-		if ((!strncmp(files->d_name, ".", 1) || !strncmp(files->d_name, "..", 2)))
-			continue;
-
-		snprintf(uiod_name, sizeof(uiod_name), "%s/%s/%s",
-				"/sys/class/uio", files->d_name, "name");
-		fd = fopen(uiod_name, "r");
-		if (fd == NULL)
-			continue;
-
-		/* Only strlen(name) char need to be compared/read */
-		for (i = 0; (i < strnlen(name, 6)) && !feof(fd); i++)
-			namea[i] = fgetc(fd);
-
-		fclose(fd);
-		namea[i] = 0;
-
-		if (!strncmp(name, namea, strnlen(name, 6))) {
+	CP_LIB_LOG(INFO, CNXK, "uiodev num %d  for pem%d\n", uio_num, pem_idx);
+	snprintf(uio_path, sizeof(uio_path), "/dev/uio%d", uio_num);
+	fd = open(uio_path, O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+		return -errno;
 
-			/* Get uio dev num and return*/
-			ret = sscanf(files->d_name, "uio%d", &uio_num);
-			closedir(dir);
-			if (ret == 0 || ret == EOF)
-				return -1;
+	return fd;
+}
 
-			return uio_num;
-		}
-	}
+/* Open bar4 memory of a pem */
+static int open_pem_bar4(int pem_idx)
+{
+	char memdev_name[32];
 
-	closedir(dir);
-	return -1;
+	snprintf(memdev_name, 32, "/dev/pem%d_ep_bar4_mem", pem_idx);
+	return open(memdev_name, O_RDWR | O_SYNC);
 }
 
 static int init_pem(struct octep_cp_lib_cfg *cfg, struct cnxk_pem *pem,
@@ -384,29 +931,29 @@ static int init_pem(struct octep_cp_lib_cfg *cfg, struct cnxk_pem *pem,
 {
 	struct octep_cp_pf_cfg *pf_cfg;
 	struct cnxk_pf *pf;
-	char uio_path[256];
 	int err, j, fd;
-	char uio_file[16];
-	int uio_num;
 	pem->idx = dom_cfg->idx;
-	err = check_pem_status(pem);
+	if (hw->map_csrs) {
+		err = hw->map_csrs(pem->idx);
+		if (err < 0)
+			return err;
+	}
+	err = hw->check_pem(pem->idx, !cfg->pem_nowait);
 	if (err < 0)
-		return err;
+		goto csr_fail;
 
-	snprintf(uio_file, sizeof(uio_file), "PEM%lld", pem->idx);
-	uio_num = find_pem_uiodev(uio_file);
-	if (uio_num < 0) {
-		CP_LIB_LOG(ERR, CNXK, "Get uio dev failed for pem%d\n", pem->idx);
-		return -EINVAL;
+	fd = hw->open_perst_fd(pem->idx);
+	if (fd < 0) {
+		err = fd;
+		goto csr_fail;
 	}
 
-	CP_LIB_LOG(INFO, CNXK, "uiodev num %d  for pem%d\n", uio_num, pem->idx);
-	snprintf(uio_path, sizeof(uio_path), "/dev/uio%d", uio_num);
-	fd = open(uio_path, O_RDONLY | O_NONBLOCK);
-	if (fd < 0)
-		return -errno;
-
 	pem->uio_fd = fd;
+	pem->stats = cp_stats_get(pem->idx, -1, -1);
+	err = open_bar4(pem);
+	if (err)
+		goto init_fail;
+
 	for (j = 0; j < dom_cfg->npfs; j++) {
 		pf_cfg = &dom_cfg->pfs[j];
 		if (pf_cfg->idx >= OCTEP_CP_PF_PER_DOM_MAX) {
@@ -417,15 +964,33 @@ static int init_pem(struct octep_cp_lib_cfg *cfg, struct cnxk_pem *pem,
 			goto init_fail;
 		}
 
-		pf = &pem->pfs[j];
+		pf = &pem->pfs[pf_cfg->idx];
 		pf->idx = pf_cfg->idx;
+		pf->stats = cp_stats_get(pem->idx, pf->idx, -1);
+		err = alloc_mbox(dom_cfg, pf_cfg, pf);
+		if (err)
+			goto init_fail;
+
+		err = init_tx_q(pem, pf_cfg, pf);
+		if (err)
+			goto init_fail;
+
 		err = init_pf(cfg, pem, pf);
 		if (err) {
+			uninit_tx_q(pf);
 			err = -ENOLINK;
 			goto init_fail;
 		}
 		pf->valid = true;
-		pf_cfg->max_msg_sz = pf->mbox.h2fq.sz;
+		pf->active_idx = -1;
+		pf_cfg->max_msg_sz = cp_min(pf->mbox.h2fq.sz, UINT16_MAX);
+		update_host(pem, pf, get_time_ns());
+		/* let host in as soon as this pf's mailbox is ready */
+		if (cfg->fw_ready_on_init &&
+		    hw->set_fw_ready(pem->idx, pf->idx, 1))
+			CP_LIB_LOG(ERR, CNXK,
+				   "Error setting pem[%llu] pf[%llu] fw ready\n",
+				   pem->idx, pf->idx);
 	}
 	pem->valid = true;
 
@@ -434,38 +999,142 @@ static int init_pem(struct octep_cp_lib_cfg *cfg, struct cnxk_pem *pem,
 init_fail:
 	uninit_pem(pem);
 	return -ENOLINK;
+
+csr_fail:
+	if (hw->unmap_csrs)
+		hw->unmap_csrs(pem->idx);
+	return err;
 }
 
-int cnxk_init(struct octep_cp_lib_cfg *cfg)
-{
+/* Initialization of a pem in its own thread */
+struct pem_init {
+	struct octep_cp_lib_cfg *cfg;
 	struct octep_cp_dom_cfg *dom_cfg;
-	int err = 0, i;
+	pthread_t thread;
+	bool threaded;
+	int err;
+};
 
-	CP_LIB_LOG(INFO, CNXK, "init\n");
+static void *init_pem_thread(void *arg)
+{
+	struct pem_init *pi = (struct pem_init *)arg;
+	int idx = pi->dom_cfg->idx;
+
+	lock_pem(idx);
+	pi->err = init_pem(pi->cfg, &pems[idx], pi->dom_cfg);
+	unlock_pem(idx);
+
+	return NULL;
+}
+
+/* Mark pem as late, its csr's stay mapped for rechecks of its link until
+ * it joins. Caller holds pem lock.
+ */
+static int set_late_pem(int pem_idx)
+{
+	struct cnxk_pem *pem = &pems[pem_idx];
+	int err;
+
+	if (pem->late)
+		return 0;
+
+	if (hw->map_csrs) {
+		err = hw->map_csrs(pem_idx);
+		if (err < 0)
+			return err;
+	}
+	pem->idx = pem_idx;
+	pem->late = true;
+
+	return 0;
+}
+
+/* Unmark late pem and unmap its csr's. Caller holds pem lock. */
+static void clear_late_pem(int pem_idx)
+{
+	struct cnxk_pem *pem = &pems[pem_idx];
+
+	if (!pem->late)
+		return;
+
+	if (hw->unmap_csrs)
+		hw->unmap_csrs(pem_idx);
+	pem->late = false;
+}
+
+int cnxk_init(struct octep_cp_lib_cfg *cfg)
+{
+	struct pem_init pi[OCTEP_CP_DOM_MAX] = { 0 };
+	struct octep_cp_dom_cfg *dom_cfg;
+	int err = 0, i;
+
+	CP_LIB_LOG(INFO, CNXK, "init\n");
 
+	init_locks();
 	/* Initialize pf interfaces */
 	memset(pems, 0, sizeof(pems[0]) * OCTEP_CP_DOM_MAX);
+	num_active_pfs = 0;
+	host_scan_ns = 0;
+	host_events_pending = false;
+	for (i = 0; i < OCTEP_CP_DOM_MAX; i++)
+		dom_pems[i] = -1;
 	for (i = 0; i < cfg->ndoms; i++) {
 		dom_cfg = &cfg->doms[i];
 		if (dom_cfg->idx >= OCTEP_CP_DOM_MAX) {
 			CP_LIB_LOG(ERR, CNXK,
 				   "Invalid pem[%d] config index.\n",
 				   dom_cfg->idx);
-			err = -EINVAL;
-			goto init_fail;
+			return -EINVAL;
 		}
+		dom_pems[i] = dom_cfg->idx;
+	}
 
-		err = init_pem(cfg, &pems[dom_cfg->idx], dom_cfg);
-		if (err)
+	/* pem's are initialized in parallel, so that init takes as long as
+	 * the slowest pem link instead of the sum of all of them
+	 */
+	for (i = 0; i < cfg->ndoms; i++) {
+		pi[i].cfg = cfg;
+		pi[i].dom_cfg = &cfg->doms[i];
+		if (cfg->ndoms > 1)
+			pi[i].threaded = !pthread_create(&pi[i].thread, NULL,
+							 init_pem_thread,
+							 &pi[i]);
+		if (!pi[i].threaded)
+			init_pem_thread(&pi[i]);
+	}
+	for (i = 0; i < cfg->ndoms; i++) {
+		if (pi[i].threaded)
+			pthread_join(pi[i].thread, NULL);
+	}
+
+	for (i = 0; i < cfg->ndoms; i++) {
+		dom_cfg = &cfg->doms[i];
+		if (pi[i].err == -EAGAIN && cfg->pem_late_join) {
+			CP_LIB_LOG(INFO, CNXK,
+				   "pem[%d] link down, reported when up\n",
+				   dom_cfg->idx);
+			lock_pem(dom_cfg->idx);
+			pi[i].err = set_late_pem(dom_cfg->idx);
+			unlock_pem(dom_cfg->idx);
+			if (!pi[i].err)
+				continue;
+		}
+		if (pi[i].err) {
+			err = pi[i].err;
 			goto init_fail;
+		}
 	}
 
 	return 0;
 
 init_fail:
-	for (i = 0; i < OCTEP_CP_DOM_MAX; i++)
+	for (i = 0; i < OCTEP_CP_DOM_MAX; i++) {
+		lock_pem(i);
 		if (pems[i].valid)
 			uninit_pem(&pems[i]);
+		clear_late_pem(i);
+		unlock_pem(i);
+	}
 
 	return err;
 }
@@ -473,27 +1142,46 @@ init_fail:
 int cnxk_init_pem(struct octep_cp_lib_cfg *cfg, int dom_idx)
 {
 	struct octep_cp_dom_cfg *dom_cfg;
+	int err, ret, pem_idx;
 
 	CP_LIB_LOG(INFO, CNXK, "init PEM %d\n", dom_idx);
 
-	if (dom_idx >= OCTEP_CP_DOM_MAX) {
+	if (dom_idx < 0 || dom_idx >= OCTEP_CP_DOM_MAX) {
 		CP_LIB_LOG(ERR, CNXK,
 				"Invalid pem[%d] config index.\n",
 				dom_idx);
 		return -EINVAL;
 	}
 	dom_cfg = &cfg->doms[dom_idx];
+	pem_idx = dom_cfg->idx;
+	if (pem_idx < 0 || pem_idx >= OCTEP_CP_DOM_MAX) {
+		CP_LIB_LOG(ERR, CNXK,
+				"Invalid pem[%d] config index.\n",
+				pem_idx);
+		return -EINVAL;
+	}
 
+	lock_pem(pem_idx);
 	/* If pem was valid before then it should be uninitialized
 	 * before clearing pem data.
 	 */
-	if (pems[dom_idx].valid)
-		uninit_pem(&pems[dom_idx]);
+	if (pems[pem_idx].valid)
+		uninit_pem(&pems[pem_idx]);
+	clear_late_pem(pem_idx);
 
-	memset(&pems[dom_idx], 0, sizeof(pems[dom_idx]));
+	memset(&pems[pem_idx], 0, sizeof(pems[pem_idx]));
+	dom_pems[dom_idx] = pem_idx;
 
 	/* Initialize pf interfaces */
-	return init_pem(cfg, &pems[dom_cfg->idx], dom_cfg);
+	err = init_pem(cfg, &pems[pem_idx], dom_cfg);
+	if (err == -EAGAIN && cfg->pem_late_join) {
+		ret = set_late_pem(pem_idx);
+		if (ret)
+			err = ret;
+	}
+	unlock_pem(pem_idx);
+
+	return err;
 }
 
 int cnxk_get_info(struct octep_cp_lib_info *info)
@@ -506,9 +1194,12 @@ int cnxk_get_info(struct octep_cp_lib_info *info)
 
 	info->ndoms = 0;
 	for (i = 0, info_i = 0; i < OCTEP_CP_DOM_MAX; i++) {
+		pthread_mutex_lock(&pem_locks[i].m);
 		pem = &pems[i];
-		if (!pem->valid)
+		if (!pem->valid) {
+			pthread_mutex_unlock(&pem_locks[i].m);
 			continue;
+		}
 
 		dom_info = &info->doms[info_i++];
 		dom_info->idx = i;
@@ -520,36 +1211,240 @@ int cnxk_get_info(struct octep_cp_lib_info *info)
 
 			pf_info = &dom_info->pfs[info_j++];
 			pf_info->idx = j;
-			pf_info->max_msg_sz = pf->mbox.h2fq.sz;
+			pf_info->max_msg_sz = cp_min(pf->mbox.h2fq.sz, UINT16_MAX);
+			/* host version is updated while receiving messages */
+			pthread_mutex_lock(&pf_locks[i][j].m);
 			pf_info->host_version = (uint32_t)pf->mbox.host_version;
+			pthread_mutex_unlock(&pf_locks[i][j].m);
 			dom_info->npfs++;
 		}
 		info->ndoms++;
+		pthread_mutex_unlock(&pem_locks[i].m);
 	}
 
 	return 0;
 }
 
+/* Get valid pf with its lock held, release it with put_pf */
 static inline struct cnxk_pf* get_pf(int pem_idx, int pf_idx)
 {
 	if (pem_idx >= OCTEP_CP_DOM_MAX || pf_idx >= OCTEP_CP_PF_PER_DOM_MAX)
 		return NULL;
 
-	if (!pems[pem_idx].valid)
-		return NULL;
-
-	if (!pems[pem_idx].pfs[pf_idx].valid)
+	pthread_mutex_lock(&pf_locks[pem_idx][pf_idx].m);
+	if (!pems[pem_idx].valid || !pems[pem_idx].pfs[pf_idx].valid) {
+		pthread_mutex_unlock(&pf_locks[pem_idx][pf_idx].m);
 		return NULL;
+	}
 
 	return &pems[pem_idx].pfs[pf_idx];
 }
 
+static inline void put_pf(int pem_idx, int pf_idx)
+{
+	pthread_mutex_unlock(&pf_locks[pem_idx][pf_idx].m);
+}
+
+/* Recheck absent host of pf polled directly, called with pf lock held */
+static inline void check_host(int pem_idx, struct cnxk_pf *pf)
+{
+	uint64_t now;
+
+	if (pf->mbox.host_ready)
+		return;
+
+	now = get_time_ns();
+	if ((now - pf->host_check_ns) >= HOST_CHECK_INTERVAL_NS)
+		update_host(&pems[pem_idx], pf, now);
+}
+
+/* Account host-to-fw queue depth seen by last receive on pf */
+static inline void stats_depth(struct cnxk_pf *pf)
+{
+	uint32_t depth = pf->mbox.h2fq_depth;
+
+	if (!pf->stats)
+		return;
+
+	CP_STATS_SET(pf->stats, h2fq_depth, depth);
+	if (depth > pf->stats->h2fq_depth_max)
+		CP_STATS_SET(pf->stats, h2fq_depth_max, depth);
+}
+
+/* Account messages received or sent on pf, called with pf lock held */
+static inline void stats_msgs(struct cnxk_pf *pf, struct octep_cp_msg *msgs,
+			      int num, bool rx)
+{
+	struct octep_cp_stats *s;
+	uint64_t sz;
+	int m;
+
+	if (!pf->stats)
+		return;
+
+	for (m = 0; m < num; m++) {
+		s = cp_stats_fn(pf->stats, msgs[m].info.s.is_vf,
+				msgs[m].info.s.vf_idx);
+		sz = sizeof(union octep_ctrl_mbox_msg_hdr) + msgs[m].info.s.sz;
+		if (rx) {
+			CP_STATS_INC(s, rx_msgs);
+			CP_STATS_ADD(s, rx_bytes, sz);
+		} else {
+			CP_STATS_INC(s, tx_msgs);
+			CP_STATS_ADD(s, tx_bytes, sz);
+		}
+	}
+}
+
+/* Account send that found fw-to-host queue full */
+static inline void stats_send_err(struct cnxk_pf *pf, int err)
+{
+	if (err == -EAGAIN && pf->stats)
+		CP_STATS_INC(pf->stats, ring_full);
+}
+
+/* Copy message into a single buffer allocated for dst */
+static int copy_msg(struct octep_cp_msg *dst, struct octep_cp_msg *msg)
+{
+	uint32_t sz, off, cp_sz;
+	uint8_t *buf;
+	int s;
+
+	sz = msg->info.s.sz;
+	buf = malloc((sz) ? sz : 1);
+	if (!buf)
+		return -ENOMEM;
+
+	for (s = 0, off = 0; s < msg->sg_num && off < sz; s++) {
+		cp_sz = cp_min(msg->sg_list[s].sz, sz - off);
+		memcpy(buf + off, msg->sg_list[s].msg, cp_sz);
+		off += cp_sz;
+	}
+	dst->info = msg->info;
+	dst->sg_num = 1;
+	dst->sg_list[0].sz = sz;
+	dst->sg_list[0].msg = buf;
+
+	return 0;
+}
+
+/* Copy response which did not fit in fw-to-host queue to transmit backlog,
+ * called with pf lock held.
+ */
+static int queue_tx(struct cnxk_pf *pf, struct octep_cp_msg *msg)
+{
+	int err;
+
+	/* message can never be sent */
+	if ((msg->info.s.sz + sizeof(union octep_ctrl_mbox_msg_hdr)) >=
+	    pf->mbox.f2hq.sz)
+		return -EMSGSIZE;
+
+	if (pf->tx_q_cnt == pf->tx_q_sz) {
+		if (pf->tx_q_policy != OCTEP_CP_TX_BACKLOG_DROP_OLD) {
+			if (pf->stats)
+				CP_STATS_INC(pf->stats, tx_backlog_drops);
+			return -EAGAIN;
+		}
+		drop_tx_q(pf, 1, true);
+	}
+
+	err = copy_msg(&pf->tx_q[(pf->tx_q_head + pf->tx_q_cnt) %
+				 pf->tx_q_sz], msg);
+	if (err)
+		return err;
+
+	pf->tx_q_cnt++;
+	if (pf->stats) {
+		CP_STATS_INC(pf->stats, tx_backlog_queued);
+		CP_STATS_SET(pf->stats, tx_backlog, pf->tx_q_cnt);
+		if (pf->tx_q_cnt > pf->stats->tx_backlog_max)
+			CP_STATS_SET(pf->stats, tx_backlog_max, pf->tx_q_cnt);
+	}
+
+	return 0;
+}
+
+/* Send responses in transmit backlog in order, as many as fit in
+ * fw-to-host queue. Called with pf lock held, caller raises interrupt.
+ *
+ * return value: number of responses sent.
+ */
+static int drain_tx_q(struct cnxk_pf *pf)
+{
+	int seg, ret, n = 0;
+
+	while (pf->tx_q_cnt) {
+		/* contiguous part of ring */
+		seg = cp_min(pf->tx_q_cnt, pf->tx_q_sz - pf->tx_q_head);
+		ret = octep_ctrl_mbox_send(&pf->mbox,
+					   (struct octep_ctrl_mbox_msg *)
+					   &pf->tx_q[pf->tx_q_head],
+					   seg);
+		if (ret == -EIO) {
+			/* host is gone, responses are stale */
+			drop_tx_q(pf, pf->tx_q_cnt, true);
+			break;
+		}
+		if (ret <= 0)
+			break;
+
+		stats_msgs(pf, &pf->tx_q[pf->tx_q_head], ret, false);
+		drop_tx_q(pf, ret, false);
+		n += ret;
+		if (ret < seg)
+			break;
+	}
+
+	return n;
+}
+
+/* Send messages with headers set up after backlog of pf, queue those
+ * which do not fit. Called with pf lock held.
+ *
+ * return value: number of messages sent or queued on success, -errno on
+ *               failure.
+ */
+static int send_msgs(struct cnxk_pf *pf, struct octep_cp_msg *msgs, int num)
+{
+	int i, ret, err = 0, sent = 0, drained = 0;
+
+	/* earlier messages go first */
+	if (pf->tx_q_cnt)
+		drained = drain_tx_q(pf);
+	if (!pf->tx_q_cnt) {
+		/* whole batch is written with one read of queue indices and
+		 * one producer index update, a short count means queue is
+		 * full
+		 */
+		ret = octep_ctrl_mbox_send(&pf->mbox,
+					   (struct octep_ctrl_mbox_msg *)msgs,
+					   num);
+		if (ret < 0 && ret != -EAGAIN) {
+			notify_host(pf, drained);
+			return ret;
+		}
+		sent = (ret > 0) ? ret : 0;
+		stats_msgs(pf, msgs, sent, false);
+	}
+	if (sent < num)
+		stats_send_err(pf, -EAGAIN);
+	/* queue rest, in order, until backlog refuses a message */
+	for (i = sent; i < num; i++) {
+		err = queue_tx(pf, &msgs[i]);
+		if (err)
+			break;
+	}
+	notify_host(pf, sent + drained);
+
+	return (i) ? i : err;
+}
+
 int cnxk_send_msg_resp(union octep_cp_msg_info *ctx,
 		       struct octep_cp_msg *msgs,
 		       int num)
 {
 	union octep_ctrl_mbox_msg_hdr *hdr;
-	struct octep_cp_msg *msg;
 	struct cnxk_pf *pf;
 	int i, ret;
 
@@ -558,30 +1453,153 @@ int cnxk_send_msg_resp(union octep_cp_msg_info *ctx,
 		return -EINVAL;
 
 	for (i = 0; i < num; i++) {
-		msg = &msgs[i];
-		hdr = (union octep_ctrl_mbox_msg_hdr *)&msg->info;
+		hdr = (union octep_ctrl_mbox_msg_hdr *)&msgs[i].info;
 		hdr->s.flags = OCTEP_CTRL_MBOX_MSG_HDR_FLAG_RESP;
 		/* host always sets pf_idx == 0 and has no notion of
 		 * pem_idx, so make sure they are always 0
 		 */
 		hdr->s.pem_idx = 0;
 		hdr->s.pf_idx = 0;
-		ret = octep_ctrl_mbox_send(&pf->mbox,
-					   (struct octep_ctrl_mbox_msg *)msg,
-					   1);
-		if (ret < 0) {
-			/* error while sending first msg */
-			if (i == 0)
-				return ret;
-
-			/* we have sent some msgs successfully so break */
-			break;
-		}
 	}
-	if (i)
-		raise_oei_trig_int(pf, SDP_EPF_OEI_TRIG_BIT_MBOX);
+	ret = send_msgs(pf, msgs, num);
+	put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+
+	return ret;
+}
+
+/* Send a copy of notification to each function in fns, called with pf
+ * lock held.
+ */
+static int send_fanout(struct cnxk_pf *pf, struct octep_cp_msg *msg,
+		       const struct octep_cp_fn_set *fns)
+{
+	struct octep_cp_msg copies[1 + OCTEP_CP_VF_PER_PF_MAX];
+	union octep_ctrl_mbox_msg_hdr *hdr;
+	int v, n = 0;
+
+	hdr = (union octep_ctrl_mbox_msg_hdr *)&msg->info;
+	hdr->s.flags = OCTEP_CTRL_MBOX_MSG_HDR_FLAG_NOTIFY;
+	/* see cnxk_send_msg_resp */
+	hdr->s.pem_idx = 0;
+	hdr->s.pf_idx = 0;
+	if (fns->pf) {
+		copies[n] = *msg;
+		copies[n].info.s.is_vf = 0;
+		copies[n].info.s.vf_idx = 0;
+		n++;
+	}
+	for (v = 0; v < OCTEP_CP_VF_PER_PF_MAX; v++) {
+		if (!(fns->vf_mask[v / 64] & BIT_ULL(v % 64)))
+			continue;
+
+		copies[n] = *msg;
+		copies[n].info.s.is_vf = 1;
+		copies[n].info.s.vf_idx = v;
+		n++;
+	}
+
+	return (n) ? send_msgs(pf, copies, n) : 0;
+}
+
+/* Send notification held for debounce, called with pf lock held */
+static void flush_notify(struct cnxk_pf *pf)
+{
+	if (!pf->notify_held)
+		return;
 
-	return i;
+	send_fanout(pf, &pf->notify_msg, &pf->notify_fns);
+	drop_notify(pf);
+}
+
+/* Send held notification of pf if its debounce window expired, called
+ * with pf lock held.
+ */
+static inline void poll_notify(struct cnxk_pf *pf, uint64_t now)
+{
+	if (pf->notify_held && (now - pf->notify_ns) >= pf->notify_max_ns)
+		flush_notify(pf);
+}
+
+/* Send backlog, held notification and raise expired deferred interrupt of
+ * pf polled for messages, called with pf lock held.
+ */
+static inline void poll_deferred(struct cnxk_pf *pf)
+{
+	uint64_t now;
+
+	if (pf->tx_q_cnt)
+		notify_host(pf, drain_tx_q(pf));
+	if (!pf->oei_pending && !pf->notify_held)
+		return;
+
+	now = get_time_ns();
+	poll_notify(pf, now);
+	if (pf->oei_pending)
+		poll_oei(pf, now);
+}
+
+/* Hold notification for debounce, replacing a held notification to the
+ * same functions. Called with pf lock held.
+ *
+ * return value: number of functions to notify on success, -errno on
+ *               failure.
+ */
+static int hold_notify(struct cnxk_pf *pf, struct octep_cp_msg *msg,
+		       const struct octep_cp_fn_set *fns)
+{
+	struct octep_cp_msg copy;
+	int err;
+
+	/* fail now what would fail at end of debounce */
+	if ((msg->info.s.sz + sizeof(union octep_ctrl_mbox_msg_hdr)) >=
+	    pf->mbox.f2hq.sz)
+		return -EMSGSIZE;
+
+	if (pf->notify_held &&
+	    memcmp(&pf->notify_fns, fns, sizeof(struct octep_cp_fn_set)))
+		flush_notify(pf);
+
+	err = copy_msg(&copy, msg);
+	if (err)
+		return err;
+
+	if (pf->notify_held) {
+		free(pf->notify_msg.sg_list[0].msg);
+		if (pf->stats)
+			CP_STATS_INC(pf->stats, notify_debounced);
+	} else {
+		pf->notify_held = true;
+		pf->notify_ns = get_time_ns();
+		pf->notify_fns = *fns;
+		__atomic_add_fetch(&notify_held_pfs, 1, __ATOMIC_RELAXED);
+	}
+	pf->notify_msg = copy;
+
+	return ((fns->pf) ? 1 : 0) + __builtin_popcountll(fns->vf_mask[0]) +
+	       __builtin_popcountll(fns->vf_mask[1]);
+}
+
+int cnxk_send_notification_fanout(union octep_cp_msg_info *ctx,
+				  struct octep_cp_msg *msg,
+				  const struct octep_cp_fn_set *fns)
+{
+	struct cnxk_pf *pf;
+	int ret;
+
+	pf = get_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+	if (!pf)
+		return -EINVAL;
+
+	if (!pf->mbox.host_ready) {
+		put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+		return -EIO;
+	}
+
+	ret = (pf->notify_max_ns) ? hold_notify(pf, msg, fns) :
+				    send_fanout(pf, msg, fns);
+	put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+
+	return ret;
 }
 
 int cnxk_send_notification(union octep_cp_msg_info *ctx,
@@ -602,15 +1620,11 @@ int cnxk_send_notification(union octep_cp_msg_info *ctx,
 	 */
 	hdr->s.pem_idx = 0;
 	hdr->s.pf_idx = 0;
-	ret = octep_ctrl_mbox_send(&pf->mbox,
-				   (struct octep_ctrl_mbox_msg *)msg,
-				   1);
-	if (ret < 0)
-		return ret;
+	/* goes after responses in backlog and is queued like them */
+	ret = send_msgs(pf, msg, 1);
+	put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
 
-	raise_oei_trig_int(pf, SDP_EPF_OEI_TRIG_BIT_MBOX);
-
-	return 0;
+	return (ret < 0) ? ret : 0;
 }
 
 int cnxk_recv_msg(union octep_cp_msg_info *ctx,
@@ -624,6 +1638,8 @@ int cnxk_recv_msg(union octep_cp_msg_info *ctx,
 	if (!pf)
 		return -EINVAL;
 
+	check_host(ctx->s.pem_idx, pf);
+	poll_deferred(pf);
 	ret = octep_ctrl_mbox_recv(&pf->mbox,
 				   (struct octep_ctrl_mbox_msg *)msgs,
 				   num);
@@ -635,75 +1651,440 @@ int cnxk_recv_msg(union octep_cp_msg_info *ctx,
 		msgs[m].info.s.pem_idx = ctx->s.pem_idx;
 		msgs[m].info.s.pf_idx = ctx->s.pf_idx;
 	}
+	if (ret != -EIO)
+		stats_depth(pf);
+	if (ret > 0)
+		stats_msgs(pf, msgs, ret, true);
+	put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
 
 	return ret;
 }
 
+int cnxk_recv_msg_peek(union octep_cp_msg_info *ctx,
+		       struct octep_cp_msg *msgs,
+		       int num)
+{
+	struct cnxk_pf *pf;
+	int ret, m;
+
+	pf = get_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+	if (!pf)
+		return -EINVAL;
+
+	check_host(ctx->s.pem_idx, pf);
+	poll_deferred(pf);
+	ret = octep_ctrl_mbox_recv_peek(&pf->mbox,
+					(struct octep_ctrl_mbox_msg *)msgs,
+					num);
+	for (m = 0; m < ret; m++) {
+		/* see cnxk_recv_msg */
+		msgs[m].info.s.pem_idx = ctx->s.pem_idx;
+		msgs[m].info.s.pf_idx = ctx->s.pf_idx;
+	}
+	if (ret != -EIO && ret != -ENOTSUP)
+		stats_depth(pf);
+	put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+
+	return ret;
+}
+
+int cnxk_recv_msg_commit(union octep_cp_msg_info *ctx,
+			 struct octep_cp_msg *msgs,
+			 int num)
+{
+	struct cnxk_pf *pf;
+	int ret;
+
+	pf = get_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+	if (!pf)
+		return -EINVAL;
+
+	ret = octep_ctrl_mbox_recv_commit(&pf->mbox,
+					  (struct octep_ctrl_mbox_msg *)msgs,
+					  num);
+	if (ret > 0)
+		stats_msgs(pf, msgs, ret, true);
+	put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+
+	return ret;
+}
+
+int cnxk_send_msg_resp_reserve(union octep_cp_msg_info *ctx,
+			       struct octep_cp_msg *msg)
+{
+	struct cnxk_pf *pf;
+	int ret;
+
+	pf = get_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+	if (!pf)
+		return -EINVAL;
+
+	/* response built in place would overtake backlog */
+	poll_deferred(pf);
+	if (pf->tx_q_cnt) {
+		put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+		return -EAGAIN;
+	}
+
+	ret = octep_ctrl_mbox_send_reserve(&pf->mbox,
+					   (struct octep_ctrl_mbox_msg *)msg);
+	stats_send_err(pf, ret);
+	put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+
+	return ret;
+}
+
+int cnxk_send_msg_resp_commit(union octep_cp_msg_info *ctx,
+			      struct octep_cp_msg *msg)
+{
+	union octep_ctrl_mbox_msg_hdr *hdr;
+	struct cnxk_pf *pf;
+	int ret;
+
+	pf = get_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+	if (!pf)
+		return -EINVAL;
+
+	hdr = (union octep_ctrl_mbox_msg_hdr *)&msg->info;
+	hdr->s.flags = OCTEP_CTRL_MBOX_MSG_HDR_FLAG_RESP;
+	/* see cnxk_send_msg_resp */
+	hdr->s.pem_idx = 0;
+	hdr->s.pf_idx = 0;
+	ret = octep_ctrl_mbox_send_commit(&pf->mbox,
+					  (struct octep_ctrl_mbox_msg *)msg);
+	if (ret >= 0) {
+		stats_msgs(pf, msg, 1, false);
+		notify_host(pf, 1);
+	}
+	put_pf(ctx->s.pem_idx, ctx->s.pf_idx);
+
+	return (ret < 0) ? ret : 0;
+}
+
 int cnxk_send_event(struct octep_cp_event_info *info)
 {
 	struct cnxk_pf *pf;
+	int ret;
 
 	if (info->e == OCTEP_CP_EVENT_TYPE_FW_READY) {
 		pf = get_pf(info->u.fw_ready.dom_idx, info->u.fw_ready.pf_idx);
 		if (!pf)
 			return -EINVAL;
 
-		return set_fw_ready(&pems[info->u.fw_ready.dom_idx],
-				    pf,
-				    (info->u.fw_ready.ready != 0));
+		ret = hw->set_fw_ready(info->u.fw_ready.dom_idx,
+				       info->u.fw_ready.pf_idx,
+				       (info->u.fw_ready.ready != 0));
+		put_pf(info->u.fw_ready.dom_idx, info->u.fw_ready.pf_idx);
+
+		return ret;
 	} else if (info->e == OCTEP_CP_EVENT_TYPE_HEARTBEAT) {
 		pf = get_pf(info->u.hbeat.dom_idx, info->u.hbeat.pf_idx);
 		if (!pf)
 			return -EINVAL;
 
-		return raise_oei_trig_int(pf, SDP_EPF_OEI_TRIG_BIT_HEARTBEAT);
+		ret = raise_oei_trig_int(pf, SDP_EPF_OEI_TRIG_BIT_HEARTBEAT);
+		if (!ret && pf->stats)
+			CP_STATS_INC(pf->stats, heartbeats);
+		put_pf(info->u.hbeat.dom_idx, info->u.hbeat.pf_idx);
+
+		return ret;
 	}
 
 	return -EINVAL;
 }
 
+int cnxk_send_events(struct octep_cp_event_info *info, int num)
+{
+	bool wmb_done = false;
+	struct cnxk_pf *pf;
+	int i, err;
+
+	for (i = 0; i < num; i++) {
+		if (info[i].e != OCTEP_CP_EVENT_TYPE_HEARTBEAT) {
+			err = cnxk_send_event(&info[i]);
+		} else {
+			pf = get_pf(info[i].u.hbeat.dom_idx,
+				    info[i].u.hbeat.pf_idx);
+			if (!pf) {
+				err = -EINVAL;
+				break;
+			}
+
+			/* heartbeats need not be ordered among themselves,
+			 * one barrier orders the batch after earlier writes.
+			 */
+			if (!wmb_done) {
+				cp_io_wmb();
+				wmb_done = true;
+			}
+			err = raise_oei_trig_int_relaxed(pf,
+							 SDP_EPF_OEI_TRIG_BIT_HEARTBEAT);
+			if (!err && pf->stats)
+				CP_STATS_INC(pf->stats, heartbeats);
+			put_pf(info[i].u.hbeat.dom_idx, info[i].u.hbeat.pf_idx);
+		}
+		if (err)
+			break;
+	}
+
+	return (i) ? i : err;
+}
+
+/* Recheck host status of all pf's */
+static void scan_hosts(uint64_t now)
+{
+	int i, j;
+
+	for (i = 0; i < OCTEP_CP_DOM_MAX; i++) {
+		pthread_mutex_lock(&pem_locks[i].m);
+		if (!pems[i].valid) {
+			pthread_mutex_unlock(&pem_locks[i].m);
+			continue;
+		}
+
+		for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX; j++) {
+			if (!pems[i].pfs[j].valid)
+				continue;
+
+			pthread_mutex_lock(&pf_locks[i][j].m);
+			update_host(&pems[i], &pems[i].pfs[j], now);
+			pthread_mutex_unlock(&pf_locks[i][j].m);
+		}
+		pthread_mutex_unlock(&pem_locks[i].m);
+	}
+}
+
+/* Recheck link of pem's left uninitialized by cnxk_init and fill events for
+ * those which came up
+ */
+static int report_late_pems(struct octep_cp_event_info *info, int num)
+{
+	struct cnxk_pem *pem;
+	int i, err, n = 0;
+
+	for (i = 0; i < OCTEP_CP_DOM_MAX && n < num; i++) {
+		pthread_mutex_lock(&pem_locks[i].m);
+		pem = &pems[i];
+		if (!pem->late) {
+			pthread_mutex_unlock(&pem_locks[i].m);
+			continue;
+		}
+
+		/* csr's were mapped when pem was marked late */
+		err = hw->check_pem(i, 0);
+		if (!err) {
+			clear_late_pem(i);
+			info[n].e = OCTEP_CP_EVENT_TYPE_PEM_UP;
+			info[n].u.pem_up.dom_idx = i;
+			n++;
+			CP_LIB_LOG(INFO, CNXK, "pem[%d] link up\n", i);
+		}
+		pthread_mutex_unlock(&pem_locks[i].m);
+	}
+
+	return n;
+}
+
+/* Fill events for host transitions not reported yet */
+static int report_hosts(struct octep_cp_event_info *info, int num)
+{
+	struct cnxk_pf *pf;
+	int i, j, n = 0;
+
+	for (i = 0; i < OCTEP_CP_DOM_MAX && n < num; i++) {
+		pthread_mutex_lock(&pem_locks[i].m);
+		if (!pems[i].valid) {
+			pthread_mutex_unlock(&pem_locks[i].m);
+			continue;
+		}
+
+		for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX && n < num; j++) {
+			pf = &pems[i].pfs[j];
+			if (!pf->valid)
+				continue;
+
+			pthread_mutex_lock(&pf_locks[i][j].m);
+			if (pf->host_reported != pf->mbox.host_ready) {
+				pf->host_reported = pf->mbox.host_ready;
+				info[n].e = (pf->host_reported) ?
+					    OCTEP_CP_EVENT_TYPE_HOST_READY :
+					    OCTEP_CP_EVENT_TYPE_HOST_GONE;
+				info[n].u.host.dom_idx = i;
+				info[n].u.host.pf_idx = j;
+				info[n].u.host.host_version =
+					(uint32_t)pf->mbox.host_version;
+				n++;
+			}
+			pthread_mutex_unlock(&pf_locks[i][j].m);
+		}
+		pthread_mutex_unlock(&pem_locks[i].m);
+	}
+
+	return n;
+}
+
 int cnxk_recv_event(struct octep_cp_event_info *info, int num)
 {
 	int i, n_ev, data, n;
 	struct cnxk_pem *pem;
+	bool scan, report;
+	uint64_t now;
 
 	for (i = 0, n_ev = 0; i < OCTEP_CP_DOM_MAX; i++) {
+		pthread_mutex_lock(&pem_locks[i].m);
 		pem = &pems[i];
-		if (!pem->valid)
-			continue;
-
-		n = read(pem->uio_fd, &data, sizeof(int));
+		n = (pem->valid && pem->uio_fd > 0) ?
+		    read(pem->uio_fd, &data, sizeof(int)) : 0;
+		if (n > 0 && pem->stats)
+			CP_STATS_INC(pem->stats, perst);
+		pthread_mutex_unlock(&pem_locks[i].m);
 		if (n <= 0)
 			continue;
 
 		info[n_ev].e = OCTEP_CP_EVENT_TYPE_PERST;
 		info[n_ev].u.perst.dom_idx = pem->idx;
 		if (++n_ev >= num)
-			break;
+			return n_ev;
+	}
+
+	now = get_time_ns();
+	pthread_mutex_lock(&active_lock);
+	scan = ((now - host_scan_ns) >= HOST_CHECK_INTERVAL_NS);
+	if (scan)
+		host_scan_ns = now;
+	pthread_mutex_unlock(&active_lock);
+	if (scan) {
+		scan_hosts(now);
+		n_ev += report_late_pems(&info[n_ev], num - n_ev);
+		if (n_ev >= num)
+			return n_ev;
+	}
+
+	pthread_mutex_lock(&active_lock);
+	report = host_events_pending;
+	host_events_pending = false;
+	pthread_mutex_unlock(&active_lock);
+	if (report) {
+		n = report_hosts(&info[n_ev], num - n_ev);
+		n_ev += n;
+		/* more transitions than space for events */
+		if (n_ev >= num) {
+			pthread_mutex_lock(&active_lock);
+			host_events_pending = true;
+			pthread_mutex_unlock(&active_lock);
+		}
 	}
 
 	return n_ev;
 }
 
+int cnxk_get_active_pfs(struct octep_cp_active_pf *pfs, int num)
+{
+	int n;
+
+	pthread_mutex_lock(&active_lock);
+	n = cp_min(num, num_active_pfs);
+	memcpy(pfs, active_pfs, n * sizeof(struct octep_cp_active_pf));
+	pthread_mutex_unlock(&active_lock);
+
+	return n;
+}
+
+int cnxk_flush_intrs(int force)
+{
+	struct cnxk_pf *pf;
+	uint64_t now;
+	int i, j;
+
+	if (!__atomic_load_n(&oei_deferred_pfs, __ATOMIC_RELAXED) &&
+	    !__atomic_load_n(&notify_held_pfs, __ATOMIC_RELAXED))
+		return 0;
+
+	now = get_time_ns();
+	for (i = 0; i < OCTEP_CP_DOM_MAX; i++) {
+		for (j = 0; j < OCTEP_CP_PF_PER_DOM_MAX; j++) {
+			/* unlocked check, rechecked under pf lock */
+			if (!__atomic_load_n(&pems[i].pfs[j].oei_pending,
+					     __ATOMIC_RELAXED) &&
+			    !__atomic_load_n(&pems[i].pfs[j].notify_held,
+					     __ATOMIC_RELAXED))
+				continue;
+
+			pf = get_pf(i, j);
+			if (!pf)
+				continue;
+
+			/* held notification may defer another interrupt */
+			if (force) {
+				flush_notify(pf);
+				flush_oei(pf);
+			} else {
+				poll_notify(pf, now);
+				poll_oei(pf, now);
+			}
+			put_pf(i, j);
+		}
+	}
+
+	return __atomic_load_n(&oei_deferred_pfs, __ATOMIC_RELAXED) +
+	       __atomic_load_n(&notify_held_pfs, __ATOMIC_RELAXED);
+}
+
+int cnxk_get_event_fds(int *fds, int num)
+{
+	int i, n;
+
+	for (i = 0, n = 0; i < OCTEP_CP_DOM_MAX && n < num; i++) {
+		pthread_mutex_lock(&pem_locks[i].m);
+		/* perst interrupts are signalled on pem uio device */
+		if (pems[i].valid && pems[i].uio_fd > 0)
+			fds[n++] = pems[i].uio_fd;
+		pthread_mutex_unlock(&pem_locks[i].m);
+	}
+
+	return n;
+}
+
 int cnxk_uninit()
 {
 	int i;
 
 	CP_LIB_LOG(INFO, CNXK, "uninit\n");
 
-	for (i = 0; i < OCTEP_CP_DOM_MAX; i++)
+	for (i = 0; i < OCTEP_CP_DOM_MAX; i++) {
+		lock_pem(i);
 		if (pems[i].valid)
 			uninit_pem(&pems[i]);
+		clear_late_pem(i);
+		unlock_pem(i);
+	}
+	close_csrs();
 
 	return 0;
 }
 
+void cnxk_set_hw_ops(const struct cnxk_hw_ops *ops)
+{
+	hw = (ops) ? ops : &cnxk_hw_ops;
+}
+
 int cnxk_uninit_pem(int dom_idx)
 {
+	int pem_idx;
+
 	CP_LIB_LOG(INFO, CNXK, "uninit PEM %d\n", dom_idx);
 
-	if (pems[dom_idx].valid)
-		uninit_pem(&pems[dom_idx]);
+	if (dom_idx < 0 || dom_idx >= OCTEP_CP_DOM_MAX)
+		return -EINVAL;
+
+	pem_idx = dom_pems[dom_idx];
+	if (pem_idx < 0)
+		return 0;
+
+	lock_pem(pem_idx);
+	if (pems[pem_idx].valid)
+		uninit_pem(&pems[pem_idx]);
+	unlock_pem(pem_idx);
 
 	return 0;
 }
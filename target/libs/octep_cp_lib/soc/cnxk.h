@@ -4,6 +4,39 @@
 #ifndef __CNXK_H__
 #define __CNXK_H__
 
+/* Hardware access of cnxk implementation.
+ *
+ * pem and pf arguments are hardware indices.
+ */
+struct cnxk_hw_ops {
+	/* check that pem link is up, waiting for it if wait is non zero,
+	 * 0 if pem can be used
+	 */
+	int (*check_pem)(int pem_idx, int wait);
+	/* open fd which is readable on perst, 0 if perst has no fd */
+	int (*open_perst_fd)(int pem_idx);
+	/* open pem bar4 memory, pf mailboxes are at their bar4 address */
+	int (*open_bar4)(int pem_idx);
+	/* open fd to signal oei interrupts of a pf, NULL to write
+	 * oei_trig csr
+	 */
+	int (*open_oei_fd)(int pem_idx, int pf_idx);
+	/* set fw ready status of a pf */
+	int (*set_fw_ready)(int pem_idx, int pf_idx, int status);
+	/* map csr's used by check_pem and set_fw_ready, called before
+	 * check_pem, NULL if pem has no csr's
+	 */
+	int (*map_csrs)(int pem_idx);
+	/* unmap csr's mapped by map_csrs */
+	void (*unmap_csrs)(int pem_idx);
+};
+
+/* Replace hardware access, should be called before cnxk_init.
+ *
+ * @param ops: hardware access, NULL to restore cnxk hardware access.
+ */
+void cnxk_set_hw_ops(const struct cnxk_hw_ops *ops);
+
 /* Initialize cnxk platform.
  *
  * return value: 0 on success, -errno on failure.
@@ -57,6 +90,21 @@ int cnxk_send_msg_resp(union octep_cp_msg_info *ctx,
 int cnxk_send_notification(union octep_cp_msg_info *ctx,
                            struct octep_cp_msg* msg);
 
+/* Send a notification to a set of functions of a pf.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info. This will
+ *             provide the pem, pf indices on which the message should be
+ *             sent.
+ * @param msg: [IN] Message buffer.
+ * @param fns: [IN] Non-null pointer to functions to notify.
+ *
+ * return value: number of notifications sent, queued or held on success,
+ *               -errno on failure.
+ */
+int cnxk_send_notification_fanout(union octep_cp_msg_info *ctx,
+				  struct octep_cp_msg *msg,
+				  const struct octep_cp_fn_set *fns);
+
 /* Receive a new message on given pem/pf.
  *
  * ctx received with the message should be used to send a response.
@@ -74,6 +122,52 @@ int cnxk_recv_msg(union octep_cp_msg_info *ctx,
                   struct octep_cp_msg *msgs,
                   int num);
 
+/* Peek at messages on given pem/pf without copying.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info. This will
+ *             provide the pem, pf indices on which the message should be
+ *             received.
+ * @param msgs: [OUT] Array of message views.
+ * @param num: Number of elements in @msgs.
+ *
+ * return value: number of messages available on success, -errno on failure.
+ */
+int cnxk_recv_msg_peek(union octep_cp_msg_info *ctx,
+                       struct octep_cp_msg *msgs,
+                       int num);
+
+/* Consume messages returned by cnxk_recv_msg_peek.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info.
+ * @param msgs: [IN] First @num messages returned by peek.
+ * @param num: Number of messages to consume.
+ *
+ * return value: number of messages consumed on success, -errno on failure.
+ */
+int cnxk_recv_msg_commit(union octep_cp_msg_info *ctx,
+                         struct octep_cp_msg *msgs,
+                         int num);
+
+/* Reserve mbox space for a message response.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info.
+ * @param msg: [IN/OUT] Caller provides msg.info.s.sz, library fills sg_list.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int cnxk_send_msg_resp_reserve(union octep_cp_msg_info *ctx,
+                               struct octep_cp_msg *msg);
+
+/* Send message response built in reserved space.
+ *
+ * @param ctx: [IN] non-null pointer to union octep_cp_msg_info.
+ * @param msg: [IN] Message passed to cnxk_send_msg_resp_reserve.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int cnxk_send_msg_resp_commit(union octep_cp_msg_info *ctx,
+                              struct octep_cp_msg *msg);
+
 /* Send event to host.
  *
  * Send a new event to host.
@@ -84,6 +178,15 @@ int cnxk_recv_msg(union octep_cp_msg_info *ctx,
  */
 int cnxk_send_event(struct octep_cp_event_info *info);
 
+/* Send a batch of events to host.
+ *
+ * @param info: [IN] Non-Null pointer to event info array.
+ * @param num: [IN] Number of events in @info.
+ *
+ * return value: number of events sent on success, -errno on failure.
+ */
+int cnxk_send_events(struct octep_cp_event_info *info, int num);
+
 /* Receive events.
  *
  * Receive events such as flr, perst etc.
@@ -95,6 +198,36 @@ int cnxk_send_event(struct octep_cp_event_info *info);
  */
 int cnxk_recv_event(struct octep_cp_event_info *info, int num);
 
+/* Get fds which become readable when events are pending.
+ *
+ * @param fds: [OUT] Non-Null pointer to fd array.
+ * @param num: [IN] Number of elements in @fds.
+ *
+ * return value: number of fds on success, -errno on failure.
+ */
+int cnxk_get_event_fds(int *fds, int num);
+
+/* Get pf's with a ready host.
+ *
+ * @param pfs: [OUT] Non-Null pointer to array of active pf's.
+ * @param num: [IN] Number of elements in @pfs.
+ *
+ * return value: number of active pf's on success, -errno on failure.
+ */
+int cnxk_get_active_pfs(struct octep_cp_active_pf *pfs, int num);
+
+/* Raise mailbox interrupts deferred by interrupt moderation and send
+ * notifications held for debounce.
+ *
+ * @param force: [IN] non zero to raise all deferred interrupts, else only
+ *               those whose delay expired.
+ *
+ * return value: number of deferred interrupts and held notifications on
+ *               success,
+ *               -errno on failure.
+ */
+int cnxk_flush_intrs(int force);
+
 /* UnInitialize cnxk mbox, csr's etc for a pem.
  *
  * return value: 0 on success, -errno on failure.
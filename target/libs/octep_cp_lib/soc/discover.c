@@ -0,0 +1,469 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "octep_cp_lib.h"
+#include "cp_log.h"
+#include "discover.h"
+
+#define SYSFS_UIO			"/sys/class/uio"
+#define SYSFS_PCI_DEVICES		"/sys/bus/pci/devices"
+#define BOOT_ID_FILE			"/proc/sys/kernel/random/boot_id"
+
+/* initial size of uio table in index, doubled when full */
+#define DISCOVER_UIO_MIN		64
+#define DISCOVER_NAME_LEN		32
+#define DISCOVER_BOOT_ID_LEN		64
+
+#define PCI_VENDOR_ID_CAVIUM		0x177D
+#define PCI_DEVID_CNXK_RVU_PF		0xA063
+#define PCI_DEVID_CNXK_RVU_VF		0xA064
+#define PCI_DEVID_CNXK_RVU_AF		0xA065
+#define PCI_DEVID_CN10K_RVU_CPT_PF	0xA0F2
+#define PCI_DEVID_CN10K_RVU_CPT_VF	0xA0F3
+#define PCI_DEVID_CNXK_RVU_AF_VF	0xA0f8
+#define PCI_DEVID_CNXK_RVU_SSO_TIM_PF	0xA0F9
+#define PCI_DEVID_CNXK_RVU_SSO_TIM_VF	0xA0FA
+#define PCI_DEVID_CNXK_RVU_NPA_PF	0xA0FB
+#define PCI_DEVID_CNXK_RVU_NPA_VF	0xA0FC
+
+struct discover_uio {
+	char name[DISCOVER_NAME_LEN];
+	int num;
+};
+
+/* Index of discovered devices */
+struct discover_index {
+	/* boot id of index */
+	char boot_id[DISCOVER_BOOT_ID_LEN];
+	/* cache file has been loaded */
+	bool loaded;
+	/* uio devices, valid after scan or load of uio tree */
+	struct discover_uio *uio;
+	int nuio;
+	/* size of uio table */
+	int uio_sz;
+	bool uio_valid;
+	/* rvu device ids, valid after scan or load of pci tree */
+	uint32_t rvu_subsys_dev;
+	uint32_t rvu_rev;
+	bool rvu_found;
+	bool rvu_valid;
+};
+
+static struct discover_index idx;
+static pthread_mutex_t idx_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Read first line of a file without newline */
+static int read_line(const char *path, char *buf, int sz)
+{
+	FILE *f;
+	int len;
+
+	f = fopen(path, "r");
+	if (!f)
+		return -errno;
+
+	if (!fgets(buf, sz, f)) {
+		fclose(f);
+		return -EIO;
+	}
+	fclose(f);
+
+	len = strlen(buf);
+	if (len && buf[len - 1] == '\n')
+		buf[len - 1] = 0;
+
+	return 0;
+}
+
+/* parse a sysfs (or other) file containing one integer value */
+static int parse_sysfs_value(const char *filename, unsigned long *val)
+{
+	FILE *f;
+	char buf[BUFSIZ];
+	char *end = NULL;
+
+	if ((f = fopen(filename, "r")) == NULL) {
+		CP_LIB_LOG(ERR, SOC, "Cannot open sysfs value %s\n", filename);
+		return -EIO;
+	}
+
+	if (fgets(buf, sizeof(buf), f) == NULL) {
+		CP_LIB_LOG(ERR, SOC, "Cannot read sysfs value %s\n", filename);
+		fclose(f);
+		return -EIO;
+	}
+	*val = strtoul(buf, &end, 0);
+	if ((buf[0] == '\0') || (end == NULL) || (*end != '\n')) {
+		CP_LIB_LOG(ERR, SOC, "Cannot parse sysfs value %s\n", filename);
+		fclose(f);
+		return -EIO;
+	}
+	fclose(f);
+	return 0;
+}
+
+/* Detect if RVU device */
+static bool is_rvu_device(unsigned long val)
+{
+	return (val == PCI_DEVID_CNXK_RVU_PF || val == PCI_DEVID_CNXK_RVU_VF ||
+		val == PCI_DEVID_CNXK_RVU_AF ||
+		val == PCI_DEVID_CNXK_RVU_AF_VF ||
+		val == PCI_DEVID_CNXK_RVU_NPA_PF ||
+		val == PCI_DEVID_CNXK_RVU_NPA_VF ||
+		val == PCI_DEVID_CNXK_RVU_SSO_TIM_PF ||
+		val == PCI_DEVID_CNXK_RVU_SSO_TIM_VF ||
+		val == PCI_DEVID_CN10K_RVU_CPT_PF ||
+		val == PCI_DEVID_CN10K_RVU_CPT_VF);
+}
+
+static int rvu_device_lookup(const char *dirname, uint32_t *subsys_dev,
+			     uint32_t *rev)
+{
+	char filename[PATH_MAX];
+	unsigned long val;
+
+	/* Check if vendor id is cavium */
+	snprintf(filename, sizeof(filename), "%s/vendor", dirname);
+	if (parse_sysfs_value(filename, &val) < 0)
+		goto error;
+
+	if (val != PCI_VENDOR_ID_CAVIUM)
+		goto error;
+
+	/* Get device id  */
+	snprintf(filename, sizeof(filename), "%s/device", dirname);
+	if (parse_sysfs_value(filename, &val) < 0)
+		goto error;
+
+	/* Check if device ID belongs to any RVU device */
+	if (!is_rvu_device(val))
+		goto error;
+
+	snprintf(filename, sizeof(filename), "%s/subsystem_device", dirname);
+	if (parse_sysfs_value(filename, &val) < 0)
+		goto error;
+
+	*subsys_dev = val;
+
+	snprintf(filename, sizeof(filename), "%s/revision", dirname);
+	if (parse_sysfs_value(filename, &val) < 0)
+		goto error;
+
+	*rev = val;
+
+	return 0;
+error:
+	return -EINVAL;
+}
+
+/* Scan pci devices up to first rvu device */
+static void scan_pci()
+{
+	char dirname[4064];
+	struct dirent *e;
+	DIR *dir;
+
+	idx.rvu_valid = true;
+	idx.rvu_found = false;
+	dir = opendir(SYSFS_PCI_DEVICES);
+	if (dir == NULL) {
+		CP_LIB_LOG(ERR, SOC, "opendir failed: %s\n", strerror(errno));
+		return;
+	}
+
+	while ((e = readdir(dir)) != NULL) {
+		if (e->d_name[0] == '.')
+			continue;
+
+		snprintf(dirname, sizeof(dirname), "%s/%s", SYSFS_PCI_DEVICES,
+			 e->d_name);
+		if (!rvu_device_lookup(dirname, &idx.rvu_subsys_dev,
+				       &idx.rvu_rev)) {
+			idx.rvu_found = true;
+			break;
+		}
+	}
+
+	closedir(dir);
+}
+
+/* Get free entry at end of uio table, growing table if it is full */
+static struct discover_uio *next_uio()
+{
+	struct discover_uio *uio;
+	int sz;
+
+	if (idx.nuio < idx.uio_sz)
+		return &idx.uio[idx.nuio];
+
+	sz = (idx.uio_sz) ? (idx.uio_sz * 2) : DISCOVER_UIO_MIN;
+	uio = realloc(idx.uio, sz * sizeof(*uio));
+	if (!uio) {
+		CP_LIB_LOG(ERR, SOC, "Cannot grow uio index to %d devices\n",
+			   sz);
+		return NULL;
+	}
+	idx.uio = uio;
+	idx.uio_sz = sz;
+
+	return &idx.uio[idx.nuio];
+}
+
+/* Scan names of all uio devices */
+static void scan_uio()
+{
+	char path[PATH_MAX];
+	struct discover_uio *uio;
+	struct dirent *e;
+	DIR *dir;
+
+	idx.uio_valid = true;
+	idx.nuio = 0;
+	dir = opendir(SYSFS_UIO);
+	if (dir == NULL) {
+		CP_LIB_LOG(ERR, SOC, "%s cannot be opened\n", SYSFS_UIO);
+		return;
+	}
+
+	while ((e = readdir(dir)) != NULL) {
+		if (e->d_name[0] == '.')
+			continue;
+
+		uio = next_uio();
+		if (!uio)
+			break;
+
+		if (sscanf(e->d_name, "uio%d", &uio->num) != 1)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s/name", SYSFS_UIO,
+			 e->d_name);
+		if (read_line(path, uio->name, sizeof(uio->name)))
+			continue;
+
+		idx.nuio++;
+	}
+
+	closedir(dir);
+}
+
+static void get_boot_id(char *boot_id)
+{
+	const char *env;
+
+	env = getenv(OCTEP_CP_DISCOVER_BOOT_ID_ENV);
+	if (env && env[0]) {
+		strncpy(boot_id, env, DISCOVER_BOOT_ID_LEN - 1);
+		boot_id[DISCOVER_BOOT_ID_LEN - 1] = 0;
+		return;
+	}
+
+	if (read_line(BOOT_ID_FILE, boot_id, DISCOVER_BOOT_ID_LEN))
+		boot_id[0] = 0;
+}
+
+static const char *cache_path()
+{
+	const char *path;
+
+	path = getenv(OCTEP_CP_DISCOVER_CACHE_ENV);
+
+	return (path && path[0]) ? path : NULL;
+}
+
+/* Load index from cache file of current boot.
+ *
+ * File has lines:
+ *   boot_id <boot id>
+ *   uio <count>
+ *   uio_dev <num> <name>
+ *   rvu <found> <subsystem device> <revision>
+ * uio and rvu lines are present if the tree was scanned.
+ */
+static void load_cache()
+{
+	char line[DISCOVER_NAME_LEN + DISCOVER_BOOT_ID_LEN];
+	char boot_id[DISCOVER_BOOT_ID_LEN];
+	struct discover_uio *uio;
+	const char *path;
+	int n, found;
+	FILE *f;
+
+	idx.loaded = true;
+	get_boot_id(idx.boot_id);
+	path = cache_path();
+	if (!path || !idx.boot_id[0])
+		return;
+
+	f = fopen(path, "r");
+	if (!f)
+		return;
+
+	if (!fgets(line, sizeof(line), f) ||
+	    sscanf(line, "boot_id %63s", boot_id) != 1 ||
+	    strcmp(boot_id, idx.boot_id)) {
+		CP_LIB_LOG(INFO, SOC, "Ignoring discovery cache %s of other boot\n",
+			   path);
+		fclose(f);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "uio %d", &n) == 1) {
+			idx.uio_valid = true;
+		} else if (!strncmp(line, "uio_dev ", 8)) {
+			uio = next_uio();
+			if (uio && sscanf(line, "uio_dev %d %31[^\n]", &uio->num,
+				   uio->name) == 2)
+				idx.nuio++;
+		} else if (sscanf(line, "rvu %d %u %u", &found,
+				  &idx.rvu_subsys_dev, &idx.rvu_rev) == 3) {
+			idx.rvu_found = found;
+			idx.rvu_valid = true;
+		}
+	}
+	fclose(f);
+
+	CP_LIB_LOG(INFO, SOC, "Loaded discovery cache %s\n", path);
+}
+
+/* Save index to cache file, written to a temporary file first so that
+ * readers never see a partial file
+ */
+static void save_cache()
+{
+	char tmp_path[PATH_MAX];
+	const char *path;
+	int i, err;
+	FILE *f;
+
+	path = cache_path();
+	if (!path || !idx.boot_id[0])
+		return;
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	f = fopen(tmp_path, "w");
+	if (!f) {
+		CP_LIB_LOG(WARNING, SOC, "Cannot create discovery cache %s (%d)\n",
+			   tmp_path, errno);
+		return;
+	}
+
+	fprintf(f, "boot_id %s\n", idx.boot_id);
+	if (idx.uio_valid) {
+		fprintf(f, "uio %d\n", idx.nuio);
+		for (i = 0; i < idx.nuio; i++)
+			fprintf(f, "uio_dev %d %s\n", idx.uio[i].num,
+				idx.uio[i].name);
+	}
+	if (idx.rvu_valid)
+		fprintf(f, "rvu %d %u %u\n", idx.rvu_found,
+			idx.rvu_subsys_dev, idx.rvu_rev);
+
+	err = fclose(f) ? -errno : 0;
+	if (!err && rename(tmp_path, path))
+		err = -errno;
+	if (err) {
+		CP_LIB_LOG(WARNING, SOC, "Cannot write discovery cache %s (%d)\n",
+			   path, err);
+		remove(tmp_path);
+	}
+}
+
+static struct discover_uio *find_uio(const char *name)
+{
+	struct discover_uio *prefix = NULL;
+	int i, len;
+
+	len = strlen(name);
+	for (i = 0; i < idx.nuio; i++) {
+		if (!strcmp(idx.uio[i].name, name))
+			return &idx.uio[i];
+		if (!prefix && !strncmp(idx.uio[i].name, name, len))
+			prefix = &idx.uio[i];
+	}
+
+	return prefix;
+}
+
+/* Check that a cached uio device still has its name */
+static bool uio_current(const struct discover_uio *uio)
+{
+	char name[DISCOVER_NAME_LEN];
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/uio%d/name", SYSFS_UIO, uio->num);
+	if (read_line(path, name, sizeof(name)))
+		return false;
+
+	return !strcmp(name, uio->name);
+}
+
+int discover_uio(const char *name)
+{
+	struct discover_uio *uio;
+	bool scanned = false;
+	int num = -ENOENT;
+
+	pthread_mutex_lock(&idx_lock);
+	if (!idx.loaded)
+		load_cache();
+
+	if (!idx.uio_valid) {
+		scan_uio();
+		save_cache();
+		scanned = true;
+	}
+
+	uio = find_uio(name);
+	/* uio devices can appear after the index was built or be renumbered
+	 * by driver reloads within a boot, whether index came from cache or
+	 * from an earlier scan
+	 */
+	if (!scanned && (!uio || !uio_current(uio))) {
+		CP_LIB_LOG(INFO, SOC, "Discovery index stale for %s\n", name);
+		scan_uio();
+		save_cache();
+		uio = find_uio(name);
+	}
+	if (uio)
+		num = uio->num;
+	pthread_mutex_unlock(&idx_lock);
+
+	return num;
+}
+
+int discover_rvu(uint32_t *subsys_dev, uint32_t *rev)
+{
+	int err = -ENODEV;
+
+	pthread_mutex_lock(&idx_lock);
+	if (!idx.loaded)
+		load_cache();
+
+	if (!idx.rvu_valid) {
+		scan_pci();
+		save_cache();
+	}
+
+	if (idx.rvu_found) {
+		*subsys_dev = idx.rvu_subsys_dev;
+		*rev = idx.rvu_rev;
+		err = 0;
+	}
+	pthread_mutex_unlock(&idx_lock);
+
+	return err;
+}
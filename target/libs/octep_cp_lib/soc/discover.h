@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __DISCOVER_H__
+#define __DISCOVER_H__
+
+/* Device discovery index.
+ *
+ * /sys/class/uio and /sys/bus/pci/devices are each scanned once, on first
+ * lookup, into an index of uio name to uio number and rvu device ids. If
+ * OCTEP_CP_DISCOVER_CACHE_ENV is set, index is saved to that file and loaded
+ * from it by later processes of the same boot, see octep_cp_lib.h.
+ * Functions are thread safe.
+ */
+
+/* Find uio device by name.
+ *
+ * Uio devices whose name starts with @name match if none matches exactly.
+ *
+ * @param name: [IN] Non-Null uio name, such as "PEM0".
+ *
+ * return value: uio number on success, -ENOENT if not found.
+ */
+int discover_uio(const char *name);
+
+/* Get ids of rvu device.
+ *
+ * @param subsys_dev: [OUT] Non-Null pointer to pci subsystem device id.
+ * @param rev: [OUT] Non-Null pointer to pci revision.
+ *
+ * return value: 0 on success, -ENODEV if there is no rvu device.
+ */
+int discover_rvu(uint32_t *subsys_dev, uint32_t *rev);
+
+#endif /* __DISCOVER_H__ */
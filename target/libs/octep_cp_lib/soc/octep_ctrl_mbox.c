@@ -3,8 +3,11 @@
  */
 #include <stdint.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
 
 #include "octep_ctrl_mbox.h"
 #include "cp_compat.h"
@@ -14,55 +17,144 @@
 /* Time in msecs to wait for message response */
 #define OCTEP_CTRL_MBOX_MSG_WAIT_MS			10
 
-/* Size of mbox info in bytes */
-#define OCTEP_CTRL_MBOX_INFO_SZ				256
-/* Size of mbox host to fw queue info in bytes */
-#define OCTEP_CTRL_MBOX_H2FQ_INFO_SZ			16
-/* Size of mbox fw to host queue info in bytes */
-#define OCTEP_CTRL_MBOX_F2HQ_INFO_SZ			16
-
-#define OCTEP_CTRL_MBOX_TOTAL_INFO_SZ	(OCTEP_CTRL_MBOX_INFO_SZ + \
-					 OCTEP_CTRL_MBOX_H2FQ_INFO_SZ + \
-					 OCTEP_CTRL_MBOX_F2HQ_INFO_SZ)
-
-#define OCTEP_CTRL_MBOX_INFO_MAGIC_NUM(m)	((m) + 0)
-#define OCTEP_CTRL_MBOX_INFO_BARMEM_SZ(m)	((m) + 8)
-#define OCTEP_CTRL_MBOX_INFO_HOST_VERSION(m)	((m) + 16)
-#define OCTEP_CTRL_MBOX_INFO_HOST_STATUS(m)	((m) + 24)
-#define OCTEP_CTRL_MBOX_INFO_FW_VERSION(m)	((m) + 136)
-#define OCTEP_CTRL_MBOX_INFO_FW_STATUS(m)	((m) + 144)
-
-#define OCTEP_CTRL_MBOX_H2FQ_INFO(m)	((m) + OCTEP_CTRL_MBOX_INFO_SZ)
-#define OCTEP_CTRL_MBOX_H2FQ_PROD(m)	(OCTEP_CTRL_MBOX_H2FQ_INFO(m))
-#define OCTEP_CTRL_MBOX_H2FQ_CONS(m)	(OCTEP_CTRL_MBOX_H2FQ_INFO(m) + 4)
-#define OCTEP_CTRL_MBOX_H2FQ_SZ(m)	(OCTEP_CTRL_MBOX_H2FQ_INFO(m) + 8)
-
-#define OCTEP_CTRL_MBOX_F2HQ_INFO(m)	((m) + \
-					 OCTEP_CTRL_MBOX_INFO_SZ + \
-					 OCTEP_CTRL_MBOX_H2FQ_INFO_SZ)
-#define OCTEP_CTRL_MBOX_F2HQ_PROD(m)	(OCTEP_CTRL_MBOX_F2HQ_INFO(m))
-#define OCTEP_CTRL_MBOX_F2HQ_CONS(m)	((OCTEP_CTRL_MBOX_F2HQ_INFO(m)) + 4)
-#define OCTEP_CTRL_MBOX_F2HQ_SZ(m)	((OCTEP_CTRL_MBOX_F2HQ_INFO(m)) + 8)
-
 static const uint32_t mbox_hdr_sz = sizeof(union octep_ctrl_mbox_msg_hdr);
 
-static inline int is_host_ready(struct octep_ctrl_mbox *mbox)
+/* Max iovecs per pwritev in OCTEP_CTRL_MBOX_ACCESS_FD_VEC mode */
+#define OCTEP_CTRL_MBOX_IOV_MAX				32
+
+/* Queue writes collected for a single pwritev */
+struct mbox_wr_batch {
+	struct iovec iov[OCTEP_CTRL_MBOX_IOV_MAX];
+	int cnt;
+	/* bar memory address of first iovec */
+	uint64_t addr;
+	/* total size of iovecs */
+	size_t len;
+};
+
+static inline volatile void *mbox_va(struct octep_ctrl_mbox *mbox,
+				     uint64_t addr)
 {
-	uint64_t val;
+	return (volatile uint8_t *)mbox->barmem_va + (addr - mbox->barmem);
+}
 
-	if (!mbox->host_version)
-		mbox->host_version = cp_read64_fd(OCTEP_CTRL_MBOX_INFO_HOST_VERSION(mbox->barmem),
-						  mbox->bar4_fd);
+static inline uint32_t mbox_read32(struct octep_ctrl_mbox *mbox, uint64_t addr)
+{
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_MMAP)
+		return cp_read32(mbox_va(mbox, addr));
 
-	if (!mbox->host_version)
-		return 0;
+	mbox->nsyscalls++;
+	return cp_read32_fd(addr, mbox->bar4_fd);
+}
 
-	val = cp_read64_fd(OCTEP_CTRL_MBOX_INFO_HOST_STATUS(mbox->barmem),
-			   mbox->bar4_fd);
-	if (val != OCTEP_CTRL_MBOX_STATUS_READY)
-		return 0;
+static inline uint64_t mbox_read64(struct octep_ctrl_mbox *mbox, uint64_t addr)
+{
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_MMAP)
+		return cp_read64(mbox_va(mbox, addr));
 
-	return 1;
+	mbox->nsyscalls++;
+	return cp_read64_fd(addr, mbox->bar4_fd);
+}
+
+static inline void mbox_write32(struct octep_ctrl_mbox *mbox, uint32_t value,
+				uint64_t addr)
+{
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_MMAP) {
+		cp_write32(value, mbox_va(mbox, addr));
+		return;
+	}
+
+	mbox->nsyscalls++;
+	cp_write32_fd(value, addr, mbox->bar4_fd);
+}
+
+static inline void mbox_write64(struct octep_ctrl_mbox *mbox, uint64_t value,
+				uint64_t addr)
+{
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_MMAP) {
+		cp_write64(value, mbox_va(mbox, addr));
+		return;
+	}
+
+	mbox->nsyscalls++;
+	cp_write64_fd(value, addr, mbox->bar4_fd);
+}
+
+static inline void mbox_read(struct octep_ctrl_mbox *mbox, void *buf,
+			     uint32_t count, uint64_t addr)
+{
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_MMAP) {
+		cp_memcpy_fromio(buf, mbox_va(mbox, addr), count);
+		return;
+	}
+
+	mbox->nsyscalls++;
+	cp_read_fd(buf, count, addr, mbox->bar4_fd);
+}
+
+static inline void mbox_wr_batch_flush(struct octep_ctrl_mbox *mbox,
+				       struct mbox_wr_batch *wb)
+{
+	if (!wb->cnt)
+		return;
+
+	mbox->nsyscalls++;
+	cp_writev_fd(wb->iov, wb->cnt, wb->addr, mbox->bar4_fd);
+	wb->cnt = 0;
+	wb->len = 0;
+}
+
+static inline void mbox_write(struct octep_ctrl_mbox *mbox,
+			      struct mbox_wr_batch *wb, void *buf,
+			      uint32_t count, uint64_t addr)
+{
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_MMAP) {
+		cp_memcpy_toio(mbox_va(mbox, addr), buf, count);
+		return;
+	}
+
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_FD || !wb) {
+		mbox->nsyscalls++;
+		cp_write_fd(buf, count, addr, mbox->bar4_fd);
+		return;
+	}
+
+	/* start a new batch on queue roll over or full iovec array */
+	if (wb->cnt == OCTEP_CTRL_MBOX_IOV_MAX ||
+	    (wb->cnt && (wb->addr + wb->len) != addr))
+		mbox_wr_batch_flush(mbox, wb);
+
+	if (!wb->cnt)
+		wb->addr = addr;
+	wb->iov[wb->cnt].iov_base = buf;
+	wb->iov[wb->cnt].iov_len = count;
+	wb->len += count;
+	wb->cnt++;
+}
+
+/* Read producer and consumer index of a queue */
+static inline void mbox_read_q_idx(struct octep_ctrl_mbox *mbox,
+				   struct octep_ctrl_mbox_q *q,
+				   uint32_t *pi, uint32_t *ci)
+{
+	uint32_t info[2];
+
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_FD_VEC) {
+		/* producer and consumer index are adjacent in queue info */
+		mbox_read(mbox, info, sizeof(info), q->hw_prod);
+		*pi = info[0];
+		*ci = info[1];
+		return;
+	}
+
+	*pi = mbox_read32(mbox, q->hw_prod);
+	*ci = mbox_read32(mbox, q->hw_cons);
+}
+
+/* host status is read by octep_ctrl_mbox_check_host */
+static inline int is_host_ready(struct octep_ctrl_mbox *mbox)
+{
+	return mbox->host_ready;
 }
 
 static inline uint32_t octep_ctrl_mbox_circq_inc(uint32_t index, uint32_t inc,
@@ -71,47 +163,80 @@ static inline uint32_t octep_ctrl_mbox_circq_inc(uint32_t index, uint32_t inc,
 	return (index + inc) % sz;
 }
 
-static inline uint32_t octep_ctrl_mbox_circq_space(uint32_t pi, uint32_t ci,
+static inline uint32_t octep_ctrl_mbox_circq_depth(uint32_t pi, uint32_t ci,
 						   uint32_t sz)
 {
-	return sz - (abs(pi - ci) % sz);
+	return (pi >= ci) ? (pi - ci) : (sz - ci + pi);
 }
 
-static inline uint32_t octep_ctrl_mbox_circq_depth(uint32_t pi, uint32_t ci,
+static inline uint32_t octep_ctrl_mbox_circq_space(uint32_t pi, uint32_t ci,
 						   uint32_t sz)
 {
-	return (abs(pi - ci) % sz);
+	/* keep one byte unused so that a full queue is not seen as empty */
+	return sz - octep_ctrl_mbox_circq_depth(pi, ci, sz) - 1;
 }
 
 static inline int set_mbox_info(struct octep_ctrl_mbox *mbox)
 {
-	uint16_t qsz;
+	uint32_t qsz, h2fq_sz, f2hq_sz, h2fq_pct;
 
-	if (mbox->barmem_sz <= OCTEP_CTRL_MBOX_INFO_SZ)
+	if (mbox->barmem_sz <= OCTEP_CTRL_MBOX_TOTAL_INFO_SZ)
 		return -ENOMEM;
 
-	qsz = (mbox->barmem_sz - OCTEP_CTRL_MBOX_INFO_SZ) / 2;
+	h2fq_pct = (mbox->h2fq_pct) ? mbox->h2fq_pct : 50;
+	if (h2fq_pct >= 100)
+		return -EINVAL;
+
+	/* keep f2hq 8 byte aligned for 64 bit accesses */
+	qsz = mbox->barmem_sz - OCTEP_CTRL_MBOX_TOTAL_INFO_SZ;
+	h2fq_sz = (uint32_t)(((uint64_t)qsz * h2fq_pct) / 100) & ~0x7U;
+	f2hq_sz = qsz - h2fq_sz;
 	/* mbox element sz = hdr(2 words) + data(2 words) = 4 words
 	 * each queue should have atleast 2 elements
 	 */
-	if (qsz < 64)
+	if (h2fq_sz < 64 || f2hq_sz < 64)
 		return -ENOMEM;
 
-	mbox->h2fq.sz = qsz;
+	mbox->h2fq.sz = h2fq_sz;
 	mbox->h2fq.hw_prod = OCTEP_CTRL_MBOX_H2FQ_PROD(mbox->barmem);
 	mbox->h2fq.hw_cons = OCTEP_CTRL_MBOX_H2FQ_CONS(mbox->barmem);
 	mbox->h2fq.hw_q = mbox->barmem + OCTEP_CTRL_MBOX_TOTAL_INFO_SZ;
 
-	mbox->f2hq.sz = qsz;
+	/* host expects f2hq to immediately follow h2fq */
+	mbox->f2hq.sz = f2hq_sz;
 	mbox->f2hq.hw_prod = OCTEP_CTRL_MBOX_F2HQ_PROD(mbox->barmem);
 	mbox->f2hq.hw_cons = OCTEP_CTRL_MBOX_F2HQ_CONS(mbox->barmem);
-	mbox->f2hq.hw_q = mbox->barmem + OCTEP_CTRL_MBOX_TOTAL_INFO_SZ + qsz;
+	mbox->f2hq.hw_q = mbox->h2fq.hw_q + h2fq_sz;
 
 	mbox->host_version = 0;
+	mbox->host_ready = false;
 
 	return 0;
 }
 
+int octep_ctrl_mbox_check_host(struct octep_ctrl_mbox *mbox)
+{
+	uint64_t val;
+
+	if (!mbox)
+		return -EINVAL;
+
+	val = mbox_read64(mbox, OCTEP_CTRL_MBOX_INFO_HOST_STATUS(mbox->barmem));
+	if (val != OCTEP_CTRL_MBOX_STATUS_READY) {
+		/* host may come back with a different version */
+		mbox->host_version = 0;
+		mbox->host_ready = false;
+		return 0;
+	}
+
+	if (!mbox->host_version)
+		mbox->host_version = mbox_read64(mbox,
+						 OCTEP_CTRL_MBOX_INFO_HOST_VERSION(mbox->barmem));
+	mbox->host_ready = (mbox->host_version != 0);
+
+	return mbox->host_ready;
+}
+
 int octep_ctrl_mbox_init(struct octep_ctrl_mbox *mbox)
 {
 	uint64_t supported_versions;
@@ -120,55 +245,60 @@ int octep_ctrl_mbox_init(struct octep_ctrl_mbox *mbox)
 	if (!mbox)
 		return -EINVAL;
 
-	if (!mbox->bar4_fd || !mbox->barmem || !mbox->barmem_sz)
+	if (!mbox->barmem || !mbox->barmem_sz)
+		return -EINVAL;
+
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_MMAP) {
+		if (!mbox->barmem_va)
+			return -EINVAL;
+	} else if (!mbox->bar4_fd) {
 		return -EINVAL;
+	}
 
 	err = set_mbox_info(mbox);
 	if (err)
 		return err;
 
-	cp_write64_fd(OCTEP_CTRL_MBOX_MAGIC_NUMBER,
-		      OCTEP_CTRL_MBOX_INFO_MAGIC_NUM(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write32_fd(mbox->barmem_sz,
-		      OCTEP_CTRL_MBOX_INFO_BARMEM_SZ(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write64_fd(OCTEP_CTRL_MBOX_STATUS_INIT,
-		      OCTEP_CTRL_MBOX_INFO_FW_STATUS(mbox->barmem),
-		      mbox->bar4_fd);
+	/* drop reservation made before reinit */
+	mbox->f2hq_gen++;
+
+	mbox_write64(mbox, OCTEP_CTRL_MBOX_MAGIC_NUMBER,
+		     OCTEP_CTRL_MBOX_INFO_MAGIC_NUM(mbox->barmem));
+	mbox_write32(mbox, mbox->barmem_sz,
+		     OCTEP_CTRL_MBOX_INFO_BARMEM_SZ(mbox->barmem));
+	mbox_write64(mbox, OCTEP_CTRL_MBOX_STATUS_INIT,
+		     OCTEP_CTRL_MBOX_INFO_FW_STATUS(mbox->barmem));
 	supported_versions = (((uint64_t)mbox->min_version) << 32) |
 			      mbox->max_version;
-	cp_write64_fd(supported_versions,
-		      OCTEP_CTRL_MBOX_INFO_FW_VERSION(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write32_fd(0,
-		      OCTEP_CTRL_MBOX_H2FQ_PROD(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write32_fd(0,
-		      OCTEP_CTRL_MBOX_H2FQ_CONS(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write32_fd(mbox->h2fq.sz,
-		      OCTEP_CTRL_MBOX_H2FQ_SZ(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write32_fd(0,
-		      OCTEP_CTRL_MBOX_F2HQ_PROD(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write32_fd(0,
-		      OCTEP_CTRL_MBOX_F2HQ_CONS(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write32_fd(mbox->f2hq.sz,
-		      OCTEP_CTRL_MBOX_F2HQ_SZ(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write64_fd(OCTEP_CTRL_MBOX_STATUS_READY,
-		      OCTEP_CTRL_MBOX_INFO_FW_STATUS(mbox->barmem),
-		      mbox->bar4_fd);
+	mbox_write64(mbox, supported_versions,
+		     OCTEP_CTRL_MBOX_INFO_FW_VERSION(mbox->barmem));
+	mbox_write32(mbox, 0, OCTEP_CTRL_MBOX_H2FQ_PROD(mbox->barmem));
+	mbox_write32(mbox, 0, OCTEP_CTRL_MBOX_H2FQ_CONS(mbox->barmem));
+	mbox_write32(mbox, mbox->h2fq.sz, OCTEP_CTRL_MBOX_H2FQ_SZ(mbox->barmem));
+	mbox_write32(mbox, 0, OCTEP_CTRL_MBOX_F2HQ_PROD(mbox->barmem));
+	mbox_write32(mbox, 0, OCTEP_CTRL_MBOX_F2HQ_CONS(mbox->barmem));
+	mbox_write32(mbox, mbox->f2hq.sz, OCTEP_CTRL_MBOX_F2HQ_SZ(mbox->barmem));
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_FD_VEC) {
+		mbox->h2fq.shadow = calloc(1, mbox->h2fq.sz);
+		mbox->f2hq.shadow = calloc(1, mbox->f2hq.sz);
+		if (!mbox->h2fq.shadow || !mbox->f2hq.shadow) {
+			free(mbox->h2fq.shadow);
+			free(mbox->f2hq.shadow);
+			mbox->h2fq.shadow = NULL;
+			mbox->f2hq.shadow = NULL;
+			return -ENOMEM;
+		}
+	}
+	mbox_write64(mbox, OCTEP_CTRL_MBOX_STATUS_READY,
+		     OCTEP_CTRL_MBOX_INFO_FW_STATUS(mbox->barmem));
 
 	return 0;
 }
 
-static int write_mbox_data(struct octep_ctrl_mbox_q *q, uint32_t *pi,
-			   uint32_t ci, void *buf, uint32_t w_sz,
-			   int fd)
+static int write_mbox_data(struct octep_ctrl_mbox *mbox,
+			   struct mbox_wr_batch *wb,
+			   struct octep_ctrl_mbox_q *q, uint32_t *pi,
+			   uint32_t ci, void *buf, uint32_t w_sz)
 {
 	uint32_t cp_sz;
 	uint64_t qbuf;
@@ -177,19 +307,19 @@ static int write_mbox_data(struct octep_ctrl_mbox_q *q, uint32_t *pi,
 	qbuf = (q->hw_q + *pi);
 	if (*pi < ci) {
 		/* copy entire w_sz */
-		cp_write_fd(buf, w_sz, qbuf, fd);
+		mbox_write(mbox, wb, buf, w_sz, qbuf);
 		*pi = octep_ctrl_mbox_circq_inc(*pi, w_sz, q->sz);
 	} else {
 		/* copy upto end of queue */
 		cp_sz = cp_min((q->sz - *pi), w_sz);
-		cp_write_fd(buf, cp_sz, qbuf, fd);
+		mbox_write(mbox, wb, buf, cp_sz, qbuf);
 		w_sz -= cp_sz;
 		*pi = octep_ctrl_mbox_circq_inc(*pi, cp_sz, q->sz);
 		if (w_sz) {
 			/* roll over and copy remaining w_sz */
 			buf += cp_sz;
 			qbuf = (q->hw_q + *pi);
-			cp_write_fd(buf, w_sz, qbuf, fd);
+			mbox_write(mbox, wb, buf, w_sz, qbuf);
 			*pi = octep_ctrl_mbox_circq_inc(*pi, w_sz, q->sz);
 		}
 	}
@@ -205,6 +335,7 @@ int octep_ctrl_mbox_send(struct octep_ctrl_mbox *mbox,
 	struct octep_ctrl_mbox_msg *msg;
 	struct octep_ctrl_mbox_q *q;
 	uint32_t pi, ci, prev_pi, buf_sz, w_sz;
+	struct mbox_wr_batch wb;
 	int m, s;
 
 	if (!mbox || !msgs)
@@ -214,8 +345,11 @@ int octep_ctrl_mbox_send(struct octep_ctrl_mbox *mbox,
 		return -EIO;
 
 	q = &mbox->f2hq;
-	pi = cp_read32_fd(q->hw_prod, mbox->bar4_fd);
-	ci = cp_read32_fd(q->hw_cons, mbox->bar4_fd);
+	/* messages may be written over reserved space */
+	mbox->f2hq_gen++;
+	wb.cnt = 0;
+	wb.len = 0;
+	mbox_read_q_idx(mbox, q, &pi, &ci);
 	for (m = 0; m < num; m++) {
 		msg = &msgs[m];
 		if (!msg)
@@ -227,12 +361,12 @@ int octep_ctrl_mbox_send(struct octep_ctrl_mbox *mbox,
 			break;
 
 		prev_pi = pi;
-		write_mbox_data(q, &pi, ci, (void*)&msg->hdr, mbox_hdr_sz, mbox->bar4_fd);
+		write_mbox_data(mbox, &wb, q, &pi, ci, (void*)&msg->hdr, mbox_hdr_sz);
 		buf_sz = msg->hdr.s.sz;
 		for (s = 0; ((s < msg->sg_num) && (buf_sz > 0)); s++) {
 			sg = &msg->sg_list[s];
 			w_sz = (sg->sz <= buf_sz) ? sg->sz : buf_sz;
-			write_mbox_data(q, &pi, ci, sg->msg, w_sz, mbox->bar4_fd);
+			write_mbox_data(mbox, &wb, q, &pi, ci, sg->msg, w_sz);
 			buf_sz -= w_sz;
 		}
 		if (buf_sz) {
@@ -241,35 +375,63 @@ int octep_ctrl_mbox_send(struct octep_ctrl_mbox *mbox,
 			break;
 		}
 	}
-	cp_write32_fd(pi, q->hw_prod, mbox->bar4_fd);
+	mbox_wr_batch_flush(mbox, &wb);
+	if (!m)
+		return -EAGAIN;
 
-	return (m) ? m : -EAGAIN;
+	/* single producer index update for all messages,
+	 * cp_write32 orders message data before producer index
+	 */
+	mbox_write32(mbox, pi, q->hw_prod);
+
+	return m;
 }
 
-static int read_mbox_data(struct octep_ctrl_mbox_q *q, uint32_t pi,
-			  uint32_t *ci, void *buf, uint32_t r_sz,
-			  int fd)
+/* Read r_sz bytes at queue offset off, from shadow if it is populated */
+static inline void mbox_q_read(struct octep_ctrl_mbox *mbox,
+			       struct octep_ctrl_mbox_q *q, void *buf,
+			       uint32_t r_sz, uint32_t off)
+{
+	if (q->shadow)
+		memcpy(buf, (uint8_t *)q->shadow + off, r_sz);
+	else
+		mbox_read(mbox, buf, r_sz, q->hw_q + off);
+}
+
+/* Copy r_sz bytes from queue offset ci into shadow, at most 2 reads */
+static void mbox_q_fill_shadow(struct octep_ctrl_mbox *mbox,
+			       struct octep_ctrl_mbox_q *q, uint32_t ci,
+			       uint32_t r_sz)
+{
+	uint32_t cp_sz;
+
+	cp_sz = cp_min((q->sz - ci), r_sz);
+	mbox_read(mbox, (uint8_t *)q->shadow + ci, cp_sz, q->hw_q + ci);
+	if (r_sz > cp_sz)
+		mbox_read(mbox, q->shadow, r_sz - cp_sz, q->hw_q);
+}
+
+static int read_mbox_data(struct octep_ctrl_mbox *mbox,
+			  struct octep_ctrl_mbox_q *q, uint32_t pi,
+			  uint32_t *ci, void *buf, uint32_t r_sz)
 {
 	uint32_t cp_sz;
-	uint64_t qbuf;
 
 	/* Assumption: Caller has ensured enough read space */
-	qbuf = (q->hw_q + *ci);
 	if (*ci < pi) {
 		/* copy entire r_sz */
-		cp_read_fd(buf, r_sz, qbuf, fd);
+		mbox_q_read(mbox, q, buf, r_sz, *ci);
 		*ci = octep_ctrl_mbox_circq_inc(*ci, r_sz, q->sz);
 	} else {
 		/* copy upto end of queue */
 		cp_sz = cp_min((q->sz - *ci), r_sz);
-		cp_read_fd(buf, cp_sz, qbuf, fd);
+		mbox_q_read(mbox, q, buf, cp_sz, *ci);
 		r_sz -= cp_sz;
 		*ci = octep_ctrl_mbox_circq_inc(*ci, cp_sz, q->sz);
 		if (r_sz) {
 			/* roll over and copy remaining r_sz */
 			buf += cp_sz;
-			qbuf = (q->hw_q + *ci);
-			cp_read_fd(buf, r_sz, qbuf, fd);
+			mbox_q_read(mbox, q, buf, r_sz, *ci);
 			*ci = octep_ctrl_mbox_circq_inc(*ci, r_sz, q->sz);
 		}
 	}
@@ -277,6 +439,21 @@ static int read_mbox_data(struct octep_ctrl_mbox_q *q, uint32_t pi,
 	return 0;
 }
 
+/* Bytes that can be received into msgs, header included */
+static uint32_t mbox_msgs_capacity(struct octep_ctrl_mbox_msg *msgs, int num)
+{
+	uint32_t cap = 0;
+	int m, s;
+
+	for (m = 0; m < num; m++) {
+		cap += mbox_hdr_sz;
+		for (s = 0; s < msgs[m].sg_num; s++)
+			cap += msgs[m].sg_list[s].sz;
+	}
+
+	return cap;
+}
+
 int octep_ctrl_mbox_recv(struct octep_ctrl_mbox *mbox,
 			 struct octep_ctrl_mbox_msg *msgs,
 			 int num)
@@ -294,8 +471,15 @@ int octep_ctrl_mbox_recv(struct octep_ctrl_mbox *mbox,
 		return -EIO;
 
 	q = &mbox->h2fq;
-	pi = cp_read32_fd(q->hw_prod, mbox->bar4_fd);
-	ci = cp_read32_fd(q->hw_cons, mbox->bar4_fd);
+	mbox_read_q_idx(mbox, q, &pi, &ci);
+	mbox->h2fq_depth = octep_ctrl_mbox_circq_depth(pi, ci, q->sz);
+	if (q->shadow) {
+		/* pull everything that can be consumed in one go */
+		q_depth = mbox->h2fq_depth;
+		r_sz = cp_min(q_depth, mbox_msgs_capacity(msgs, num));
+		if (r_sz)
+			mbox_q_fill_shadow(mbox, q, ci, r_sz);
+	}
 	for (m = 0; m < num; m++) {
 		q_depth = octep_ctrl_mbox_circq_depth(pi, ci, q->sz);
 		if (q_depth < mbox_hdr_sz)
@@ -306,12 +490,12 @@ int octep_ctrl_mbox_recv(struct octep_ctrl_mbox *mbox,
 			break;
 
 		prev_ci = ci;
-		read_mbox_data(q, pi, &ci, (void*)&msg->hdr, mbox_hdr_sz, mbox->bar4_fd);
+		read_mbox_data(mbox, q, pi, &ci, (void*)&msg->hdr, mbox_hdr_sz);
 		buf_sz = msg->hdr.s.sz;
 		for (s = 0; ((s < msg->sg_num) && (buf_sz > 0)); s++) {
 			sg = &msg->sg_list[s];
 			r_sz = (sg->sz <= buf_sz) ? sg->sz : buf_sz;
-			read_mbox_data(q, pi, &ci, sg->msg, r_sz, mbox->bar4_fd);
+			read_mbox_data(mbox, q, pi, &ci, sg->msg, r_sz);
 			buf_sz -= r_sz;
 		}
 		if (buf_sz) {
@@ -320,11 +504,204 @@ int octep_ctrl_mbox_recv(struct octep_ctrl_mbox *mbox,
 			break;
 		}
 	}
-	cp_write32_fd(ci, q->hw_cons, mbox->bar4_fd);
+	/* complete message reads before host can reuse the space */
+	cp_io_rmb();
+	mbox_write32(mbox, ci, q->hw_cons);
 
 	return (m) ? m : -EAGAIN;
 }
 
+/* Pointer to queue offset off, in shadow or mapped bar memory */
+static inline void *mbox_q_ptr(struct octep_ctrl_mbox *mbox,
+			       struct octep_ctrl_mbox_q *q, uint32_t off)
+{
+	if (q->shadow)
+		return (uint8_t *)q->shadow + off;
+
+	return (void *)mbox_va(mbox, q->hw_q + off);
+}
+
+/* Describe sz bytes at queue offset off in msg sg_list */
+static void mbox_q_view(struct octep_ctrl_mbox *mbox,
+			struct octep_ctrl_mbox_q *q, uint32_t off,
+			uint32_t sz, struct octep_ctrl_mbox_msg *msg)
+{
+	uint32_t seg_sz;
+
+	msg->sg_num = 0;
+	if (!sz)
+		return;
+
+	seg_sz = cp_min((q->sz - off), sz);
+	msg->sg_list[0].msg = mbox_q_ptr(mbox, q, off);
+	msg->sg_list[0].sz = seg_sz;
+	msg->sg_num = 1;
+	if (sz > seg_sz) {
+		msg->sg_list[1].msg = mbox_q_ptr(mbox, q, 0);
+		msg->sg_list[1].sz = sz - seg_sz;
+		msg->sg_num = 2;
+	}
+}
+
+int octep_ctrl_mbox_recv_peek(struct octep_ctrl_mbox *mbox,
+			      struct octep_ctrl_mbox_msg *msgs,
+			      int num)
+{
+	struct octep_ctrl_mbox_msg *msg;
+	struct octep_ctrl_mbox_q *q;
+	uint32_t pi, ci, q_depth, prev_ci;
+	int m;
+
+	if (!mbox || !msgs)
+		return -EINVAL;
+
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_FD)
+		return -ENOTSUP;
+
+	if (!is_host_ready(mbox))
+		return -EIO;
+
+	q = &mbox->h2fq;
+	mbox_read_q_idx(mbox, q, &pi, &ci);
+	q_depth = octep_ctrl_mbox_circq_depth(pi, ci, q->sz);
+	mbox->h2fq_depth = q_depth;
+	if (q->shadow && q_depth)
+		mbox_q_fill_shadow(mbox, q, ci, q_depth);
+
+	for (m = 0; m < num; m++) {
+		if (q_depth < mbox_hdr_sz)
+			break;
+
+		msg = &msgs[m];
+		prev_ci = ci;
+		read_mbox_data(mbox, q, pi, &ci, (void*)&msg->hdr, mbox_hdr_sz);
+		/* incomplete message or too large to describe */
+		if (msg->hdr.s.sz > (q_depth - mbox_hdr_sz) ||
+		    msg->hdr.s.sz > UINT16_MAX) {
+			ci = prev_ci;
+			break;
+		}
+
+		mbox_q_view(mbox, q, ci, msg->hdr.s.sz, msg);
+		ci = octep_ctrl_mbox_circq_inc(ci, msg->hdr.s.sz, q->sz);
+		q_depth -= (mbox_hdr_sz + msg->hdr.s.sz);
+	}
+
+	return (m) ? m : -EAGAIN;
+}
+
+int octep_ctrl_mbox_recv_commit(struct octep_ctrl_mbox *mbox,
+				struct octep_ctrl_mbox_msg *msgs,
+				int num)
+{
+	struct octep_ctrl_mbox_q *q;
+	uint32_t pi, ci, r_sz;
+	int m;
+
+	if (!mbox || !msgs)
+		return -EINVAL;
+
+	q = &mbox->h2fq;
+	r_sz = 0;
+	for (m = 0; m < num; m++)
+		r_sz += (mbox_hdr_sz + msgs[m].hdr.s.sz);
+
+	mbox_read_q_idx(mbox, q, &pi, &ci);
+	if (r_sz > octep_ctrl_mbox_circq_depth(pi, ci, q->sz))
+		return -EINVAL;
+
+	/* complete reads from message views before host can reuse the space */
+	cp_io_rmb();
+	mbox_write32(mbox, octep_ctrl_mbox_circq_inc(ci, r_sz, q->sz),
+		     q->hw_cons);
+
+	return num;
+}
+
+int octep_ctrl_mbox_send_reserve(struct octep_ctrl_mbox *mbox,
+				 struct octep_ctrl_mbox_msg *msg)
+{
+	struct octep_ctrl_mbox_q *q;
+	uint32_t pi, ci;
+
+	if (!mbox || !msg)
+		return -EINVAL;
+
+	if (mbox->access == OCTEP_CTRL_MBOX_ACCESS_FD)
+		return -ENOTSUP;
+
+	if (msg->hdr.s.sz > UINT16_MAX)
+		return -EMSGSIZE;
+
+	if (!is_host_ready(mbox))
+		return -EIO;
+
+	q = &mbox->f2hq;
+	mbox->f2hq_gen++;
+	mbox_read_q_idx(mbox, q, &pi, &ci);
+	if (octep_ctrl_mbox_circq_space(pi, ci, q->sz) <
+	    (msg->hdr.s.sz + mbox_hdr_sz))
+		return -EAGAIN;
+
+	mbox->rsv_gen = mbox->f2hq_gen;
+	mbox->rsv_pi = pi;
+	mbox->rsv_sz = msg->hdr.s.sz;
+	mbox_q_view(mbox, q, octep_ctrl_mbox_circq_inc(pi, mbox_hdr_sz, q->sz),
+		    msg->hdr.s.sz, msg);
+
+	return 0;
+}
+
+int octep_ctrl_mbox_send_commit(struct octep_ctrl_mbox *mbox,
+				struct octep_ctrl_mbox_msg *msg)
+{
+	struct octep_ctrl_mbox_q *q;
+	struct mbox_wr_batch wb;
+	uint32_t pi, ci, cp_sz;
+
+	if (!mbox || !msg)
+		return -EINVAL;
+
+	if (!is_host_ready(mbox))
+		return -EIO;
+
+	q = &mbox->f2hq;
+	/* space was overwritten or published by a send after reserve */
+	if (mbox->rsv_gen != mbox->f2hq_gen)
+		return -ESTALE;
+
+	if (msg->hdr.s.sz > mbox->rsv_sz)
+		return -EINVAL;
+
+	mbox->f2hq_gen++;
+	mbox_read_q_idx(mbox, q, &pi, &ci);
+	if (pi != mbox->rsv_pi)
+		return -ESTALE;
+
+	if (octep_ctrl_mbox_circq_space(pi, ci, q->sz) <
+	    (msg->hdr.s.sz + mbox_hdr_sz))
+		return -EINVAL;
+
+	wb.cnt = 0;
+	wb.len = 0;
+	write_mbox_data(mbox, &wb, q, &pi, ci, (void*)&msg->hdr, mbox_hdr_sz);
+	if (q->shadow && msg->hdr.s.sz) {
+		/* message was built in shadow, push it to bar memory */
+		cp_sz = cp_min((q->sz - pi), msg->hdr.s.sz);
+		mbox_write(mbox, &wb, mbox_q_ptr(mbox, q, pi), cp_sz,
+			   q->hw_q + pi);
+		if (msg->hdr.s.sz > cp_sz)
+			mbox_write(mbox, &wb, q->shadow,
+				   msg->hdr.s.sz - cp_sz, q->hw_q);
+	}
+	pi = octep_ctrl_mbox_circq_inc(pi, msg->hdr.s.sz, q->sz);
+	mbox_wr_batch_flush(mbox, &wb);
+	/* cp_write32 orders message data before producer index */
+	mbox_write32(mbox, pi, q->hw_prod);
+
+	return 0;
+}
+
 int octep_ctrl_mbox_uninit(struct octep_ctrl_mbox *mbox)
 {
 	if (!mbox)
@@ -332,18 +709,19 @@ int octep_ctrl_mbox_uninit(struct octep_ctrl_mbox *mbox)
 	if (!mbox->barmem)
 		return -EINVAL;
 
-	cp_write64_fd(OCTEP_CTRL_MBOX_STATUS_UNINIT,
-		      OCTEP_CTRL_MBOX_INFO_FW_STATUS(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write64_fd(0,
-		      OCTEP_CTRL_MBOX_INFO_MAGIC_NUM(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write64_fd(0,
-		      OCTEP_CTRL_MBOX_INFO_FW_VERSION(mbox->barmem),
-		      mbox->bar4_fd);
-	cp_write64_fd(0,
-		      OCTEP_CTRL_MBOX_INFO_FW_STATUS(mbox->barmem),
-		      mbox->bar4_fd);
+	mbox_write64(mbox, OCTEP_CTRL_MBOX_STATUS_UNINIT,
+		     OCTEP_CTRL_MBOX_INFO_FW_STATUS(mbox->barmem));
+	mbox_write64(mbox, 0, OCTEP_CTRL_MBOX_INFO_MAGIC_NUM(mbox->barmem));
+	mbox_write64(mbox, 0, OCTEP_CTRL_MBOX_INFO_FW_VERSION(mbox->barmem));
+	mbox_write64(mbox, 0, OCTEP_CTRL_MBOX_INFO_FW_STATUS(mbox->barmem));
+	if (mbox->h2fq.shadow) {
+		free(mbox->h2fq.shadow);
+		mbox->h2fq.shadow = NULL;
+	}
+	if (mbox->f2hq.shadow) {
+		free(mbox->f2hq.shadow);
+		mbox->f2hq.shadow = NULL;
+	}
 
 	return 0;
 }
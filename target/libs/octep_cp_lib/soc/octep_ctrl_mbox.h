@@ -36,12 +36,12 @@
  * |max msg size (4 bytes)                     |
  * |reserved (4 bytes)                         |
  * |===========================================|
- * |Host to Fw Queue ((total size-288/2) bytes)|
+ * |Host to Fw Queue (h2fq sz bytes)           |
  * |-------------------------------------------|
  * |                                           |
  * |===========================================|
  * |===========================================|
- * |Fw to Host Queue ((total size-288/2) bytes)|
+ * |Fw to Host Queue (total size-288-h2fq sz)  |
  * |-------------------------------------------|
  * |                                           |
  * |===========================================|
@@ -53,6 +53,36 @@
 
 #define OCTEP_CTRL_MBOX_MAGIC_NUMBER		0xdeaddeadbeefbeefull
 
+/* Size of mbox info in bytes */
+#define OCTEP_CTRL_MBOX_INFO_SZ				256
+/* Size of mbox host to fw queue info in bytes */
+#define OCTEP_CTRL_MBOX_H2FQ_INFO_SZ			16
+/* Size of mbox fw to host queue info in bytes */
+#define OCTEP_CTRL_MBOX_F2HQ_INFO_SZ			16
+
+#define OCTEP_CTRL_MBOX_TOTAL_INFO_SZ	(OCTEP_CTRL_MBOX_INFO_SZ + \
+					 OCTEP_CTRL_MBOX_H2FQ_INFO_SZ + \
+					 OCTEP_CTRL_MBOX_F2HQ_INFO_SZ)
+
+#define OCTEP_CTRL_MBOX_INFO_MAGIC_NUM(m)	((m) + 0)
+#define OCTEP_CTRL_MBOX_INFO_BARMEM_SZ(m)	((m) + 8)
+#define OCTEP_CTRL_MBOX_INFO_HOST_VERSION(m)	((m) + 16)
+#define OCTEP_CTRL_MBOX_INFO_HOST_STATUS(m)	((m) + 24)
+#define OCTEP_CTRL_MBOX_INFO_FW_VERSION(m)	((m) + 136)
+#define OCTEP_CTRL_MBOX_INFO_FW_STATUS(m)	((m) + 144)
+
+#define OCTEP_CTRL_MBOX_H2FQ_INFO(m)	((m) + OCTEP_CTRL_MBOX_INFO_SZ)
+#define OCTEP_CTRL_MBOX_H2FQ_PROD(m)	(OCTEP_CTRL_MBOX_H2FQ_INFO(m))
+#define OCTEP_CTRL_MBOX_H2FQ_CONS(m)	(OCTEP_CTRL_MBOX_H2FQ_INFO(m) + 4)
+#define OCTEP_CTRL_MBOX_H2FQ_SZ(m)	(OCTEP_CTRL_MBOX_H2FQ_INFO(m) + 8)
+
+#define OCTEP_CTRL_MBOX_F2HQ_INFO(m)	((m) + \
+					 OCTEP_CTRL_MBOX_INFO_SZ + \
+					 OCTEP_CTRL_MBOX_H2FQ_INFO_SZ)
+#define OCTEP_CTRL_MBOX_F2HQ_PROD(m)	(OCTEP_CTRL_MBOX_F2HQ_INFO(m))
+#define OCTEP_CTRL_MBOX_F2HQ_CONS(m)	((OCTEP_CTRL_MBOX_F2HQ_INFO(m)) + 4)
+#define OCTEP_CTRL_MBOX_F2HQ_SZ(m)	((OCTEP_CTRL_MBOX_F2HQ_INFO(m)) + 8)
+
 /* Valid request message */
 #define OCTEP_CTRL_MBOX_MSG_HDR_FLAG_REQ	BIT(0)
 /* Valid response message */
@@ -71,6 +101,16 @@ enum octep_ctrl_mbox_status {
 	OCTEP_CTRL_MBOX_STATUS_UNINIT
 };
 
+/* bar memory access method */
+enum octep_ctrl_mbox_access {
+	/* pread/pwrite on bar4_fd for every field */
+	OCTEP_CTRL_MBOX_ACCESS_FD = 0,
+	/* load/store on barmem_va mapped from bar4_fd */
+	OCTEP_CTRL_MBOX_ACCESS_MMAP,
+	/* pread/pwritev on bar4_fd, batched per send/receive call */
+	OCTEP_CTRL_MBOX_ACCESS_FD_VEC
+};
+
 /* mbox message */
 union octep_ctrl_mbox_msg_hdr {
 	uint64_t words[2];
@@ -122,6 +162,8 @@ struct octep_ctrl_mbox_q {
 	uint64_t hw_cons;
 	/* q base adddress in bar mem */
 	uint64_t hw_q;
+	/* local copy of queue, used for OCTEP_CTRL_MBOX_ACCESS_FD_VEC */
+	void *shadow;
 };
 
 struct octep_ctrl_mbox {
@@ -135,6 +177,8 @@ struct octep_ctrl_mbox {
 	uint32_t max_version;
 	/* size of bar memory */
 	uint32_t barmem_sz;
+	/* percentage of queue memory for host-to-fw queue, 0 for 50 */
+	uint8_t h2fq_pct;
 	/* pointer to BAR memory */
 	uint64_t barmem;
 	/* host-to-fw queue */
@@ -143,8 +187,28 @@ struct octep_ctrl_mbox {
 	struct octep_ctrl_mbox_q f2hq;
 	/* file descriptor for bar memory */
 	int bar4_fd;
+	/* bar memory access method */
+	enum octep_ctrl_mbox_access access;
+	/* mapped address of barmem, valid for OCTEP_CTRL_MBOX_ACCESS_MMAP */
+	void *barmem_va;
+	/* number of syscalls issued on bar4_fd */
+	uint64_t nsyscalls;
 	/* host version */
 	uint64_t host_version;
+	/* host status is ready, updated by octep_ctrl_mbox_check_host */
+	bool host_ready;
+	/* host-to-fw queue depth in bytes seen by last receive */
+	uint32_t h2fq_depth;
+	/* fw-to-host queue generation, advanced by every init, send, reserve
+	 * and commit
+	 */
+	uint32_t f2hq_gen;
+	/* generation, producer index and message size of outstanding
+	 * reservation, valid if rsv_gen is f2hq_gen
+	 */
+	uint32_t rsv_gen;
+	uint32_t rsv_pi;
+	uint32_t rsv_sz;
 };
 
 /* Initialize control mbox.
@@ -181,6 +245,77 @@ int octep_ctrl_mbox_recv(struct octep_ctrl_mbox *mbox,
 			 struct octep_ctrl_mbox_msg *msgs,
 			 int num);
 
+/* Peek at mbox messages without consuming them.
+ *
+ * Messages are not copied, sg_list of each message points at message data
+ * in queue memory. Data is described by 2 buffers if it rolls over the end
+ * of queue. Views stay valid until octep_ctrl_mbox_recv_commit().
+ * Not supported for OCTEP_CTRL_MBOX_ACCESS_FD.
+ *
+ * @param mbox: non-null pointer to struct octep_ctrl_mbox.
+ * @param msgs: Array of struct octep_ctrl_mbox_msg to be filled.
+ * @param num: Size of msg array.
+ *
+ * return value: number of messages available on success, -errno on failure.
+ */
+int octep_ctrl_mbox_recv_peek(struct octep_ctrl_mbox *mbox,
+			      struct octep_ctrl_mbox_msg *msgs,
+			      int num);
+
+/* Consume mbox messages returned by octep_ctrl_mbox_recv_peek().
+ *
+ * @param mbox: non-null pointer to struct octep_ctrl_mbox.
+ * @param msgs: First num messages returned by peek.
+ * @param num: Number of messages to consume.
+ *
+ * return value: number of messages consumed on success, -errno on failure.
+ */
+int octep_ctrl_mbox_recv_commit(struct octep_ctrl_mbox *mbox,
+				struct octep_ctrl_mbox_msg *msgs,
+				int num);
+
+/* Reserve queue space to build a message in place.
+ *
+ * Caller should fill msg.hdr.s.sz with size of message. sg_list is filled
+ * with at most 2 buffers pointing at reserved space in queue memory.
+ * Reservation is not visible to host until octep_ctrl_mbox_send_commit(),
+ * an uncommitted reservation is dropped by next send or reserve call.
+ * Callers serialize calls on a mailbox, but may send other messages between
+ * reserve and commit.
+ * Not supported for OCTEP_CTRL_MBOX_ACCESS_FD.
+ *
+ * @param mbox: non-null pointer to struct octep_ctrl_mbox.
+ * @param msg: non-null pointer to struct octep_ctrl_mbox_msg.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_ctrl_mbox_send_reserve(struct octep_ctrl_mbox *mbox,
+				 struct octep_ctrl_mbox_msg *msg);
+
+/* Publish message built in reserved queue space.
+ *
+ * msg.hdr.s.sz can be reduced from the reserved size.
+ *
+ * @param mbox: non-null pointer to struct octep_ctrl_mbox.
+ * @param msg: message passed to octep_ctrl_mbox_send_reserve().
+ *
+ * return value: 0 on success, -ESTALE if reservation was dropped by a send
+ *               or reserve after it, -errno on other failures.
+ */
+int octep_ctrl_mbox_send_commit(struct octep_ctrl_mbox *mbox,
+				struct octep_ctrl_mbox_msg *msg);
+
+/* Read host status and version and update host_ready.
+ *
+ * Messages are sent and received only while host_ready is set, this
+ * should be called periodically to detect host driver load and unload.
+ *
+ * @param mbox: non-null pointer to struct octep_ctrl_mbox.
+ *
+ * return value: 1 if host is ready, 0 if not, -errno on failure.
+ */
+int octep_ctrl_mbox_check_host(struct octep_ctrl_mbox *mbox);
+
 /* Uninitialize control mbox.
  *
  * @param mbox: non-null pointer to struct octep_ctrl_mbox.
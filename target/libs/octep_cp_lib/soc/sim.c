@@ -0,0 +1,422 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "octep_ctrl_mbox.h"
+
+#include "octep_cp_lib.h"
+#include "octep_cp_sim.h"
+#include "cp_compat.h"
+#include "cp_log.h"
+#include "cp_stats.h"
+#include "cp_lib.h"
+#include "cnxk.h"
+#include "sim.h"
+
+/* max length of a control fifo command */
+#define SIM_CTRL_LINE_MAX	128
+
+/* simulated pf */
+struct sim_pf {
+	/* fifo written on oei interrupts */
+	int oei_fd;
+	/* fw ready status */
+	int fw_ready;
+};
+
+/* simulated pem */
+struct sim_pem {
+	/* bar4 memory file is open */
+	bool valid;
+	/* link is down */
+	bool link_down;
+	struct sim_pf pfs[OCTEP_CP_PF_PER_DOM_MAX];
+};
+
+static struct sim_pem sim_pems[OCTEP_CP_DOM_MAX];
+/* protects sim_pems, hw ops are called with cnxk pem lock held */
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static char sim_dir[PATH_MAX];
+/* control fifo is read with a write end held open so that it does not
+ * report eof when there are no writers.
+ */
+static int ctrl_fd = -1;
+static int ctrl_wr_fd = -1;
+/* partial command read from control fifo */
+static char ctrl_buf[SIM_CTRL_LINE_MAX * 4];
+static int ctrl_len;
+
+static int sim_path(char *path, size_t sz, const char *fmt, int a, int b)
+{
+	char name[64];
+	int n;
+
+	snprintf(name, sizeof(name), fmt, a, b);
+	n = snprintf(path, sz, "%s/%s", sim_dir, name);
+
+	return (n < 0 || (size_t)n >= sz) ? -ENAMETOOLONG : 0;
+}
+
+/* Write pf information for host side tools, called with sim_lock held */
+static int write_pf_info(int pem_idx, int pf_idx)
+{
+	char path[PATH_MAX], bar4[PATH_MAX], oei[PATH_MAX];
+	struct sim_pf *pf;
+	uint32_t sz = 0;
+	off_t offset;
+	FILE *f;
+	int fd;
+
+	pf = &sim_pems[pem_idx].pfs[pf_idx];
+	offset = OCTEP_CP_SIM_MBOX_OFFSET(pf_idx);
+	if (sim_path(bar4, sizeof(bar4), OCTEP_CP_SIM_BAR4_FMT, pem_idx, 0) ||
+	    sim_path(oei, sizeof(oei), OCTEP_CP_SIM_OEI_FMT, pem_idx, pf_idx) ||
+	    sim_path(path, sizeof(path), OCTEP_CP_SIM_PF_FMT, pem_idx, pf_idx))
+		return -ENAMETOOLONG;
+
+	/* mbox is initialized before oei fd is opened */
+	fd = open(bar4, O_RDONLY);
+	if (fd >= 0) {
+		if (pread(fd, &sz, sizeof(sz),
+			  OCTEP_CTRL_MBOX_INFO_BARMEM_SZ(offset)) != sizeof(sz))
+			sz = 0;
+		close(fd);
+	}
+
+	f = fopen(path, "w");
+	if (!f) {
+		CP_LIB_LOG(ERR, SOC, "Error creating %s (%d)\n", path, errno);
+		return -errno;
+	}
+	fprintf(f, "%s %lu %u %d %s %d\n", bar4, (unsigned long)offset, sz,
+		getpid(), oei, pf->fw_ready);
+	fclose(f);
+
+	return 0;
+}
+
+static int sim_check_pem(int pem_idx, int wait)
+{
+	bool down;
+
+	pthread_mutex_lock(&sim_lock);
+	down = sim_pems[pem_idx].link_down;
+	pthread_mutex_unlock(&sim_lock);
+	if (down) {
+		/* caller polls link without waiting */
+		if (wait)
+			CP_LIB_LOG(ERR, SOC, "pem[%d] unavailable\n", pem_idx);
+		return -EAGAIN;
+	}
+
+	return 0;
+}
+
+static int sim_open_perst_fd(int pem_idx)
+{
+	/* perst is signalled on control fifo */
+	return 0;
+}
+
+static int sim_open_bar4(int pem_idx)
+{
+	char path[PATH_MAX];
+	int fd;
+
+	if (sim_path(path, sizeof(path), OCTEP_CP_SIM_BAR4_FMT, pem_idx, 0))
+		return -ENAMETOOLONG;
+
+	fd = open(path, O_RDWR | O_CREAT, 0660);
+	if (fd < 0) {
+		CP_LIB_LOG(ERR, SOC, "Error opening %s (%d)\n", path, errno);
+		return -errno;
+	}
+	if (ftruncate(fd, OCTEP_CP_SIM_BAR4_SZ)) {
+		CP_LIB_LOG(ERR, SOC, "Error sizing %s (%d)\n", path, errno);
+		close(fd);
+		return -errno;
+	}
+
+	pthread_mutex_lock(&sim_lock);
+	sim_pems[pem_idx].valid = true;
+	pthread_mutex_unlock(&sim_lock);
+
+	return fd;
+}
+
+static int sim_open_oei_fd(int pem_idx, int pf_idx)
+{
+	char path[PATH_MAX];
+	int fd;
+
+	if (sim_path(path, sizeof(path), OCTEP_CP_SIM_OEI_FMT, pem_idx, pf_idx))
+		return -ENAMETOOLONG;
+
+	/* fifo is kept across reinit of pf, so that host side keeps it open */
+	if (mkfifo(path, 0660) && errno != EEXIST) {
+		CP_LIB_LOG(ERR, SOC, "Error creating %s (%d)\n", path, errno);
+		return -errno;
+	}
+	/* read-write open of a fifo does not wait for a reader */
+	fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		CP_LIB_LOG(ERR, SOC, "Error opening %s (%d)\n", path, errno);
+		return -errno;
+	}
+
+	pthread_mutex_lock(&sim_lock);
+	sim_pems[pem_idx].pfs[pf_idx].oei_fd = fd;
+	sim_pems[pem_idx].pfs[pf_idx].fw_ready = 0;
+	write_pf_info(pem_idx, pf_idx);
+	pthread_mutex_unlock(&sim_lock);
+
+	return fd;
+}
+
+static int sim_set_fw_ready(int pem_idx, int pf_idx, int status)
+{
+	int err;
+
+	pthread_mutex_lock(&sim_lock);
+	sim_pems[pem_idx].pfs[pf_idx].fw_ready = status;
+	err = write_pf_info(pem_idx, pf_idx);
+	pthread_mutex_unlock(&sim_lock);
+	CP_LIB_LOG(INFO, SOC, "pem[%d] pf[%d] fw ready %d\n",
+		   pem_idx, pf_idx, status);
+
+	return err;
+}
+
+static const struct cnxk_hw_ops sim_hw_ops = {
+	.check_pem = sim_check_pem,
+	.open_perst_fd = sim_open_perst_fd,
+	.open_bar4 = sim_open_bar4,
+	.open_oei_fd = sim_open_oei_fd,
+	.set_fw_ready = sim_set_fw_ready,
+};
+
+/* Parse a control fifo command.
+ *
+ * return value: 1 if info is filled, 0 if command has no event,
+ *               -errno on invalid command.
+ */
+static int parse_ctrl(char *line, struct octep_cp_event_info *info)
+{
+	unsigned long long mask[2] = { 0 };
+	struct octep_cp_stats *stats;
+	char cmd[16], arg[16];
+	int n, pem, pf;
+	bool valid;
+
+	n = sscanf(line, "%15s %d", cmd, &pem);
+	if (n < 2 || pem < 0 || pem >= OCTEP_CP_DOM_MAX)
+		return -EINVAL;
+
+	pthread_mutex_lock(&sim_lock);
+	valid = sim_pems[pem].valid;
+	pthread_mutex_unlock(&sim_lock);
+
+	if (!strcmp(cmd, "link")) {
+		if (sscanf(line, "%*s %*d %15s", arg) != 1)
+			return -EINVAL;
+
+		pthread_mutex_lock(&sim_lock);
+		sim_pems[pem].link_down = !strcmp(arg, "down");
+		pthread_mutex_unlock(&sim_lock);
+		CP_LIB_LOG(INFO, SOC, "pem[%d] link %s\n", pem, arg);
+		return 0;
+	}
+	if (strcmp(cmd, "perst") && strcmp(cmd, "flr"))
+		return -EINVAL;
+	/* events are reported only for initialized pem's */
+	if (!valid)
+		return -ENODEV;
+
+	if (!strcmp(cmd, "perst")) {
+		stats = cp_stats_get(pem, -1, -1);
+		if (stats)
+			CP_STATS_INC(stats, perst);
+		info->e = OCTEP_CP_EVENT_TYPE_PERST;
+		info->u.perst.dom_idx = pem;
+		return 1;
+	}
+	n = sscanf(line, "%*s %*d %d %llx %llx", &pf, &mask[0], &mask[1]);
+	if (n < 1 || pf < 0 || pf >= OCTEP_CP_PF_PER_DOM_MAX)
+		return -EINVAL;
+
+	info->e = OCTEP_CP_EVENT_TYPE_FLR;
+	info->u.flr.dom_idx = pem;
+	info->u.flr.pf_idx = pf;
+	info->u.flr.vf_mask[0] = mask[0];
+	info->u.flr.vf_mask[1] = mask[1];
+
+	return 1;
+}
+
+/* Read commands from control fifo, lines beyond num are left in buffer
+ * for next call.
+ */
+static int recv_ctrl(struct octep_cp_event_info *info, int num)
+{
+	int n_ev = 0, ret, len;
+	char *line, *end;
+	ssize_t n;
+
+	if (ctrl_fd < 0)
+		return 0;
+
+	n = read(ctrl_fd, ctrl_buf + ctrl_len,
+		 sizeof(ctrl_buf) - 1 - ctrl_len);
+	if (n > 0)
+		ctrl_len += n;
+
+	line = ctrl_buf;
+	while (n_ev < num) {
+		end = memchr(line, '\n', ctrl_len - (line - ctrl_buf));
+		if (!end)
+			break;
+
+		*end = '\0';
+		ret = parse_ctrl(line, &info[n_ev]);
+		if (ret < 0)
+			CP_LIB_LOG(ERR, SOC, "Invalid sim command \"%s\" (%d)\n",
+				   line, ret);
+		else
+			n_ev += ret;
+		line = end + 1;
+	}
+
+	len = ctrl_len - (line - ctrl_buf);
+	/* drop line which does not fit in buffer */
+	if (line == ctrl_buf && len == sizeof(ctrl_buf) - 1) {
+		CP_LIB_LOG(ERR, SOC, "sim command too long, dropped\n");
+		len = 0;
+	}
+	memmove(ctrl_buf, line, len);
+	ctrl_len = len;
+
+	return n_ev;
+}
+
+int sim_init(struct octep_cp_lib_cfg *cfg)
+{
+	char path[PATH_MAX];
+	const char *dir;
+	int err;
+
+	CP_LIB_LOG(INFO, SOC, "sim init\n");
+	dir = getenv(OCTEP_CP_SIM_DIR_ENV);
+	if (!dir || !dir[0])
+		dir = OCTEP_CP_SIM_DIR_DEF;
+	if (strlen(dir) >= sizeof(sim_dir))
+		return -ENAMETOOLONG;
+	strcpy(sim_dir, dir);
+
+	if (mkdir(sim_dir, 0770) && errno != EEXIST) {
+		CP_LIB_LOG(ERR, SOC, "Error creating %s (%d)\n", sim_dir, errno);
+		return -errno;
+	}
+
+	if (sim_path(path, sizeof(path), OCTEP_CP_SIM_CTRL, 0, 0))
+		return -ENAMETOOLONG;
+	if (mkfifo(path, 0660) && errno != EEXIST) {
+		CP_LIB_LOG(ERR, SOC, "Error creating %s (%d)\n", path, errno);
+		return -errno;
+	}
+	ctrl_fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (ctrl_fd < 0) {
+		err = -errno;
+		goto ctrl_fail;
+	}
+	ctrl_wr_fd = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+	if (ctrl_wr_fd < 0) {
+		err = -errno;
+		goto ctrl_fail;
+	}
+	ctrl_len = 0;
+
+	memset(sim_pems, 0, sizeof(sim_pems));
+	cnxk_set_hw_ops(&sim_hw_ops);
+	err = cnxk_init(cfg);
+	if (err) {
+		cnxk_set_hw_ops(NULL);
+		goto ctrl_fail;
+	}
+	CP_LIB_LOG(INFO, SOC, "sim files in %s\n", sim_dir);
+
+	return 0;
+
+ctrl_fail:
+	CP_LIB_LOG(ERR, SOC, "sim init failed (%d)\n", err);
+	if (ctrl_wr_fd >= 0)
+		close(ctrl_wr_fd);
+	if (ctrl_fd >= 0)
+		close(ctrl_fd);
+	ctrl_wr_fd = -1;
+	ctrl_fd = -1;
+
+	return err;
+}
+
+int sim_recv_event(struct octep_cp_event_info *info, int num)
+{
+	int n, ret;
+
+	n = recv_ctrl(info, num);
+	if (n >= num)
+		return n;
+
+	ret = cnxk_recv_event(&info[n], num - n);
+	if (ret < 0)
+		return (n) ? n : ret;
+
+	return n + ret;
+}
+
+int sim_get_event_fds(int *fds, int num)
+{
+	int n;
+
+	if (num < 1)
+		return 0;
+
+	fds[0] = ctrl_fd;
+	n = cnxk_get_event_fds(&fds[1], num - 1);
+	if (n < 0)
+		return n;
+
+	return n + 1;
+}
+
+int sim_uninit()
+{
+	char path[PATH_MAX];
+
+	CP_LIB_LOG(INFO, SOC, "sim uninit\n");
+	cnxk_uninit();
+	cnxk_set_hw_ops(NULL);
+
+	if (ctrl_wr_fd >= 0)
+		close(ctrl_wr_fd);
+	if (ctrl_fd >= 0)
+		close(ctrl_fd);
+	ctrl_wr_fd = -1;
+	ctrl_fd = -1;
+	if (!sim_path(path, sizeof(path), OCTEP_CP_SIM_CTRL, 0, 0))
+		unlink(path);
+
+	return 0;
+}
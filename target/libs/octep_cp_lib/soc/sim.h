@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __SIM_H__
+#define __SIM_H__
+
+/* Simulated soc.
+ *
+ * Uses cnxk implementation with pem bar4 backed by files, oei interrupts
+ * written to a fifo per pf and host events injected through a control fifo,
+ * see octep_cp_sim.h. Only functions which differ from cnxk are declared
+ * here.
+ */
+
+/* Initialize simulated soc.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int sim_init(struct octep_cp_lib_cfg *cfg);
+
+/* Receive events injected through control fifo and cnxk events.
+ *
+ * @param info: [OUT] Non-Null pointer to event info array.
+ * @param num: [IN] Number of event info buffers.
+ *
+ * return value: number of events received on success, -errno on failure.
+ */
+int sim_recv_event(struct octep_cp_event_info *info, int num);
+
+/* Get fds which become readable when events are pending.
+ *
+ * @param fds: [OUT] Non-Null pointer to fd array.
+ * @param num: [IN] Number of elements in @fds.
+ *
+ * return value: number of fds on success, -errno on failure.
+ */
+int sim_get_event_fds(int *fds, int num);
+
+/* UnInitialize simulated soc.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int sim_uninit();
+
+#endif /* __SIM_H__ */
@@ -8,7 +8,6 @@
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
-#include <dirent.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -17,6 +16,9 @@
 #include "cp_lib.h"
 #include "octep_ctrl_mbox.h"
 #include "cnxk.h"
+#include "sim.h"
+#include "discover.h"
+#include "octep_cp_sim.h"
 
 #ifndef BIT_ULL
 #define BIT_ULL(nr) (1ULL << (nr))
@@ -97,133 +99,22 @@ static const struct model_db {
 
 static struct octep_cp_soc_model model;
 
-#define PCI_VENDOR_ID_CAVIUM		0x177D
-#define PCI_DEVID_CNXK_RVU_PF		0xA063
-#define PCI_DEVID_CNXK_RVU_VF		0xA064
-#define PCI_DEVID_CNXK_RVU_AF		0xA065
-#define PCI_DEVID_CN10K_RVU_CPT_PF	0xA0F2
-#define PCI_DEVID_CN10K_RVU_CPT_VF	0xA0F3
-#define PCI_DEVID_CNXK_RVU_AF_VF	0xA0f8
-#define PCI_DEVID_CNXK_RVU_SSO_TIM_PF	0xA0F9
-#define PCI_DEVID_CNXK_RVU_SSO_TIM_VF	0xA0FA
-#define PCI_DEVID_CNXK_RVU_NPA_PF	0xA0FB
-#define PCI_DEVID_CNXK_RVU_NPA_VF	0xA0FC
-
 /* Detected SOC */
 enum cp_lib_soc soc;
 
-/* Detect if RVU device */
-static bool is_rvu_device(unsigned long val)
-{
-	return (val == PCI_DEVID_CNXK_RVU_PF || val == PCI_DEVID_CNXK_RVU_VF ||
-		val == PCI_DEVID_CNXK_RVU_AF ||
-		val == PCI_DEVID_CNXK_RVU_AF_VF ||
-		val == PCI_DEVID_CNXK_RVU_NPA_PF ||
-		val == PCI_DEVID_CNXK_RVU_NPA_VF ||
-		val == PCI_DEVID_CNXK_RVU_SSO_TIM_PF ||
-		val == PCI_DEVID_CNXK_RVU_SSO_TIM_VF ||
-		val == PCI_DEVID_CN10K_RVU_CPT_PF ||
-		val == PCI_DEVID_CN10K_RVU_CPT_VF);
-}
-
-/* parse a sysfs (or other) file containing one integer value */
-static int parse_sysfs_value(const char *filename, unsigned long *val)
-{
-	FILE *f;
-	char buf[BUFSIZ];
-	char *end = NULL;
-
-	if ((f = fopen(filename, "r")) == NULL) {
-		CP_LIB_LOG(ERR, SOC, "Cannot open sysfs value %s\n", filename);
-		return -EIO;
-	}
-
-	if (fgets(buf, sizeof(buf), f) == NULL) {
-		CP_LIB_LOG(ERR, SOC, "Cannot read sysfs value %s\n", filename);
-		fclose(f);
-		return -EIO;
-	}
-	*val = strtoul(buf, &end, 0);
-	if ((buf[0] == '\0') || (end == NULL) || (*end != '\n')) {
-		CP_LIB_LOG(ERR, SOC, "Cannot parse sysfs value %s\n", filename);
-		fclose(f);
-		return -EIO;
-	}
-	fclose(f);
-	return 0;
-}
-
-static int rvu_device_lookup(const char *dirname, uint32_t *part,
-			     uint32_t *pass)
-{
-	char filename[PATH_MAX];
-	unsigned long val;
-
-	/* Check if vendor id is cavium */
-	snprintf(filename, sizeof(filename), "%s/vendor", dirname);
-	if (parse_sysfs_value(filename, &val) < 0)
-		goto error;
-
-	if (val != PCI_VENDOR_ID_CAVIUM)
-		goto error;
-
-	/* Get device id  */
-	snprintf(filename, sizeof(filename), "%s/device", dirname);
-	if (parse_sysfs_value(filename, &val) < 0)
-		goto error;
-
-	/* Check if device ID belongs to any RVU device */
-	if (!is_rvu_device(val))
-		goto error;
-
-	/* Get subsystem_device id */
-	snprintf(filename, sizeof(filename), "%s/subsystem_device", dirname);
-	if (parse_sysfs_value(filename, &val) < 0)
-		goto error;
-
-	*part = val >> MODEL_CN10K_PART_SHIFT;
-
-	/* Get revision for pass value*/
-	snprintf(filename, sizeof(filename), "%s/revision", dirname);
-	if (parse_sysfs_value(filename, &val) < 0)
-		goto error;
-
-	*pass = val & MODEL_CN10K_PASS_MASK;
-
-	return 0;
-error:
-	return -EINVAL;
-}
-
-/* Scans through all PCI devices, detects RVU device and returns
- * subsystem_device
- */
+/* Get part and pass of rvu device */
 static int cn10k_part_pass_get(uint32_t *part, uint32_t *pass)
 {
-#define SYSFS_PCI_DEVICES "/sys/bus/pci/devices"
-	char dirname[4064];
-	struct dirent *e;
-	DIR *dir;
-
-	dir = opendir(SYSFS_PCI_DEVICES);
-	if (dir == NULL) {
-		CP_LIB_LOG(ERR, SOC, "opendir failed: %s\n", strerror(errno));
-		return -errno;
-	}
-
-	while ((e = readdir(dir)) != NULL) {
-		if (e->d_name[0] == '.')
-			continue;
+	uint32_t subsys_dev, rev;
+	int err;
 
-		snprintf(dirname, sizeof(dirname), "%s/%s", SYSFS_PCI_DEVICES,
-			 e->d_name);
+	err = discover_rvu(&subsys_dev, &rev);
+	if (err)
+		return err;
 
-		/* Lookup for rvu device and get part pass information */
-		if (!rvu_device_lookup(dirname, part, pass))
-			break;
-	}
+	*part = subsys_dev >> MODEL_CN10K_PART_SHIFT;
+	*pass = rev & MODEL_CN10K_PASS_MASK;
 
-	closedir(dir);
 	return 0;
 }
 
@@ -331,9 +222,18 @@ static struct cp_lib_soc_ops ops[CP_LIB_SOC_MAX] = {
 		cnxk_get_info,
 		cnxk_send_msg_resp,
 		cnxk_send_notification,
+		cnxk_send_notification_fanout,
 		cnxk_recv_msg,
+		cnxk_recv_msg_peek,
+		cnxk_recv_msg_commit,
+		cnxk_send_msg_resp_reserve,
+		cnxk_send_msg_resp_commit,
 		cnxk_send_event,
+		cnxk_send_events,
 		cnxk_recv_event,
+		cnxk_get_event_fds,
+		cnxk_get_active_pfs,
+		cnxk_flush_intrs,
 		cnxk_uninit_pem,
 		cnxk_uninit
 	},
@@ -344,28 +244,88 @@ static struct cp_lib_soc_ops ops[CP_LIB_SOC_MAX] = {
 		cnxk_get_info,
 		cnxk_send_msg_resp,
 		cnxk_send_notification,
+		cnxk_send_notification_fanout,
 		cnxk_recv_msg,
+		cnxk_recv_msg_peek,
+		cnxk_recv_msg_commit,
+		cnxk_send_msg_resp_reserve,
+		cnxk_send_msg_resp_commit,
 		cnxk_send_event,
+		cnxk_send_events,
 		cnxk_recv_event,
+		cnxk_get_event_fds,
+		cnxk_get_active_pfs,
+		cnxk_flush_intrs,
 		cnxk_uninit_pem,
 		cnxk_uninit
+	},
+	/* sim */
+	{
+		sim_init,
+		cnxk_init_pem,
+		cnxk_get_info,
+		cnxk_send_msg_resp,
+		cnxk_send_notification,
+		cnxk_send_notification_fanout,
+		cnxk_recv_msg,
+		cnxk_recv_msg_peek,
+		cnxk_recv_msg_commit,
+		cnxk_send_msg_resp_reserve,
+		cnxk_send_msg_resp_commit,
+		cnxk_send_event,
+		cnxk_send_events,
+		sim_recv_event,
+		sim_get_event_fds,
+		cnxk_get_active_pfs,
+		cnxk_flush_intrs,
+		cnxk_uninit_pem,
+		sim_uninit
 	}
 };
 
-int soc_get_ops(struct cp_lib_soc_ops **p_ops)
+/* Get soc implementation requested in environment or configuration */
+static const char *requested_soc(struct octep_cp_lib_cfg *cfg)
+{
+	const char *name;
+
+	name = getenv(OCTEP_CP_SOC_ENV);
+	if (name && name[0])
+		return name;
+
+	return (cfg && cfg->soc[0]) ? cfg->soc : NULL;
+}
+
+int soc_get_ops(struct octep_cp_lib_cfg *cfg, struct cp_lib_soc_ops **p_ops)
 {
+	const char *name;
 	int err;
 
+	if (!p_ops) {
+		CP_LIB_LOG(INFO, SOC, "Invalid param: p_ops:%p\n", p_ops);
+		return -EINVAL;
+	}
+
+	name = requested_soc(cfg);
+	if (name && !strcmp(name, OCTEP_CP_SIM_NAME)) {
+		soc = CP_LIB_SOC_SIM;
+		model.flag = 0;
+		strncpy(model.name, OCTEP_CP_SIM_NAME,
+			OCTEP_CP_SOC_MODEL_STR_LEN_MAX - 1);
+		CP_LIB_LOG(INFO, SOC, "Model: %s\n", model.name);
+		*p_ops = &ops[soc];
+		return 0;
+	}
+	if (name) {
+		CP_LIB_LOG(ERR, SOC, "Unknown soc %s\n", name);
+		return -EINVAL;
+	}
+
 	err = detect_soc();
 	if (err)
 		return err;
 
 	soc = (model.flag & (OCTEP_CP_SOC_MODEL_CN10K)) ?
 	       CP_LIB_SOC_CNXK : CP_LIB_SOC_OTX2;
-	if (!p_ops) {
-		CP_LIB_LOG(INFO, SOC, "Invalid param: p_ops:%p\n", p_ops);
-		return -EINVAL;
-	}
 	*p_ops = &ops[soc];
 
 	return 0;
@@ -0,0 +1,532 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright (c) 2022 Marvell.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "cp_compat.h"
+#include "octep_ctrl_mbox.h"
+#include "octep_host_emu.h"
+
+#define NSEC_PER_MSEC		1000000ULL
+#define NSEC_PER_SEC		1000000000ULL
+/* time between checks while waiting for fw or a response */
+#define HOST_EMU_WAIT_NS	10000
+
+/* mailbox memory offsets are relative to start of mailbox */
+#define HOST_EMU_MBOX		0
+
+static const uint32_t mbox_hdr_sz = sizeof(union octep_ctrl_mbox_msg_hdr);
+
+/* outstanding request */
+struct host_emu_req {
+	/* CLOCK_MONOTONIC nsecs at send */
+	uint64_t send_ns;
+	uint16_t msg_id;
+	int vf_idx;
+	bool busy;
+};
+
+/* queue in mailbox memory */
+struct host_emu_q {
+	volatile uint8_t *prod;
+	volatile uint8_t *cons;
+	volatile uint8_t *q;
+	uint32_t sz;
+};
+
+struct octep_host_emu {
+	struct octep_host_emu_cfg cfg;
+	int fd;
+	/* oei fifo, -1 if not used */
+	int oei_fd;
+	/* page aligned mapping of mailbox memory */
+	void *map;
+	size_t map_sz;
+	/* mailbox memory */
+	volatile uint8_t *mem;
+	/* fw status is ready and queues are valid */
+	bool connected;
+	struct host_emu_q h2fq;
+	struct host_emu_q f2hq;
+	/* outstanding requests indexed by msg_id & pending_mask */
+	struct host_emu_req *reqs;
+	uint32_t pending_mask;
+	uint32_t npending;
+	uint16_t next_msg_id;
+	struct octep_host_emu_stats stats;
+	/* receive buffer */
+	union octep_ctrl_net_max_data rx_buf;
+};
+
+static uint64_t get_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+static void wait_ns(uint64_t ns)
+{
+	struct timespec ts = { 0, ns };
+
+	nanosleep(&ts, NULL);
+}
+
+static inline volatile void *mbox_ptr(struct octep_host_emu *emu,
+				      uint64_t off)
+{
+	return emu->mem + off;
+}
+
+static inline uint32_t q_depth(uint32_t pi, uint32_t ci, uint32_t sz)
+{
+	return (pi >= ci) ? (pi - ci) : (sz - ci + pi);
+}
+
+static inline uint32_t q_space(uint32_t pi, uint32_t ci, uint32_t sz)
+{
+	/* one byte is kept unused, see octep_ctrl_mbox.c */
+	return sz - q_depth(pi, ci, sz) - 1;
+}
+
+/* Write sz bytes at queue offset off, return offset after data */
+static uint32_t q_write(struct host_emu_q *q, uint32_t off, const void *buf,
+			uint32_t sz)
+{
+	uint32_t cp_sz;
+
+	cp_sz = cp_min((q->sz - off), sz);
+	cp_memcpy_toio(q->q + off, buf, cp_sz);
+	if (sz > cp_sz)
+		cp_memcpy_toio(q->q, (const uint8_t *)buf + cp_sz, sz - cp_sz);
+
+	return (off + sz) % q->sz;
+}
+
+/* Read sz bytes at queue offset off, return offset after data */
+static uint32_t q_read(struct host_emu_q *q, uint32_t off, void *buf,
+		       uint32_t sz)
+{
+	uint32_t cp_sz;
+
+	cp_sz = cp_min((q->sz - off), sz);
+	cp_memcpy_fromio(buf, q->q + off, cp_sz);
+	if (sz > cp_sz)
+		cp_memcpy_fromio((uint8_t *)buf + cp_sz, q->q, sz - cp_sz);
+
+	return (off + sz) % q->sz;
+}
+
+static bool is_fw_ready(struct octep_host_emu *emu)
+{
+	uint64_t m = HOST_EMU_MBOX;
+
+	return (cp_read64(mbox_ptr(emu, OCTEP_CTRL_MBOX_INFO_MAGIC_NUM(m))) ==
+		OCTEP_CTRL_MBOX_MAGIC_NUMBER &&
+		cp_read64(mbox_ptr(emu, OCTEP_CTRL_MBOX_INFO_FW_STATUS(m))) ==
+		OCTEP_CTRL_MBOX_STATUS_READY);
+}
+
+/* Check that fw has not reinitialized the mailbox since connect */
+static int check_connected(struct octep_host_emu *emu)
+{
+	if (emu->connected && !is_fw_ready(emu))
+		emu->connected = false;
+
+	return (emu->connected) ? 0 : -ENOTCONN;
+}
+
+static void drop_pending(struct octep_host_emu *emu)
+{
+	memset(emu->reqs, 0,
+	       sizeof(struct host_emu_req) * (emu->pending_mask + 1));
+	emu->npending = 0;
+}
+
+/* Read oei interrupts written to fifo */
+static void recv_oei(struct octep_host_emu *emu, bool count)
+{
+	uint64_t buf[64];
+	ssize_t n;
+
+	if (emu->oei_fd < 0)
+		return;
+
+	while ((n = read(emu->oei_fd, buf, sizeof(buf))) > 0)
+		if (count)
+			emu->stats.rx_oei += n / sizeof(buf[0]);
+}
+
+struct octep_host_emu *octep_host_emu_open(const struct octep_host_emu_cfg *cfg)
+{
+	struct octep_host_emu *emu;
+	uint32_t max_pending;
+	long pg_sz;
+	off_t pg_off;
+
+	if (!cfg || !cfg->path || cfg->sz <= OCTEP_CTRL_MBOX_TOTAL_INFO_SZ ||
+	    cfg->offset < 0 || cfg->max_pending > OCTEP_HOST_EMU_PENDING_MAX)
+		return NULL;
+
+	emu = calloc(1, sizeof(struct octep_host_emu));
+	if (!emu)
+		return NULL;
+
+	emu->cfg = *cfg;
+	/* power of 2 so that msg_id wrap around keeps slots consistent */
+	max_pending = (cfg->max_pending) ? cfg->max_pending :
+					   OCTEP_HOST_EMU_PENDING_DEF;
+	emu->pending_mask = 1;
+	while (emu->pending_mask < max_pending)
+		emu->pending_mask <<= 1;
+	emu->reqs = calloc(emu->pending_mask, sizeof(struct host_emu_req));
+	emu->pending_mask--;
+	if (!emu->reqs)
+		goto free_emu;
+
+	emu->fd = open(cfg->path, O_RDWR);
+	if (emu->fd < 0)
+		goto free_reqs;
+
+	pg_sz = sysconf(_SC_PAGESIZE);
+	pg_off = cfg->offset % pg_sz;
+	emu->map_sz = cfg->sz + pg_off;
+	emu->map = mmap(NULL, emu->map_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+			emu->fd, cfg->offset - pg_off);
+	if (emu->map == MAP_FAILED)
+		goto close_fd;
+
+	emu->mem = (volatile uint8_t *)emu->map + pg_off;
+
+	emu->oei_fd = -1;
+	if (cfg->oei_path) {
+		emu->oei_fd = open(cfg->oei_path, O_RDONLY | O_NONBLOCK);
+		if (emu->oei_fd < 0)
+			goto unmap;
+	}
+
+	return emu;
+
+unmap:
+	munmap(emu->map, emu->map_sz);
+close_fd:
+	close(emu->fd);
+free_reqs:
+	free(emu->reqs);
+free_emu:
+	free(emu);
+	return NULL;
+}
+
+int octep_host_emu_connect(struct octep_host_emu *emu, uint32_t timeout_ms)
+{
+	uint64_t m = HOST_EMU_MBOX;
+	uint32_t barmem_sz, h2fq_sz, f2hq_sz;
+	uint64_t end_ns;
+
+	if (!emu)
+		return -EINVAL;
+
+	emu->connected = false;
+	end_ns = get_ns() + (timeout_ms * NSEC_PER_MSEC);
+	while (!is_fw_ready(emu)) {
+		if (get_ns() >= end_ns)
+			return -ETIMEDOUT;
+		wait_ns(HOST_EMU_WAIT_NS);
+	}
+
+	barmem_sz = cp_read32(mbox_ptr(emu, OCTEP_CTRL_MBOX_INFO_BARMEM_SZ(m)));
+	h2fq_sz = cp_read32(mbox_ptr(emu, OCTEP_CTRL_MBOX_H2FQ_SZ(m)));
+	f2hq_sz = cp_read32(mbox_ptr(emu, OCTEP_CTRL_MBOX_F2HQ_SZ(m)));
+	if (barmem_sz > emu->cfg.sz || !h2fq_sz || !f2hq_sz ||
+	    ((uint64_t)OCTEP_CTRL_MBOX_TOTAL_INFO_SZ + h2fq_sz + f2hq_sz) >
+	    barmem_sz)
+		return -EINVAL;
+
+	emu->h2fq.prod = mbox_ptr(emu, OCTEP_CTRL_MBOX_H2FQ_PROD(m));
+	emu->h2fq.cons = mbox_ptr(emu, OCTEP_CTRL_MBOX_H2FQ_CONS(m));
+	emu->h2fq.q = mbox_ptr(emu, OCTEP_CTRL_MBOX_TOTAL_INFO_SZ);
+	emu->h2fq.sz = h2fq_sz;
+	/* f2hq immediately follows h2fq */
+	emu->f2hq.prod = mbox_ptr(emu, OCTEP_CTRL_MBOX_F2HQ_PROD(m));
+	emu->f2hq.cons = mbox_ptr(emu, OCTEP_CTRL_MBOX_F2HQ_CONS(m));
+	emu->f2hq.q = emu->h2fq.q + h2fq_sz;
+	emu->f2hq.sz = f2hq_sz;
+	drop_pending(emu);
+	/* interrupts raised before connect are not counted */
+	recv_oei(emu, false);
+
+	cp_write64(emu->cfg.version,
+		   mbox_ptr(emu, OCTEP_CTRL_MBOX_INFO_HOST_VERSION(m)));
+	/* cp_write64 orders version before status */
+	cp_write64(OCTEP_CTRL_MBOX_STATUS_READY,
+		   mbox_ptr(emu, OCTEP_CTRL_MBOX_INFO_HOST_STATUS(m)));
+	emu->connected = true;
+
+	return 0;
+}
+
+int octep_host_emu_disconnect(struct octep_host_emu *emu)
+{
+	uint64_t m = HOST_EMU_MBOX;
+
+	if (!emu)
+		return -EINVAL;
+
+	cp_write64(OCTEP_CTRL_MBOX_STATUS_UNINIT,
+		   mbox_ptr(emu, OCTEP_CTRL_MBOX_INFO_HOST_STATUS(m)));
+	emu->connected = false;
+	drop_pending(emu);
+
+	return 0;
+}
+
+/* Reserve a request slot and msg_id */
+static struct host_emu_req *alloc_req(struct octep_host_emu *emu)
+{
+	struct host_emu_req *r;
+	uint32_t i;
+
+	if (emu->npending > emu->pending_mask)
+		return NULL;
+
+	/* responses may arrive out of order, skip busy slots */
+	for (i = 0; i <= emu->pending_mask; i++) {
+		r = &emu->reqs[(emu->next_msg_id + i) & emu->pending_mask];
+		if (!r->busy) {
+			r->msg_id = emu->next_msg_id + i;
+			emu->next_msg_id = r->msg_id + 1;
+			return r;
+		}
+	}
+
+	return NULL;
+}
+
+int octep_host_emu_send(struct octep_host_emu *emu, int vf_idx,
+			const struct octep_ctrl_net_h2f_req *req, uint32_t sz,
+			uint16_t *msg_id)
+{
+	union octep_ctrl_mbox_msg_hdr hdr = { 0 };
+	struct host_emu_q *q;
+	struct host_emu_req *r;
+	uint32_t pi, ci;
+	int err;
+
+	if (!emu || !req || !sz || vf_idx < OCTEP_HOST_EMU_PF ||
+	    vf_idx > UINT16_MAX)
+		return -EINVAL;
+
+	err = check_connected(emu);
+	if (err)
+		return err;
+
+	q = &emu->h2fq;
+	pi = cp_read32(q->prod);
+	ci = cp_read32(q->cons);
+	if (pi >= q->sz || ci >= q->sz)
+		return -EIO;
+
+	if (q_space(pi, ci, q->sz) < (mbox_hdr_sz + sz)) {
+		emu->stats.tx_full++;
+		return -EAGAIN;
+	}
+
+	r = alloc_req(emu);
+	if (!r)
+		return -EAGAIN;
+
+	/* host has no notion of pem and always sends pf_idx 0 */
+	hdr.s.is_vf = (vf_idx != OCTEP_HOST_EMU_PF);
+	hdr.s.vf_idx = (hdr.s.is_vf) ? vf_idx : 0;
+	hdr.s.sz = sz;
+	hdr.s.flags = OCTEP_CTRL_MBOX_MSG_HDR_FLAG_REQ;
+	hdr.s.msg_id = r->msg_id;
+	pi = q_write(q, pi, &hdr, mbox_hdr_sz);
+	pi = q_write(q, pi, req, sz);
+
+	r->busy = true;
+	r->vf_idx = vf_idx;
+	r->send_ns = get_ns();
+	emu->npending++;
+	/* cp_write32 orders message data before producer index */
+	cp_write32(pi, q->prod);
+
+	emu->stats.tx_msgs++;
+	emu->stats.tx_bytes += mbox_hdr_sz + sz;
+	if (msg_id)
+		*msg_id = r->msg_id;
+
+	return 0;
+}
+
+/* Complete outstanding request with response in rx_buf */
+static int complete_req(struct octep_host_emu *emu,
+			union octep_ctrl_mbox_msg_hdr *hdr, uint32_t sz,
+			struct octep_host_emu_resp *resp)
+{
+	struct host_emu_req *r;
+
+	r = &emu->reqs[hdr->s.msg_id & emu->pending_mask];
+	if (!r->busy || r->msg_id != hdr->s.msg_id)
+		return -ENOENT;
+
+	resp->msg_id = r->msg_id;
+	resp->vf_idx = r->vf_idx;
+	resp->sz = hdr->s.sz;
+	resp->send_ns = r->send_ns;
+	resp->recv_ns = get_ns();
+	memset(&resp->resp, 0, sizeof(resp->resp));
+	memcpy(&resp->resp, &emu->rx_buf, cp_min(sz, sizeof(resp->resp)));
+	r->busy = false;
+	emu->npending--;
+
+	return 0;
+}
+
+int octep_host_emu_poll(struct octep_host_emu *emu,
+			struct octep_host_emu_resp *resps, int num)
+{
+	union octep_ctrl_mbox_msg_hdr hdr;
+	struct host_emu_q *q;
+	uint32_t pi, ci, depth, sz;
+	int n = 0, err;
+
+	if (!emu || (!resps && num))
+		return -EINVAL;
+
+	recv_oei(emu, true);
+	err = check_connected(emu);
+	if (err)
+		return err;
+
+	q = &emu->f2hq;
+	pi = cp_read32(q->prod);
+	ci = cp_read32(q->cons);
+	if (pi >= q->sz || ci >= q->sz)
+		return -EIO;
+
+	depth = q_depth(pi, ci, q->sz);
+	while (n < num && depth >= mbox_hdr_sz) {
+		q_read(q, ci, &hdr, mbox_hdr_sz);
+		/* incomplete message */
+		if (hdr.s.sz > (depth - mbox_hdr_sz))
+			break;
+
+		ci = (ci + mbox_hdr_sz) % q->sz;
+		sz = cp_min(hdr.s.sz, sizeof(emu->rx_buf));
+		q_read(q, ci, &emu->rx_buf, sz);
+		ci = (ci + hdr.s.sz) % q->sz;
+		depth -= (mbox_hdr_sz + hdr.s.sz);
+		emu->stats.rx_bytes += mbox_hdr_sz + hdr.s.sz;
+
+		if (hdr.s.flags & OCTEP_CTRL_MBOX_MSG_HDR_FLAG_RESP) {
+			if (complete_req(emu, &hdr, sz, &resps[n])) {
+				emu->stats.rx_unmatched++;
+				continue;
+			}
+			emu->stats.rx_resps++;
+			n++;
+		} else if (hdr.s.flags & OCTEP_CTRL_MBOX_MSG_HDR_FLAG_NOTIFY) {
+			emu->stats.rx_notify++;
+			if (emu->cfg.notify_cb)
+				emu->cfg.notify_cb(emu->cfg.notify_arg,
+						   (hdr.s.is_vf) ? hdr.s.vf_idx :
+						   OCTEP_HOST_EMU_PF,
+						   &emu->rx_buf, sz);
+		} else {
+			emu->stats.rx_unmatched++;
+		}
+	}
+	/* complete message reads before fw can reuse the space */
+	cp_io_rmb();
+	cp_write32(ci, q->cons);
+
+	return n;
+}
+
+int octep_host_emu_request(struct octep_host_emu *emu, int vf_idx,
+			   const struct octep_ctrl_net_h2f_req *req,
+			   uint32_t sz, struct octep_host_emu_resp *resp,
+			   uint32_t timeout_ms)
+{
+	struct host_emu_req *r;
+	uint64_t end_ns;
+	uint16_t msg_id;
+	int ret;
+
+	if (!emu || !resp)
+		return -EINVAL;
+
+	if (emu->npending)
+		return -EBUSY;
+
+	end_ns = get_ns() + (timeout_ms * NSEC_PER_MSEC);
+	while ((ret = octep_host_emu_send(emu, vf_idx, req, sz, &msg_id)) ==
+	       -EAGAIN) {
+		if (get_ns() >= end_ns)
+			return -ETIMEDOUT;
+		wait_ns(HOST_EMU_WAIT_NS);
+	}
+	if (ret)
+		return ret;
+
+	while (1) {
+		ret = octep_host_emu_poll(emu, resp, 1);
+		if (ret < 0)
+			return ret;
+		if (ret && resp->msg_id == msg_id)
+			return 0;
+		if (get_ns() >= end_ns)
+			break;
+		wait_ns(HOST_EMU_WAIT_NS);
+	}
+
+	/* a late response will be counted as unmatched */
+	r = &emu->reqs[msg_id & emu->pending_mask];
+	if (r->busy && r->msg_id == msg_id) {
+		r->busy = false;
+		emu->npending--;
+	}
+
+	return -ETIMEDOUT;
+}
+
+int octep_host_emu_pending(struct octep_host_emu *emu)
+{
+	return (emu) ? emu->npending : 0;
+}
+
+int octep_host_emu_get_stats(struct octep_host_emu *emu,
+			     struct octep_host_emu_stats *stats)
+{
+	if (!emu || !stats)
+		return -EINVAL;
+
+	*stats = emu->stats;
+
+	return 0;
+}
+
+void octep_host_emu_close(struct octep_host_emu *emu)
+{
+	if (!emu)
+		return;
+
+	if (emu->oei_fd >= 0)
+		close(emu->oei_fd);
+	munmap(emu->map, emu->map_sz);
+	close(emu->fd);
+	free(emu->reqs);
+	free(emu);
+}
@@ -0,0 +1,210 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2022 Marvell.
+ */
+#ifndef __OCTEP_HOST_EMU_H__
+#define __OCTEP_HOST_EMU_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "octep_ctrl_net.h"
+
+/* Host side of a pf control mailbox.
+ *
+ * Emulates the host driver half of the mailbox protocol over mailbox memory
+ * in a file, such as a tmpfs or shared memory file written by a simulated
+ * firmware: host version and status, producing requests into the
+ * host-to-fw queue and consuming responses and notifications from the
+ * fw-to-host queue. Responses are matched to requests by msg_id.
+ *
+ * An instance emulates one pf driver and should be used by one thread at a
+ * time. Mailbox memory is polled, oei interrupts from fw are only counted.
+ */
+
+/* Default max outstanding requests */
+#define OCTEP_HOST_EMU_PENDING_DEF	256
+/* Max outstanding requests */
+#define OCTEP_HOST_EMU_PENDING_MAX	4096
+/* pf is the sender of a request */
+#define OCTEP_HOST_EMU_PF		-1
+
+/* Callback for notification from fw.
+ *
+ * @param arg: cfg.notify_arg.
+ * @param vf_idx: receiver vf index, OCTEP_HOST_EMU_PF for pf.
+ * @param msg: notification, valid during the callback.
+ * @param sz: size of notification.
+ */
+typedef void (*octep_host_emu_notify_cb_t)(void *arg, int vf_idx,
+					   const void *msg, uint32_t sz);
+
+/* Host emulator configuration */
+struct octep_host_emu_cfg {
+	/* file with mailbox memory */
+	const char *path;
+	/* offset of mailbox memory in file */
+	off_t offset;
+	/* size of mailbox memory */
+	uint32_t sz;
+	/* host control plane version, should be of type OCTEP_CP_VERSION */
+	uint32_t version;
+	/* max outstanding requests, 0 for OCTEP_HOST_EMU_PENDING_DEF */
+	uint32_t max_pending;
+	/* called for notifications, may be NULL */
+	octep_host_emu_notify_cb_t notify_cb;
+	void *notify_arg;
+	/* fifo written by fw on oei interrupts, such as the oei fifo of a
+	 * simulated soc in octep_cp_sim.h, may be NULL
+	 */
+	const char *oei_path;
+};
+
+/* Completed request */
+struct octep_host_emu_resp {
+	/* msg_id returned by octep_host_emu_send */
+	uint16_t msg_id;
+	/* sender vf index, OCTEP_HOST_EMU_PF for pf */
+	int vf_idx;
+	/* size of response */
+	uint32_t sz;
+	/* CLOCK_MONOTONIC nsecs at send of request */
+	uint64_t send_ns;
+	/* CLOCK_MONOTONIC nsecs at receive of response */
+	uint64_t recv_ns;
+	/* response, truncated to sizeof(resp) */
+	struct octep_ctrl_net_h2f_resp resp;
+};
+
+/* Host emulator statistics */
+struct octep_host_emu_stats {
+	/* requests sent */
+	uint64_t tx_msgs;
+	/* bytes sent, message headers included */
+	uint64_t tx_bytes;
+	/* sends that found host-to-fw queue full */
+	uint64_t tx_full;
+	/* responses matched to a request */
+	uint64_t rx_resps;
+	/* notifications received */
+	uint64_t rx_notify;
+	/* bytes received, message headers included */
+	uint64_t rx_bytes;
+	/* responses with no outstanding request, or other messages */
+	uint64_t rx_unmatched;
+	/* oei interrupts received, if cfg.oei_path is set */
+	uint64_t rx_oei;
+};
+
+/* Host emulator instance */
+struct octep_host_emu;
+
+/* Open mailbox memory.
+ *
+ * Mailbox is not used until octep_host_emu_connect.
+ *
+ * @param cfg: non-null pointer to configuration.
+ *
+ * return value: instance on success, NULL on failure.
+ */
+struct octep_host_emu *octep_host_emu_open(const struct octep_host_emu_cfg *cfg);
+
+/* Wait for fw to be ready and set host ready.
+ *
+ * Reads queue sizes published by fw, drops outstanding requests and oei
+ * interrupts, and sets host version and status. Should be called again
+ * after fw reinitializes the mailbox, which is reported by -ENOTCONN.
+ *
+ * @param emu: instance from octep_host_emu_open.
+ * @param timeout_ms: time to wait for fw, 0 to check once.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_host_emu_connect(struct octep_host_emu *emu, uint32_t timeout_ms);
+
+/* Set host status to uninitialized, like a host driver unload.
+ *
+ * @param emu: instance from octep_host_emu_open.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_host_emu_disconnect(struct octep_host_emu *emu);
+
+/* Send a request.
+ *
+ * @param emu: instance from octep_host_emu_open.
+ * @param vf_idx: sender vf index, OCTEP_HOST_EMU_PF for pf.
+ * @param req: non-null pointer to request.
+ * @param sz: size of request.
+ * @param msg_id: filled with msg_id of request, may be NULL.
+ *
+ * return value: 0 on success, -EAGAIN if queue is full or too many
+ *               requests are outstanding, -ENOTCONN if fw is not ready,
+ *               -errno on other failures.
+ */
+int octep_host_emu_send(struct octep_host_emu *emu, int vf_idx,
+			const struct octep_ctrl_net_h2f_req *req, uint32_t sz,
+			uint16_t *msg_id);
+
+/* Receive responses and notifications.
+ *
+ * Notifications are passed to cfg.notify_cb, responses are matched to
+ * outstanding requests and returned in resps.
+ *
+ * @param emu: instance from octep_host_emu_open.
+ * @param resps: array to fill with completed requests.
+ * @param num: size of resps array.
+ *
+ * return value: number of completed requests on success, -ENOTCONN if fw
+ *               is not ready, -errno on other failures.
+ */
+int octep_host_emu_poll(struct octep_host_emu *emu,
+			struct octep_host_emu_resp *resps, int num);
+
+/* Send a request and wait for its response.
+ *
+ * Should not be mixed with outstanding requests from octep_host_emu_send.
+ *
+ * @param emu: instance from octep_host_emu_open.
+ * @param vf_idx: sender vf index, OCTEP_HOST_EMU_PF for pf.
+ * @param req: non-null pointer to request.
+ * @param sz: size of request.
+ * @param resp: non-null pointer to response to fill.
+ * @param timeout_ms: time to wait for response.
+ *
+ * return value: 0 on success, -EBUSY if requests are outstanding,
+ *               -ETIMEDOUT if response did not arrive, -errno on other
+ *               failures.
+ */
+int octep_host_emu_request(struct octep_host_emu *emu, int vf_idx,
+			   const struct octep_ctrl_net_h2f_req *req,
+			   uint32_t sz, struct octep_host_emu_resp *resp,
+			   uint32_t timeout_ms);
+
+/* Get number of outstanding requests.
+ *
+ * @param emu: instance from octep_host_emu_open.
+ *
+ * return value: number of outstanding requests.
+ */
+int octep_host_emu_pending(struct octep_host_emu *emu);
+
+/* Get statistics.
+ *
+ * @param emu: instance from octep_host_emu_open.
+ * @param stats: non-null pointer to statistics to fill.
+ *
+ * return value: 0 on success, -errno on failure.
+ */
+int octep_host_emu_get_stats(struct octep_host_emu *emu,
+			     struct octep_host_emu_stats *stats);
+
+/* Close mailbox memory.
+ *
+ * Host status is left as is, call octep_host_emu_disconnect before
+ * closing to emulate a driver unload.
+ *
+ * @param emu: instance from octep_host_emu_open.
+ */
+void octep_host_emu_close(struct octep_host_emu *emu);
+
+#endif /* __OCTEP_HOST_EMU_H__ */